@@ -0,0 +1,57 @@
+#include "ActuationQueue.h"
+
+ActuationQueue::ActuationQueue(ClassifierServo* servo) {
+    _servo = servo;
+    _head = 0;
+    _count = 0;
+}
+
+bool ActuationQueue::tickReached(unsigned long currentTick, unsigned long targetTick) {
+    // Signed difference handles the 32-bit wrap of the tick counter.
+    return (long)(currentTick - targetTick) >= 0;
+}
+
+bool ActuationQueue::schedule(uint16_t partId, uint8_t servoCode, unsigned long detectionTick, unsigned long currentTick) {
+    if (_count >= ACTUATION_QUEUE_SIZE) {
+        return false;
+    }
+
+    unsigned long targetTick = detectionTick + SERVO_GATE_OFFSET_TICKS;
+    uint8_t status = tickReached(currentTick, targetTick) ? ACTION_STATUS_LATE : ACTION_STATUS_ON_TIME;
+    PendingAction action = { partId, servoCode, status, targetTick };
+
+    // Shift later actions back by one slot and insert in tick order.
+    uint8_t position = _count;
+    while (position > 0) {
+        uint8_t previous = (_head + position - 1) % ACTUATION_QUEUE_SIZE;
+        if (!tickReached(_actions[previous].targetTick, action.targetTick + 1)) {
+            break; // previous.targetTick <= action.targetTick
+        }
+        _actions[(_head + position) % ACTUATION_QUEUE_SIZE] = _actions[previous];
+        position--;
+    }
+    _actions[(_head + position) % ACTUATION_QUEUE_SIZE] = action;
+    _count++;
+    return true;
+}
+
+bool ActuationQueue::update(unsigned long currentTick, PendingAction& executed) {
+    if (_count == 0 || !tickReached(currentTick, _actions[_head].targetTick)) {
+        return false;
+    }
+
+    executed = _actions[_head];
+    _servo->setPosition(executed.servoCode);
+    _head = (_head + 1) % ACTUATION_QUEUE_SIZE;
+    _count--;
+    return true;
+}
+
+uint8_t ActuationQueue::getPendingCount() {
+    return _count;
+}
+
+void ActuationQueue::clear() {
+    _head = 0;
+    _count = 0;
+}
@@ -0,0 +1,45 @@
+#ifndef ACTUATION_QUEUE_H
+#define ACTUATION_QUEUE_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "ClassifierServo.h"
+#include "Protocol.h"
+
+// A diversion the PC asked for, waiting for its part to reach the gate.
+struct PendingAction {
+    uint16_t partId;
+    uint8_t servoCode;
+    uint8_t status; // ACTION_STATUS_*
+    unsigned long targetTick;
+};
+
+// Fixed-capacity ring of pending servo actions, kept sorted by target tick so
+// that update() only has to look at the head. Parts can be scheduled out of
+// order; insertion is O(ACTUATION_QUEUE_SIZE), checking is O(1).
+class ActuationQueue {
+public:
+    ActuationQueue(ClassifierServo* servo);
+
+    // Queues a move for when the belt reaches detectionTick + SERVO_GATE_OFFSET_TICKS.
+    // An action whose tick has already passed runs on the next update() and is
+    // marked late. Returns false if the queue is full.
+    bool schedule(uint16_t partId, uint8_t servoCode, unsigned long detectionTick, unsigned long currentTick);
+
+    // Fires the action at the head if its tick has been reached. Returns true
+    // and fills `executed` when an action ran.
+    bool update(unsigned long currentTick, PendingAction& executed);
+
+    uint8_t getPendingCount();
+    void clear();
+
+private:
+    ClassifierServo* _servo;
+    PendingAction _actions[ACTUATION_QUEUE_SIZE];
+    uint8_t _head;
+    uint8_t _count;
+
+    static bool tickReached(unsigned long currentTick, unsigned long targetTick);
+};
+
+#endif
@@ -0,0 +1,110 @@
+#include <avr/eeprom.h>
+#include "BinTable.h"
+
+static const uint8_t BIN_TABLE_MAGIC = 0xB1;
+
+static constexpr bool anglesInRange(int index) {
+    return index >= SERVO_BIN_COUNT ||
+           (SERVO_BIN_ANGLES[index] >= 0 && SERVO_BIN_ANGLES[index] <= 180 && anglesInRange(index + 1));
+}
+static_assert(anglesInRange(0), "SERVO_BIN_ANGLES must be between 0 and 180 degrees");
+static_assert(SERVO_BIN_COUNT <= BIN_TABLE_MAX_BINS, "SERVO_BIN_ANGLES has more bins than the protocol supports");
+
+BinTable::BinTable() {
+    _persistIndex = BIN_TABLE_EEPROM_SIZE;
+    loadDefaults();
+}
+
+void BinTable::setup() {
+    uint8_t stored[BIN_TABLE_EEPROM_SIZE];
+    for (uint8_t i = 0; i < BIN_TABLE_EEPROM_SIZE; i++) {
+        stored[i] = eeprom_read_byte((const uint8_t*)(BIN_TABLE_EEPROM_ADDRESS + i));
+    }
+
+    uint8_t crc = 0;
+    for (uint8_t i = 1; i < BIN_TABLE_EEPROM_SIZE - 1; i++) {
+        crc = crc8Update(crc, stored[i]);
+    }
+    if (stored[0] == BIN_TABLE_MAGIC && stored[BIN_TABLE_EEPROM_SIZE - 1] == crc && isValid(&stored[1])) {
+        apply(&stored[1]);
+    }
+    _persistIndex = BIN_TABLE_EEPROM_SIZE; // EEPROM already matches, or keeps the defaults unwritten
+}
+
+bool BinTable::load(const uint8_t* payload) {
+    if (!isValid(payload)) {
+        return false;
+    }
+    apply(payload);
+    _persistIndex = 0;
+    return true;
+}
+
+uint8_t BinTable::getCrc() {
+    return _image[BIN_TABLE_EEPROM_SIZE - 1];
+}
+
+void BinTable::persistTask() {
+    while (_persistIndex < BIN_TABLE_EEPROM_SIZE) {
+        if (!eeprom_is_ready()) {
+            return; // Previous write still in progress; even a read would wait for it
+        }
+        uint8_t* address = (uint8_t*)(BIN_TABLE_EEPROM_ADDRESS + _persistIndex);
+        if (eeprom_read_byte(address) == _image[_persistIndex]) {
+            _persistIndex++; // Reading is fast, skip unchanged bytes
+            continue;
+        }
+        eeprom_update_byte(address, _image[_persistIndex]);
+        _persistIndex++;
+        return;
+    }
+}
+
+bool BinTable::isValid(const uint8_t* payload) {
+    uint8_t binCount = payload[0];
+    if (binCount > BIN_TABLE_MAX_BINS) {
+        return false;
+    }
+    for (uint8_t i = 0; i < binCount; i++) {
+        if (payload[1 + i] > 180) {
+            return false;
+        }
+    }
+    for (uint8_t i = 0; i < BIN_TABLE_CLASSES; i++) {
+        uint8_t bin = payload[1 + BIN_TABLE_MAX_BINS + i];
+        if (bin != BIN_HOME && bin >= binCount) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void BinTable::apply(const uint8_t* payload) {
+    _binCount = payload[0];
+    for (uint8_t i = 0; i < BIN_TABLE_MAX_BINS; i++) {
+        _binAngles[i] = i < _binCount ? payload[1 + i] : SERVO_POS_UNKNOWN;
+    }
+    for (uint8_t i = 0; i < BIN_TABLE_CLASSES; i++) {
+        _classBins[i] = payload[1 + BIN_TABLE_MAX_BINS + i];
+    }
+
+    _image[0] = BIN_TABLE_MAGIC;
+    uint8_t crc = 0;
+    for (uint8_t i = 0; i < BIN_TABLE_PAYLOAD; i++) {
+        _image[1 + i] = payload[i];
+        crc = crc8Update(crc, payload[i]);
+    }
+    _image[BIN_TABLE_EEPROM_SIZE - 1] = crc;
+}
+
+void BinTable::loadDefaults() {
+    uint8_t payload[BIN_TABLE_PAYLOAD];
+    payload[0] = SERVO_BIN_COUNT;
+    for (uint8_t i = 0; i < BIN_TABLE_MAX_BINS; i++) {
+        payload[1 + i] = i < SERVO_BIN_COUNT ? SERVO_BIN_ANGLES[i] : 0;
+    }
+    for (uint8_t i = 0; i < BIN_TABLE_CLASSES; i++) {
+        payload[1 + BIN_TABLE_MAX_BINS + i] = i < SERVO_BIN_COUNT ? i : BIN_HOME;
+    }
+    apply(payload);
+}
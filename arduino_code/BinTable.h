@@ -0,0 +1,50 @@
+#ifndef BIN_TABLE_H
+#define BIN_TABLE_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "Protocol.h"
+
+// Maps the class code the PC sends for a part to a diverter bin, and each bin
+// to a servo angle. The table lives in RAM so a lookup is two array reads; it
+// is loaded from EEPROM at boot and can be replaced by the PC at runtime with
+// a SET_BIN_TABLE frame, so changing the bin layout needs no reflash.
+//
+// EEPROM layout at BIN_TABLE_EEPROM_ADDRESS:
+//   [magic][binCount][angle x BIN_TABLE_MAX_BINS][bin x BIN_TABLE_CLASSES][crc8]
+// A blank or corrupt EEPROM falls back to SERVO_BIN_ANGLES with class N in bin N.
+class BinTable {
+public:
+    BinTable();
+    void setup();
+
+    // Servo angle for a class code; unknown classes and BIN_HOME go home.
+    uint8_t angleForClass(uint8_t classCode) {
+        uint8_t bin = classCode < BIN_TABLE_CLASSES ? _classBins[classCode] : BIN_HOME;
+        return bin < _binCount ? _binAngles[bin] : SERVO_POS_UNKNOWN;
+    }
+
+    // Replaces the table with a SET_BIN_TABLE payload. Returns false, leaving
+    // the table untouched, if the payload is invalid. The new table is used
+    // right away and written to EEPROM in the background by persistTask().
+    bool load(const uint8_t* payload);
+    // CRC-8 of the active table, as reported to the PC.
+    uint8_t getCrc();
+
+    // Writes at most one changed byte to EEPROM per call, so loop() never
+    // waits the ~3.3 ms an EEPROM write takes.
+    void persistTask();
+
+private:
+    uint8_t _binCount;
+    uint8_t _binAngles[BIN_TABLE_MAX_BINS];
+    uint8_t _classBins[BIN_TABLE_CLASSES];
+    uint8_t _image[BIN_TABLE_EEPROM_SIZE]; // EEPROM image of the active table
+    uint8_t _persistIndex;                 // Next byte to compare; BIN_TABLE_EEPROM_SIZE when in sync
+
+    static bool isValid(const uint8_t* payload);
+    void apply(const uint8_t* payload);
+    void loadDefaults();
+};
+
+#endif
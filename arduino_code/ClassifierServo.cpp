@@ -1,28 +1,141 @@
 #include "config.h"
 #include "ClassifierServo.h"
 
-ClassifierServo::ClassifierServo(int servoPin) {
-    _servoPin = servoPin;
+static_assert(CLASSIFIER_SERVO_PIN == 10, "ClassifierServo drives OC1B, which is pin 10 on the Uno");
+
+// Timer1 at 16 MHz / 8 counts 0.5 us ticks; TOP = 39999 gives a 20 ms frame.
+static const uint16_t SERVO_TICKS_PER_US = 2;
+static const uint16_t SERVO_FRAME_TICKS = 40000;
+static const uint8_t SERVO_FRAME_MS = 20;
+static const uint16_t SERVO_MIN_TICKS = SERVO_PULSE_MIN_US * SERVO_TICKS_PER_US;
+static const uint16_t SERVO_MAX_TICKS = SERVO_PULSE_MAX_US * SERVO_TICKS_PER_US;
+static const uint8_t SERVO_SETTLE_FRAMES = (SERVO_SETTLE_MS + SERVO_FRAME_MS - 1) / SERVO_FRAME_MS;
+
+// Minimum-jerk position profile s(t) = 10t^3 - 15t^4 + 6t^5 sampled at
+// t = i/32 in Q16. Velocity and acceleration are zero at both ends.
+static const uint8_t PROFILE_SEGMENTS = 32;
+static const uint16_t MIN_JERK_PROFILE[PROFILE_SEGMENTS + 1] PROGMEM = {
+    0, 19, 145, 467, 1052, 1951, 3196, 4806, 6784, 9121, 11797,
+    14781, 18036, 21515, 25167, 28938, 32768, 36597, 40368, 44020, 47499,
+    50754, 53738, 56414, 58751, 60729, 62339, 63584, 64483, 65068, 65390,
+    65516, 65535
+};
+
+ClassifierServo* ClassifierServo::_instance = 0;
+
+ClassifierServo::ClassifierServo(BinTable* binTable) {
+    _binTable = binTable;
+    _startTicks = angleToTicks(SERVO_POS_UNKNOWN);
+    _targetTicks = _startTicks;
+    _currentTicks = _startTicks;
+    _step = 0;
+    _stepCount = 0;
+    _settleFrames = 0;
+    _ready = false;
 }
 
 void ClassifierServo::setup() {
-    _servo.attach(_servoPin);
-    _servo.write(SERVO_POS_UNKNOWN); // Start at home position
-}
-
-void ClassifierServo::setPosition(int servoCode) {
-    switch (servoCode) {
-        case 0: // Corresponds to 'TRIANGLE' or 'RED' or 'SMALL'
-            _servo.write(SERVO_POS_TRIANGLE);
-            break;
-        case 1: // Corresponds to 'SQUARE' or 'YELLOW' or 'MEDIUM'
-            _servo.write(SERVO_POS_SQUARE);
-            break;
-        case 2: // Corresponds to 'CIRCLE' or 'GREEN' or 'LARGE'
-            _servo.write(SERVO_POS_CIRCLE);
-            break;
-        default: // 'UNKNOWN'
-            _servo.write(SERVO_POS_UNKNOWN);
-            break;
+    _instance = this;
+    pinMode(CLASSIFIER_SERVO_PIN, OUTPUT);
+
+    // Fast PWM with TOP = ICR1 (mode 14), clear OC1B on compare match, prescaler 8.
+    TCCR1A = _BV(COM1B1) | _BV(WGM11);
+    TCCR1B = _BV(WGM13) | _BV(WGM12) | _BV(CS11);
+    ICR1 = SERVO_FRAME_TICKS - 1;
+    OCR1B = _currentTicks; // Start at home position, without a profile
+    _settleFrames = SERVO_SETTLE_FRAMES;
+    TIMSK1 |= _BV(TOIE1);
+}
+
+void ClassifierServo::setPosition(int classCode) {
+    if (classCode < 0 || classCode > 0xFF) {
+        home();
+        return;
+    }
+    moveTo(_binTable->angleForClass((uint8_t)classCode));
+}
+
+void ClassifierServo::home() {
+    moveTo(SERVO_POS_UNKNOWN);
+}
+
+bool ClassifierServo::isReady() {
+    return _ready;
+}
+
+void ClassifierServo::moveTo(int angle) {
+    uint16_t target = angleToTicks(angle);
+
+    uint8_t oldSREG = SREG;
+    cli();
+    if (target == _targetTicks) {
+        SREG = oldSREG;
+        return; // Already there or on the way; the heartbeat repeats commands.
     }
-}
\ No newline at end of file
+    uint16_t start = _currentTicks;
+    SREG = oldSREG;
+
+    // Duration that keeps the profile's peak velocity (1.875 x average) at
+    // SERVO_MAX_SPEED_DEG_PER_S: t = 1.875 * distance / speed.
+    unsigned long distance = target > start ? target - start : start - target;
+    unsigned long durationMs = (distance * 1875UL * 180UL) /
+                               ((unsigned long)SERVO_MAX_SPEED_DEG_PER_S * (SERVO_MAX_TICKS - SERVO_MIN_TICKS));
+    unsigned long frames = (durationMs + SERVO_FRAME_MS - 1) / SERVO_FRAME_MS;
+    frames = constrain(frames, 1UL, 255UL);
+
+    cli();
+    // Start from the pulse currently being output, so a new target during a
+    // move continues smoothly from where the arm was commanded to be.
+    _startTicks = _currentTicks;
+    _targetTicks = target;
+    _step = 0;
+    _stepCount = (uint8_t)frames;
+    _ready = false;
+    SREG = oldSREG;
+}
+
+void ClassifierServo::handleTimerInterrupt() {
+    if (_instance != 0) {
+        _instance->step();
+    }
+}
+
+void ClassifierServo::step() {
+    if (_step < _stepCount) {
+        _step++;
+        long delta = (long)_targetTicks - (long)_startTicks;
+        _currentTicks = _startTicks + (int)((delta * (long)profileAt(_step, _stepCount)) >> 16);
+        if (_step == _stepCount) {
+            _currentTicks = _targetTicks;
+            _settleFrames = SERVO_SETTLE_FRAMES;
+        }
+        // OCR1B is double-buffered in PWM mode and takes effect in the next frame.
+        OCR1B = _currentTicks;
+    } else if (_settleFrames > 0) {
+        if (--_settleFrames == 0) {
+            _ready = true;
+        }
+    }
+}
+
+uint16_t ClassifierServo::angleToTicks(int angle) {
+    angle = constrain(angle, 0, 180);
+    return SERVO_MIN_TICKS + (uint16_t)(((unsigned long)angle * (SERVO_MAX_TICKS - SERVO_MIN_TICKS)) / 180UL);
+}
+
+uint16_t ClassifierServo::profileAt(uint8_t step, uint8_t stepCount) {
+    // Linear interpolation between the table samples around t = step / stepCount.
+    uint16_t position = (uint16_t)step * PROFILE_SEGMENTS;
+    uint8_t index = position / stepCount;
+    if (index >= PROFILE_SEGMENTS) {
+        return pgm_read_word(&MIN_JERK_PROFILE[PROFILE_SEGMENTS]);
+    }
+    uint16_t remainder = position % stepCount;
+    uint16_t low = pgm_read_word(&MIN_JERK_PROFILE[index]);
+    uint16_t high = pgm_read_word(&MIN_JERK_PROFILE[index + 1]);
+    return low + (uint16_t)(((unsigned long)(high - low) * remainder) / stepCount);
+}
+
+ISR(TIMER1_OVF_vect) {
+    ClassifierServo::handleTimerInterrupt();
+}
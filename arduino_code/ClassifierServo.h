@@ -2,17 +2,46 @@
 #define CLASSIFIER_SERVO_H
 
 #include <Arduino.h>
-#include <Servo.h>
+#include "config.h"
+#include "BinTable.h"
 
+// Diverter servo driven straight from Timer1 instead of the Servo library.
+// Timer1 runs in fast PWM mode at 50 Hz, so the pulse itself is generated by
+// the hardware on OC1B (pin 10) without any ISR jitter. The overflow interrupt
+// at the end of every 20 ms frame steps the commanded pulse width along a
+// minimum-jerk profile towards the target, which keeps the arm from
+// overshooting. The arm counts as ready once the profile has finished and
+// SERVO_SETTLE_MS have passed.
 class ClassifierServo {
 public:
-    ClassifierServo(int servoPin);
+    ClassifierServo(BinTable* binTable);
     void setup();
-    void setPosition(int servoCode);
+    // Moves to the bin of a class code, looked up in the bin table.
+    void setPosition(int classCode);
+    void home();
+    // True when the arm has reached its last target and settled.
+    bool isReady();
+
+    static void handleTimerInterrupt(); // Called from the Timer1 overflow ISR
 
 private:
-    int _servoPin;
-    Servo _servo;
+    BinTable* _binTable;
+
+    // Shared with the ISR. Pulse widths are in Timer1 ticks (0.5 us).
+    volatile uint16_t _startTicks;
+    volatile uint16_t _targetTicks;
+    volatile uint16_t _currentTicks;
+    volatile uint8_t _step;
+    volatile uint8_t _stepCount;
+    volatile uint8_t _settleFrames;
+    volatile bool _ready;
+
+    static ClassifierServo* _instance;
+
+    void moveTo(int angle);
+    void step();
+    static uint16_t angleToTicks(int angle);
+    static uint16_t profileAt(uint8_t step, uint8_t stepCount);
 };
 
 #endif
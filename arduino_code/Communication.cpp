@@ -1,73 +1,488 @@
 #include "config.h"
 #include "Communication.h"
 
-Communication::Communication(long baudRate, Motor* motor, ClassifierServo* servo) {
+// Size of the HardwareSerial receive ring buffer; the AVR core defines it.
+#ifndef SERIAL_RX_BUFFER_SIZE
+#define SERIAL_RX_BUFFER_SIZE 64
+#endif
+
+Communication::Communication(long baudRate, ConveyorMotor* motor, ClassifierServo* servo, SpeedController* speedController,
+                             ActuationQueue* actuationQueue, BinTable* binTable) {
     _baudRate = baudRate;
     _motor = motor;
     _servo = servo;
-    _inputString = "";
+    _speedController = speedController;
+    _actuationQueue = actuationQueue;
+    _binTable = binTable;
+    _lineLength = 0;
+    _lineOverflow = false;
+    _parseTimeMicros = 0;
+    _maxParseTimeMicros = 0;
+    _lineOverflowCount = 0;
+    _parseErrorCount = 0;
+    _crcErrorCount = 0;
+    _rxOverflowCount = 0;
+    _statsRequested = false;
+    _statsFlags = 0;
     _lastSerialSendTime = 0;
+    _lastSentRpm = 0;
+    _lastSentStatus = -1; // Forces a first message
+    _linkLost = false;
+    _safe = false;
+    _deviceId = 0;
+    _binaryMode = false;
+    _highSpeedMode = false;
+    _baudCode = BAUD_CODE_KEEP;
+    _batchCount = 0;
+    _rxState = RX_WAIT_SYNC;
+    _rxType = 0;
+    _rxSize = 0;
+    _rxIndex = 0;
+    _rxCrc = 0;
 }
 
 void Communication::setup() {
+    noInterrupts();
+    _deviceId = readDeviceId();
+    interrupts();
     Serial.begin(_baudRate);
-    _inputString.reserve(20); // Reserve memory for the input string
     _lastHeartbeatTime = millis();
 }
 
-void Communication::update(float rpm, int obstacleState) {
-    handleSerial();
-    sendDataToPC(rpm, obstacleState);
-    _checkHeartbeat();
+unsigned long Communication::getParseTimeMicros() {
+    return _parseTimeMicros;
+}
+
+unsigned long Communication::getMaxParseTimeMicros() {
+    return _maxParseTimeMicros;
+}
+
+unsigned int Communication::getLineOverflowCount() {
+    return _lineOverflowCount;
+}
+
+unsigned int Communication::getParseErrorCount() {
+    return _parseErrorCount;
+}
+
+unsigned int Communication::getCrcErrorCount() {
+    return _crcErrorCount;
+}
+
+unsigned int Communication::getRxOverflowCount() {
+    return _rxOverflowCount;
+}
+
+void Communication::resetMaxParseTime() {
+    _maxParseTimeMicros = 0;
+}
+
+bool Communication::takeStatsRequest(bool& reset) {
+    if (!_statsRequested) {
+        return false;
+    }
+    _statsRequested = false;
+    reset = (_statsFlags & STATS_FLAG_RESET) != 0;
+    return true;
+}
+
+void Communication::sendStats(const ProfileStats& stats) {
+    uint8_t payload[PROFILE_STATS_PAYLOAD];
+    writeUint16(&payload[0], stats.loopMinUs);
+    writeUint16(&payload[2], stats.loopMaxUs);
+    writeUint16(&payload[4], stats.loopMeanUs);
+    writeUint32(&payload[6], stats.loopCount);
+    writeUint32(&payload[10], stats.encoderPulses);
+    writeUint16(&payload[14], stats.obstacleEdges);
+    writeUint16(&payload[16], stats.timerTicks);
+    writeUint16(&payload[18], stats.rxOverflows);
+    writeUint16(&payload[20], stats.lineOverflows);
+    writeUint16(&payload[22], stats.parseErrors);
+    writeUint16(&payload[24], stats.crcErrors);
+    writeUint16(&payload[26], stats.maxParseUs);
+    writeUint16(&payload[28], stats.freeSram);
+    payload[30] = stats.droppedEvents;
+    sendFrame(FRAME_TYPE_STATS, payload, sizeof(payload));
 }
 
 void Communication::handleSerial() {
-    while (Serial.available()) {
-        char inChar = (char)Serial.read();
+    unsigned long startTime = micros();
+
+    // HardwareSerial silently drops bytes once its ring buffer is full.
+    if (Serial.available() >= SERIAL_RX_BUFFER_SIZE - 1) {
+        _rxOverflowCount++;
+    }
+
+    // Bounded number of bytes per call; whatever is left waits in the RX buffer
+    // for the next loop() instead of stalling this one.
+    for (int i = 0; i < SERIAL_MAX_BYTES_PER_UPDATE && Serial.available(); i++) {
+        uint8_t inByte = (uint8_t)Serial.read();
+        if (parseFrameByte(inByte)) {
+            continue; // Byte belongs to a binary frame.
+        }
+
+        char inChar = (char)inByte;
         if (inChar == '\n') {
-            processCommand(_inputString);
-            _inputString = ""; // Clear the string
+            if (!_lineOverflow) {
+                _lineBuffer[_lineLength] = '\0';
+                processLine();
+            }
+            _lineLength = 0;
+            _lineOverflow = false;
+        } else if (_lineOverflow) {
+            // Still inside a line that was too long; drop it.
+        } else if (_lineLength < SERIAL_LINE_BUFFER_SIZE - 1) {
+            _lineBuffer[_lineLength++] = inChar;
         } else {
-            _inputString += inChar;
+            _lineOverflow = true;
+            _lineOverflowCount++;
         }
     }
+
+    _parseTimeMicros = micros() - startTime;
+    if (_parseTimeMicros > _maxParseTimeMicros) {
+        _maxParseTimeMicros = _parseTimeMicros;
+    }
 }
 
-void Communication::processCommand(String command) {
-    command.trim();
-    int separatorIndex = command.indexOf('_');
-    if (separatorIndex == -1) {
+bool Communication::parseFrameByte(uint8_t inByte) {
+    switch (_rxState) {
+        case RX_WAIT_SYNC:
+            if (inByte != FRAME_SYNC_BYTE) {
+                return false; // Not ours, let the ASCII parser have it.
+            }
+            _rxState = RX_TYPE;
+            return true;
+
+        case RX_TYPE:
+            _rxSize = protocolPayloadSize(inByte);
+            if (_rxSize == PROTOCOL_INVALID_SIZE || _rxSize > PROTOCOL_MAX_PAYLOAD) {
+                _rxState = RX_WAIT_SYNC; // Unknown frame type, resynchronize.
+                return true;
+            }
+            _rxType = inByte;
+            _rxCrc = crc8Update(0, inByte);
+            _rxIndex = 0;
+            _rxState = (_rxSize == 0) ? RX_CRC : RX_PAYLOAD;
+            return true;
+
+        case RX_PAYLOAD:
+            _rxPayload[_rxIndex++] = inByte;
+            _rxCrc = crc8Update(_rxCrc, inByte);
+            if (_rxIndex >= _rxSize) {
+                _rxState = RX_CRC;
+            }
+            return true;
+
+        case RX_CRC:
+            if (inByte == _rxCrc) {
+                processFrame(_rxType, _rxPayload);
+            } else {
+                _crcErrorCount++;
+            }
+            _rxState = RX_WAIT_SYNC;
+            return true;
+    }
+    return false;
+}
+
+void Communication::processFrame(uint8_t frameType, const uint8_t* payload) {
+    // Any frame that passed the CRC shows the host is alive.
+    refreshHeartbeat();
+    switch (frameType) {
+        case FRAME_TYPE_HELLO: {
+            // The host speaks the binary protocol; answer and switch telemetry over.
+            _binaryMode = true;
+            _linkLost = false;
+            long newBaudRate = protocolBaudRate(payload[1]);
+            uint8_t ack[6] = { PROTOCOL_VERSION, (uint8_t)(newBaudRate > 0 ? payload[1] : BAUD_CODE_KEEP) };
+            writeUint32(&ack[2], _deviceId);
+            sendFrame(FRAME_TYPE_HELLO_ACK, ack, sizeof(ack));
+            if (newBaudRate > 0) {
+                // The ACK still goes out at the old rate, the host switches once it sees it.
+                Serial.flush();
+                Serial.begin(newBaudRate);
+                _highSpeedMode = true;
+                _baudCode = payload[1];
+                _batchCount = 0;
+            }
+            break;
+        }
+        case FRAME_TYPE_QUERY_CAPS:
+            sendCapabilities();
+            break;
+        case FRAME_TYPE_COMMAND:
+            applyCommand(payload[0], payload[1]);
+            break;
+        case FRAME_TYPE_SET_RPM:
+            _speedController->setSetpoint((unsigned int)readInt16(payload));
+            break;
+        case FRAME_TYPE_SET_GAINS:
+            _speedController->setGains(readInt16(&payload[0]), readInt16(&payload[2]), readInt16(&payload[4]));
+            break;
+        case FRAME_TYPE_SCHEDULE: {
+            uint16_t partId = (uint16_t)readInt16(&payload[0]);
+            unsigned long detectionTick = readUint32(&payload[3]);
+            unsigned long currentTick = RpmSensor::getTickCount();
+            if (!_actuationQueue->schedule(partId, payload[2], detectionTick, currentTick)) {
+                PendingAction dropped = { partId, payload[2], ACTION_STATUS_DROPPED, detectionTick + SERVO_GATE_OFFSET_TICKS };
+                sendActionEvent(dropped, currentTick);
+            }
+            break;
+        }
+        case FRAME_TYPE_SET_BIN_TABLE: {
+            bool accepted = _binTable->load(payload);
+            uint8_t ack[2] = { accepted ? BIN_TABLE_STATUS_OK : BIN_TABLE_STATUS_INVALID, _binTable->getCrc() };
+            sendFrame(FRAME_TYPE_BIN_TABLE_ACK, ack, sizeof(ack));
+            break;
+        }
+        case FRAME_TYPE_QUERY_STATS:
+            // Answered from the stats task, which can see every component.
+            _statsRequested = true;
+            _statsFlags = payload[0];
+            break;
+        default:
+            break; // Device -> Host frame types are ignored.
+    }
+}
+
+void Communication::processLine() {
+    // Expected format: "PWM_SERVO", optionally surrounded by whitespace or '\r'.
+    const char* cursor = _lineBuffer;
+    int pwmValue;
+    int servoCode;
+
+    if (!parseIntField(cursor, pwmValue) || *cursor++ != '_' || !parseIntField(cursor, servoCode)) {
+        _parseErrorCount++;
         return; // Invalid command format
     }
+    while (*cursor == ' ' || *cursor == '\r' || *cursor == '\t') {
+        cursor++;
+    }
+    if (*cursor != '\0') {
+        _parseErrorCount++;
+        return;
+    }
+
+    applyCommand(pwmValue, servoCode);
+}
+
+bool Communication::parseIntField(const char*& cursor, int& value) {
+    while (*cursor == ' ' || *cursor == '\t') {
+        cursor++;
+    }
+    bool negative = (*cursor == '-');
+    if (negative) {
+        cursor++;
+    }
+
+    // At most 5 digits, so the loop is bounded and the value fits in an int.
+    long result = 0;
+    uint8_t digits = 0;
+    while (*cursor >= '0' && *cursor <= '9' && digits < 5) {
+        result = result * 10 + (*cursor - '0');
+        cursor++;
+        digits++;
+    }
+    if (digits == 0 || result > 32767) {
+        return false;
+    }
 
+    value = negative ? -(int)result : (int)result;
+    return true;
+}
+
+void Communication::applyCommand(int pwmValue, int servoCode) {
     // Valid command received, so update the heartbeat timer.
-    _lastHeartbeatTime = millis();
+    refreshHeartbeat();
+
+    // In closed-loop mode the PID owns the motor and the PWM field is ignored.
+    if (!_speedController->isEnabled()) {
+        _motor->setSpeed(pwmValue);
+    }
+    if (servoCode != SERVO_CODE_KEEP) {
+        _servo->setPosition(servoCode);
+    }
+}
+
+void Communication::sendFrame(uint8_t frameType, const uint8_t* payload, uint8_t size) {
+    uint8_t crc = crc8Update(0, frameType);
+    Serial.write(FRAME_SYNC_BYTE);
+    Serial.write(frameType);
+    for (uint8_t i = 0; i < size; i++) {
+        Serial.write(payload[i]);
+        crc = crc8Update(crc, payload[i]);
+    }
+    Serial.write(crc);
+}
+
+void Communication::writeUint16(uint8_t* buffer, uint16_t value) {
+    buffer[0] = (uint8_t)(value & 0xFF);
+    buffer[1] = (uint8_t)(value >> 8);
+}
+
+void Communication::writeUint32(uint8_t* buffer, unsigned long value) {
+    buffer[0] = (uint8_t)(value & 0xFF);
+    buffer[1] = (uint8_t)(value >> 8);
+    buffer[2] = (uint8_t)(value >> 16);
+    buffer[3] = (uint8_t)(value >> 24);
+}
+
+int Communication::readInt16(const uint8_t* buffer) {
+    return (int)((uint16_t)buffer[0] | ((uint16_t)buffer[1] << 8));
+}
 
-    String pwmStr = command.substring(0, separatorIndex);
-    String servoStr = command.substring(separatorIndex + 1);
+unsigned long Communication::readUint32(const uint8_t* buffer) {
+    return (unsigned long)buffer[0] | ((unsigned long)buffer[1] << 8) |
+           ((unsigned long)buffer[2] << 16) | ((unsigned long)buffer[3] << 24);
+}
 
-    int pwmValue = pwmStr.toInt();
-    int servoCode = servoStr.toInt();
+void Communication::sendObstacleEvent(const ObstacleEvent& event) {
+    if (!_binaryMode) {
+        // ASCII hosts only see the state in the telemetry line; in event mode
+        // that line goes out now rather than on the next telemetry task.
+        if (TELEMETRY_EVENT_MODE) {
+            sendTelemetry(_lastSentRpm, event.state);
+        }
+        return;
+    }
+    uint8_t payload[9];
+    writeUint32(&payload[0], event.timestampUs);
+    writeUint32(&payload[4], event.tick);
+    payload[8] = event.state;
+    sendFrame(FRAME_TYPE_OBSTACLE_EVENT, payload, sizeof(payload));
+}
 
-    _motor->setSpeed(pwmValue);
-    _servo->setPosition(servoCode);
+void Communication::sendActionEvent(const PendingAction& action, unsigned long tick) {
+    if (!_binaryMode) {
+        return;
+    }
+    uint8_t payload[8] = {
+        (uint8_t)(action.partId & 0xFF),
+        (uint8_t)(action.partId >> 8),
+        action.servoCode,
+        action.status
+    };
+    writeUint32(&payload[4], tick);
+    sendFrame(FRAME_TYPE_ACTION_EVENT, payload, sizeof(payload));
 }
 
 void Communication::sendDataToPC(float rpm, int obstacleState) {
-    unsigned long currentTime = millis();
-    if (currentTime - _lastSerialSendTime >= SERIAL_SEND_INTERVAL_MS) {
-        Serial.print((int)rpm);
+    // Binary hosts also get the servo's ready bit; the ASCII line stays "rpm_obstacle".
+    int status = obstacleState;
+    if (_binaryMode && _servo->isReady()) {
+        status |= TELEMETRY_STATUS_SERVO_READY;
+    }
+
+    if (_highSpeedMode) {
+        sampleTelemetry(rpm, status);
+        return;
+    }
+
+    int rpmValue = (int)constrain((long)rpm, 0L, 32767L);
+    if (telemetryDue(rpmValue, status, millis())) {
+        sendTelemetry(rpmValue, status);
+    }
+}
+
+bool Communication::telemetryDue(int rpm, int status, unsigned long currentTime) {
+    unsigned long sinceLastSend = currentTime - _lastSerialSendTime;
+    if (!TELEMETRY_EVENT_MODE) {
+        return sinceLastSend >= SERIAL_SEND_INTERVAL_MS;
+    }
+    if (status != _lastSentStatus || sinceLastSend >= TELEMETRY_KEEPALIVE_MS) {
+        return true;
+    }
+    int rpmChange = rpm - _lastSentRpm;
+    return sinceLastSend >= TELEMETRY_MIN_INTERVAL_MS &&
+           (rpmChange >= TELEMETRY_RPM_DEADBAND || rpmChange <= -TELEMETRY_RPM_DEADBAND);
+}
+
+void Communication::sendTelemetry(int rpm, int status) {
+    if (_binaryMode) {
+        uint8_t payload[11];
+        payload[0] = (uint8_t)(rpm & 0xFF);
+        payload[1] = (uint8_t)(rpm >> 8);
+        payload[2] = (uint8_t)status;
+        writeUint32(&payload[3], micros());
+        writeUint32(&payload[7], RpmSensor::getTickCount());
+        sendFrame(FRAME_TYPE_TELEMETRY, payload, sizeof(payload));
+    } else {
+        Serial.print(rpm);
         Serial.print("_");
-        Serial.println(obstacleState);
-        _lastSerialSendTime = currentTime;
+        Serial.println(status);
+    }
+    _lastSerialSendTime = millis();
+    _lastSentRpm = rpm;
+    _lastSentStatus = status;
+}
+
+void Communication::sampleTelemetry(float rpm, int status) {
+    // Paced by the scheduler every TELEMETRY_TASK_PERIOD_US.
+    unsigned long now = micros();
+    uint16_t rpmValue = (uint16_t)constrain((long)rpm, 0L, 65535L);
+    uint8_t* sample = &_batchPayload[1 + _batchCount * TELEMETRY_SAMPLE_SIZE];
+    writeUint32(sample, now);
+    writeUint32(&sample[4], RpmSensor::getTickCount());
+    sample[8] = (uint8_t)(rpmValue & 0xFF);
+    sample[9] = (uint8_t)(rpmValue >> 8);
+    sample[10] = (uint8_t)status;
+    sample[11] = (uint8_t)_motor->getSpeed();
+
+    if (++_batchCount >= TELEMETRY_BATCH_SAMPLES) {
+        _batchPayload[0] = _batchCount;
+        sendFrame(FRAME_TYPE_TELEMETRY_BATCH, _batchPayload, TELEMETRY_BATCH_PAYLOAD);
+        _batchCount = 0;
+    }
+}
+
+void Communication::leaveHighSpeedMode() {
+    if (!_highSpeedMode) {
+        return;
     }
+    Serial.flush();
+    Serial.begin(_baudRate);
+    _highSpeedMode = false;
+    _baudCode = BAUD_CODE_KEEP;
+    _batchCount = 0;
+}
+
+void Communication::sendCapabilities() {
+    uint8_t flags = (_binaryMode ? CAPS_FLAG_BINARY : 0) | (STAY_ALIVE_MODE ? CAPS_FLAG_STAY_ALIVE : 0) |
+                    (_linkLost ? CAPS_FLAG_LINK_LOST : 0);
+    uint8_t payload[12] = { PROTOCOL_VERSION, flags, _baudCode, _actuationQueue->getPendingCount() };
+    writeUint32(&payload[4], RpmSensor::getTickCount());
+    writeUint32(&payload[8], _deviceId);
+    sendFrame(FRAME_TYPE_CAPS, payload, sizeof(payload));
+    _linkLost = false;
+}
+
+void Communication::refreshHeartbeat() {
+    _lastHeartbeatTime = millis();
+    _safe = false;
 }
 
-void Communication::_checkHeartbeat() {
-    if (millis() - _lastHeartbeatTime > HEARTBEAT_TIMEOUT_MS) {
-        // We haven't received a command in a while, assume disconnection.
-        // Go to a safe state.
-        _motor->setSpeed(0);
-        _servo->setPosition(9); // Corresponds to ServoCode.UNKNOWN
+void Communication::checkHeartbeat() {
+    unsigned long silence = millis() - _lastHeartbeatTime;
+    if (silence <= HEARTBEAT_TIMEOUT_MS) {
+        return;
+    }
+    // We haven't received a command in a while, assume disconnection.
+    _linkLost = true;
+    if (_safe || (STAY_ALIVE_MODE && silence <= LINK_LOSS_SAFE_STATE_MS)) {
+        return; // Already stopped, or keep sorting what is on the belt: the host may be back shortly.
     }
-}
\ No newline at end of file
+    enterSafeState();
+    _safe = true;
+}
+
+void Communication::enterSafeState() {
+    _speedController->setSetpoint(0);
+    _motor->setSpeed(0);
+    _actuationQueue->clear();
+    _servo->home();
+    // The next host may only speak ASCII at the default rate; it has to
+    // say HELLO again for binary and high speed.
+    _binaryMode = false;
+    leaveHighSpeedMode();
+}
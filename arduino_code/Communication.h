@@ -2,27 +2,119 @@
 #define COMMUNICATION_H
 
 #include <Arduino.h>
-#include "Motor.h"
+#include "config.h"
+#include "FastMotor.h"
 #include "ClassifierServo.h"
+#include "ObstacleSensor.h"
+#include "SpeedController.h"
+#include "ActuationQueue.h"
+#include "BinTable.h"
+#include "Protocol.h"
+#include "Profiling.h"
+#include "DeviceId.h"
 
 class Communication {
 public:
-    Communication(long baudRate, Motor* motor, ClassifierServo* servo);
+    Communication(long baudRate, ConveyorMotor* motor, ClassifierServo* servo, SpeedController* speedController,
+                  ActuationQueue* actuationQueue, BinTable* binTable);
     void setup();
-    void update(float rpm, int obstacleState);
+
+    // Scheduler tasks, see arduino_code.ino.
+    void handleSerial();
+    // Sends periodic telemetry; in high-speed mode every call takes one batch sample.
+    void sendDataToPC(float rpm, int obstacleState);
+    void checkHeartbeat();
+
+    // Forwards an obstacle edge to the PC immediately (binary protocol only).
+    void sendObstacleEvent(const ObstacleEvent& event);
+    // Reports a scheduled action that ran (or was dropped) at the given tick.
+    void sendActionEvent(const PendingAction& action, unsigned long tick);
+
+    // Time spent parsing serial input during the last handleSerial() and the worst seen.
+    unsigned long getParseTimeMicros();
+    unsigned long getMaxParseTimeMicros();
+    // Lines discarded for being too long or malformed.
+    unsigned int getLineOverflowCount();
+    unsigned int getParseErrorCount();
+    // Binary frames discarded for a bad CRC.
+    unsigned int getCrcErrorCount();
+    // Times handleSerial() found the RX buffer full, i.e. bytes were probably lost.
+    unsigned int getRxOverflowCount();
+    void resetMaxParseTime();
+
+    // True once after the PC sent QUERY_STATS; reset is set if it asked to restart the measurements.
+    bool takeStatsRequest(bool& reset);
+    void sendStats(const ProfileStats& stats);
 
 private:
+    // States of the binary frame parser.
+    enum RxState : uint8_t {
+        RX_WAIT_SYNC,
+        RX_TYPE,
+        RX_PAYLOAD,
+        RX_CRC
+    };
+
     long _baudRate;
-    String _inputString;
+    uint32_t _deviceId;
+    // Fixed ASCII line buffer; a line that does not fit is dropped up to its '\n'.
+    char _lineBuffer[SERIAL_LINE_BUFFER_SIZE];
+    uint8_t _lineLength;
+    bool _lineOverflow;
+    unsigned long _parseTimeMicros;
+    unsigned long _maxParseTimeMicros;
+    unsigned int _lineOverflowCount;
+    unsigned int _parseErrorCount;
+    unsigned int _crcErrorCount;
+    unsigned int _rxOverflowCount;
+    bool _statsRequested;
+    uint8_t _statsFlags;
     unsigned long _lastSerialSendTime;
+    int _lastSentRpm;
+    int _lastSentStatus;
     unsigned long _lastHeartbeatTime;
-    Motor* _motor;
+    ConveyorMotor* _motor;
     ClassifierServo* _servo;
+    SpeedController* _speedController;
+    ActuationQueue* _actuationQueue;
+    BinTable* _binTable;
 
-    void handleSerial();
-    void processCommand(String command);
-    void sendDataToPC(float rpm, int obstacleState);
-    void _checkHeartbeat();
+    // Set when the heartbeat times out, reported and cleared by the next QUERY_CAPS or HELLO.
+    bool _linkLost;
+    // Set once the timeout has stopped the belt, so that happens only once per outage.
+    bool _safe;
+
+    // Binary protocol state. The host switches us to binary with a HELLO frame.
+    bool _binaryMode;
+    // High-speed mode: the HELLO asked for a faster baud rate, telemetry goes out in batches.
+    bool _highSpeedMode;
+    uint8_t _baudCode; // Rate of the link, BAUD_CODE_KEEP for _baudRate
+    uint8_t _batchCount;
+    uint8_t _batchPayload[TELEMETRY_BATCH_PAYLOAD];
+    RxState _rxState;
+    uint8_t _rxType;
+    uint8_t _rxSize;
+    uint8_t _rxIndex;
+    uint8_t _rxCrc;
+    uint8_t _rxPayload[PROTOCOL_MAX_PAYLOAD];
+
+    bool parseFrameByte(uint8_t inByte);
+    void processFrame(uint8_t frameType, const uint8_t* payload);
+    void processLine();
+    static bool parseIntField(const char*& cursor, int& value);
+    void applyCommand(int pwmValue, int servoCode);
+    void refreshHeartbeat();
+    void sendFrame(uint8_t frameType, const uint8_t* payload, uint8_t size);
+    static void writeUint16(uint8_t* buffer, uint16_t value);
+    static void writeUint32(uint8_t* buffer, unsigned long value);
+    static int readInt16(const uint8_t* buffer);
+    static unsigned long readUint32(const uint8_t* buffer);
+    bool telemetryDue(int rpm, int status, unsigned long currentTime);
+    void sendTelemetry(int rpm, int status);
+    void sampleTelemetry(float rpm, int status);
+    void leaveHighSpeedMode();
+    void sendCapabilities();
+    void enterSafeState();
 };
 
 #endif
@@ -0,0 +1,15 @@
+#include "DeviceId.h"
+#include <avr/boot.h>
+
+// Signature row bytes holding the lot number, wafer number and die coordinates.
+const uint8_t SERIAL_NUMBER_FIRST_ADDRESS = 0x0E;
+const uint8_t SERIAL_NUMBER_LAST_ADDRESS = 0x17;
+
+uint32_t readDeviceId() {
+    // FNV-1a, so every byte of the serial number affects every bit of the ID.
+    uint32_t hash = 2166136261UL;
+    for (uint8_t address = SERIAL_NUMBER_FIRST_ADDRESS; address <= SERIAL_NUMBER_LAST_ADDRESS; address++) {
+        hash = (hash ^ boot_signature_byte_get(address)) * 16777619UL;
+    }
+    return hash;
+}
@@ -0,0 +1,13 @@
+#ifndef DEVICE_ID_H
+#define DEVICE_ID_H
+
+#include <Arduino.h>
+
+// A 32-bit identifier of this board, reported in HELLO_ACK and CAPS so the PC
+// can tell several belts apart whatever port they enumerate on. It is a hash
+// of the serial number (lot, wafer and die position) that the factory leaves
+// in the ATmega328P signature row, so it survives reflashing and needs no setup.
+// Reads the signature row; call once, with interrupts disabled.
+uint32_t readDeviceId();
+
+#endif
@@ -0,0 +1,57 @@
+#ifndef FAST_MOTOR_H
+#define FAST_MOTOR_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "FastPin.h"
+
+// Motor driven by writing the Timer2 compare register directly instead of
+// going through analogWrite()'s pin-to-timer lookup. Timer0 is shared with
+// millis() and the PID interrupt and Timer1 belongs to the Servo library, so
+// only the Timer2 pins 3 and 11 are supported; use Motor for anything else.
+// Relies on the Arduino core's phase-correct PWM setup of Timer2, in which a
+// compare value of 0 keeps the output low.
+template <uint8_t PIN>
+class FastMotor {
+public:
+    static_assert(PIN == 3 || PIN == 11, "FastMotor needs a Timer2 PWM pin (3 or 11)");
+
+    FastMotor() : currentSpeed(0) {}
+
+    void setup() {
+        FastPin<PIN>::low(); // Ensure motor is off initially
+        FastPin<PIN>::setOutput();
+        compareRegister() = 0;
+        TCCR2A |= PIN == 11 ? _BV(COM2A1) : _BV(COM2B1); // Connect the pin to the timer
+    }
+
+    void setSpeed(int speed) {
+        int pwmValue = constrain(speed, 0, 255);
+        // The PID interrupt sets the speed too; save and restore SREG so this
+        // also works from inside it.
+        uint8_t oldSREG = SREG;
+        cli();
+        compareRegister() = (uint8_t)pwmValue;
+        currentSpeed = pwmValue;
+        SREG = oldSREG;
+    }
+
+    int getSpeed() {
+        uint8_t oldSREG = SREG;
+        cli();
+        int speed = currentSpeed;
+        SREG = oldSREG;
+        return speed;
+    }
+
+private:
+    volatile int currentSpeed; // Written by the PID interrupt
+
+    static volatile uint8_t& compareRegister() {
+        return PIN == 11 ? OCR2A : OCR2B;
+    }
+};
+
+typedef FastMotor<CONVEYOR_MOTOR_PWM_PIN> ConveyorMotor;
+
+#endif
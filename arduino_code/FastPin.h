@@ -0,0 +1,56 @@
+#ifndef FAST_PIN_H
+#define FAST_PIN_H
+
+#include <Arduino.h>
+
+// Direct port access for a pin fixed at compile time (ATmega328P / Arduino Uno).
+// The pin-to-port mapping is resolved by the compiler, so read(), high() and
+// low() compile to single sbis/sbi/cbi instructions instead of the table
+// lookups of digitalRead()/digitalWrite() (~50 cycles each).
+//   Pins 0-7  -> port D, bit PIN
+//   Pins 8-13 -> port B, bit PIN - 8
+//   Pins 14-19 (A0-A5) -> port C, bit PIN - 14
+template <uint8_t PIN>
+class FastPin {
+public:
+    static_assert(PIN <= 19, "FastPin only knows the ATmega328P pins 0-19");
+
+    static const uint8_t BIT = PIN < 8 ? PIN : (PIN < 14 ? PIN - 8 : PIN - 14);
+    static const uint8_t MASK = 1 << BIT;
+    static const bool ON_PORT_D = PIN < 8; // Served by the PCINT2 vector
+
+    static volatile uint8_t& inputRegister() {
+        return PIN < 8 ? PIND : (PIN < 14 ? PINB : PINC);
+    }
+
+    static volatile uint8_t& outputRegister() {
+        return PIN < 8 ? PORTD : (PIN < 14 ? PORTB : PORTC);
+    }
+
+    static volatile uint8_t& directionRegister() {
+        return PIN < 8 ? DDRD : (PIN < 14 ? DDRB : DDRC);
+    }
+
+    static void setOutput() {
+        directionRegister() |= MASK;
+    }
+
+    static void setInputPullup() {
+        directionRegister() &= ~MASK;
+        outputRegister() |= MASK;
+    }
+
+    static bool read() {
+        return (inputRegister() & MASK) != 0;
+    }
+
+    static void high() {
+        outputRegister() |= MASK;
+    }
+
+    static void low() {
+        outputRegister() &= ~MASK;
+    }
+};
+
+#endif
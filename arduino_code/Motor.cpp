@@ -1,6 +1,6 @@
 #include "Motor.h"
 
-Motor::Motor(int pwmPin) : pwmPin(pwmPin) {}
+Motor::Motor(int pwmPin) : pwmPin(pwmPin), currentSpeed(0) {}
 
 void Motor::setup() {
     pinMode(pwmPin, OUTPUT);
@@ -12,4 +12,9 @@ void Motor::setSpeed(int speed) {
     // Lo limitamos por seguridad y lo escribimos directamente al pin PWM.
     int pwmValue = constrain(speed, 0, 255);
     analogWrite(pwmPin, pwmValue);
+    currentSpeed = pwmValue;
+}
+
+int Motor::getSpeed() {
+    return currentSpeed;
 }
@@ -8,9 +8,11 @@ public:
     Motor(int pwmPin);
     void setup();
     void setSpeed(int speed);
+    int getSpeed();
 
 private:
     int pwmPin;
+    int currentSpeed;
 };
 
 #endif
\ No newline at end of file
@@ -2,15 +2,96 @@
 #define OBSTACLE_SENSOR_H
 
 #include <Arduino.h>
+#include "config.h"
+#include "FastPin.h"
+#include "SpscQueue.h"
+#include "RpmSensor.h"
 
+// One edge of the obstacle sensor, stamped with time and belt position in the pin-change ISR.
+struct ObstacleEvent {
+    unsigned long timestampUs;
+    unsigned long tick; // Encoder tick count at the edge
+    uint8_t state;      // 1 = obstacle present
+};
+
+// IR obstacle sensor on a pin fixed at compile time, so the ISR reads the port
+// register directly. The pin-change ISR itself lives in ObstacleSensor.cpp and
+// serves OBSTACLE_IR_SENSOR_PIN; only that one sensor is supported in interrupt mode.
+template <uint8_t PIN>
 class ObstacleSensor {
 public:
-    ObstacleSensor(int sensorPin);
-    void setup();
-    int getState();
+    static_assert(!OBSTACLE_INTERRUPT_MODE || FastPin<PIN>::ON_PORT_D,
+                  "In interrupt mode the obstacle sensor must be on port D (pins 0-7)");
+
+    void setup() {
+        FastPin<PIN>::setInputPullup(); // Use internal pull-up
+
+        if (OBSTACLE_INTERRUPT_MODE) {
+            _lastState = readState();
+
+            // Enable the pin-change interrupt for this pin only.
+            *digitalPinToPCMSK(PIN) |= _BV(digitalPinToPCMSKbit(PIN));
+            PCIFR = _BV(digitalPinToPCICRbit(PIN)); // Clear a stale flag
+            *digitalPinToPCICR(PIN) |= _BV(digitalPinToPCICRbit(PIN));
+        }
+    }
+
+    int getState() {
+        if (OBSTACLE_INTERRUPT_MODE) {
+            return _lastState; // Kept up to date by the ISR
+        }
+        return readState();
+    }
+
+    // Interrupt mode only: takes the oldest pending edge event, if any.
+    bool popEvent(ObstacleEvent& event) {
+        return _events.pop(event);
+    }
+
+    uint8_t getDroppedEventCount() {
+        return _events.getDroppedCount();
+    }
+
+    // Edges seen by the ISR since boot. Wraps at 2^16.
+    static uint16_t getEdgeCount() {
+        uint8_t oldSREG = SREG;
+        cli();
+        uint16_t count = _edgeCount;
+        SREG = oldSREG;
+        return count;
+    }
+
+    // Called from the pin-change ISR
+    static void handlePinChange() {
+        uint8_t state = readState();
+        if (state == _lastState) {
+            return; // Another pin on the same port changed
+        }
+        _lastState = state;
+        _edgeCount++;
+        ObstacleEvent event = { micros(), RpmSensor::getTickCount(), state };
+        _events.push(event);
+    }
 
 private:
-    int _sensorPin;
+    // Shared with the ISR
+    static volatile uint8_t _lastState;
+    static volatile uint16_t _edgeCount;
+    static SpscQueue<ObstacleEvent, OBSTACLE_EVENT_QUEUE_SIZE> _events;
+
+    static uint8_t readState() {
+        // Assuming the sensor is LOW when an obstacle is present
+        return FastPin<PIN>::read() ? 0 : 1;
+    }
 };
 
+template <uint8_t PIN>
+volatile uint8_t ObstacleSensor<PIN>::_lastState = 0;
+template <uint8_t PIN>
+volatile uint16_t ObstacleSensor<PIN>::_edgeCount = 0;
+template <uint8_t PIN>
+SpscQueue<ObstacleEvent, OBSTACLE_EVENT_QUEUE_SIZE> ObstacleSensor<PIN>::_events;
+
+typedef ObstacleSensor<OBSTACLE_IR_SENSOR_PIN> ConveyorObstacleSensor;
+
 #endif
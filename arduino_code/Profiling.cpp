@@ -0,0 +1,12 @@
+#include "Profiling.h"
+
+// Provided by avr-libc: start of the heap and the current end of it (0 until
+// the first malloc()).
+extern char __heap_start;
+extern char* __brkval;
+
+unsigned int freeSram() {
+    char stackTop;
+    char* heapEnd = (__brkval == 0) ? &__heap_start : __brkval;
+    return (unsigned int)(&stackTop - heapEnd);
+}
@@ -0,0 +1,36 @@
+#ifndef PROFILING_H
+#define PROFILING_H
+
+#include <Arduino.h>
+
+// Snapshot of the firmware's timing and health counters, sent to the PC in a
+// STATS frame. Times are in microseconds (micros() resolution, 4 us on a
+// 16 MHz Uno) and saturate at 0xFFFF; counters wrap.
+struct ProfileStats {
+    uint16_t loopMinUs;      // Shortest, longest and mean pass of loop()
+    uint16_t loopMaxUs;
+    uint16_t loopMeanUs;
+    uint32_t loopCount;
+    uint32_t encoderPulses;  // Encoder ISR calls (the belt tick count)
+    uint16_t obstacleEdges;  // Obstacle pin-change ISR edges
+    uint16_t timerTicks;     // Timer0 compare ISR calls (1 kHz)
+    uint16_t rxOverflows;    // Times the serial RX buffer was found full
+    uint16_t lineOverflows;
+    uint16_t parseErrors;
+    uint16_t crcErrors;
+    uint16_t maxParseUs;     // Longest Communication::handleSerial()
+    uint16_t freeSram;       // Bytes between the heap and the stack
+    uint8_t droppedEvents;   // Obstacle events lost to a full queue
+};
+
+// Bytes of a STATS frame payload, in the field order of ProfileStats.
+const uint8_t PROFILE_STATS_PAYLOAD = 31;
+
+// Free SRAM between the top of the heap and the current stack pointer.
+unsigned int freeSram();
+
+inline uint16_t saturateUint16(unsigned long value) {
+    return value > 0xFFFF ? 0xFFFF : (uint16_t)value;
+}
+
+#endif
@@ -0,0 +1,55 @@
+#include "Protocol.h"
+#include "Profiling.h"
+
+uint8_t protocolPayloadSize(uint8_t frameType) {
+    switch (frameType) {
+        case FRAME_TYPE_HELLO:
+            return 2;
+        case FRAME_TYPE_COMMAND:
+            return 2;
+        case FRAME_TYPE_SET_RPM:
+            return 2;
+        case FRAME_TYPE_SET_GAINS:
+            return 6;
+        case FRAME_TYPE_SCHEDULE:
+            return 7;
+        case FRAME_TYPE_QUERY_STATS:
+            return 1;
+        case FRAME_TYPE_SET_BIN_TABLE:
+            return BIN_TABLE_PAYLOAD;
+        case FRAME_TYPE_QUERY_CAPS:
+            return 1;
+        case FRAME_TYPE_HELLO_ACK:
+            return 6;
+        case FRAME_TYPE_TELEMETRY:
+            return 11;
+        case FRAME_TYPE_TELEMETRY_BATCH:
+            return TELEMETRY_BATCH_PAYLOAD;
+        case FRAME_TYPE_OBSTACLE_EVENT:
+            return 9;
+        case FRAME_TYPE_ACTION_EVENT:
+            return 8;
+        case FRAME_TYPE_STATS:
+            return PROFILE_STATS_PAYLOAD;
+        case FRAME_TYPE_BIN_TABLE_ACK:
+            return 2;
+        case FRAME_TYPE_CAPS:
+            return 12;
+        default:
+            return PROTOCOL_INVALID_SIZE;
+    }
+}
+
+long protocolBaudRate(uint8_t baudCode) {
+    // 250k, 500k and 1M divide 16 MHz exactly; 115200 is the widely supported fallback.
+    static const long rates[BAUD_CODE_COUNT] = { 0, 115200, 250000, 500000, 1000000 };
+    return baudCode < BAUD_CODE_COUNT ? rates[baudCode] : 0;
+}
+
+uint8_t crc8Update(uint8_t crc, uint8_t data) {
+    crc ^= data;
+    for (uint8_t i = 0; i < 8; i++) {
+        crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x07) : (uint8_t)(crc << 1);
+    }
+    return crc;
+}
@@ -0,0 +1,101 @@
+#ifndef PROTOCOL_H
+#define PROTOCOL_H
+
+#include <Arduino.h>
+
+// =================================================================
+// ==                  BINARY FRAME PROTOCOL                      ==
+// =================================================================
+// Frame layout: [SYNC][TYPE][PAYLOAD ...][CRC8]
+// Every frame type has a fixed payload size, so no length byte is sent.
+// The CRC-8 (polynomial 0x07, init 0x00) covers TYPE and PAYLOAD.
+// The sync byte is above 0x7F, so it can never appear inside a line of
+// the legacy ASCII protocol ("PWM_SERVO\n"), which stays available as a fallback.
+// Multi-byte fields are little-endian.
+// =================================================================
+
+const uint8_t FRAME_SYNC_BYTE = 0xA5;
+const uint8_t PROTOCOL_VERSION = 7;
+
+// --- Host -> Device ---
+const uint8_t FRAME_TYPE_HELLO = 0x01;          // [version][baudCode]
+const uint8_t FRAME_TYPE_COMMAND = 0x02;        // [pwm][servoCode]
+const uint8_t FRAME_TYPE_SET_RPM = 0x03;        // [rpm u16], 0 returns to open-loop PWM
+const uint8_t FRAME_TYPE_SET_GAINS = 0x04;      // [kp i16][ki i16][kd i16], Q8.8
+const uint8_t FRAME_TYPE_SCHEDULE = 0x05;       // [partId u16][servoCode][detectionTick u32]
+const uint8_t FRAME_TYPE_QUERY_STATS = 0x06;    // [flags], see STATS_FLAG_*
+const uint8_t FRAME_TYPE_SET_BIN_TABLE = 0x07;  // [binCount][angle x BIN_TABLE_MAX_BINS][bin x BIN_TABLE_CLASSES]
+const uint8_t FRAME_TYPE_QUERY_CAPS = 0x08;    // [version]
+
+// --- Device -> Host ---
+const uint8_t FRAME_TYPE_HELLO_ACK = 0x81;      // [version][acceptedBaudCode][deviceId u32]
+const uint8_t FRAME_TYPE_TELEMETRY = 0x82;      // [rpm u16][status][timestampUs u32][tick u32], see TELEMETRY_STATUS_*
+const uint8_t FRAME_TYPE_TELEMETRY_BATCH = 0x83; // [count][TELEMETRY_BATCH_SAMPLES x sample]
+const uint8_t FRAME_TYPE_OBSTACLE_EVENT = 0x84; // [timestampUs u32][tick u32][obstacleState]
+const uint8_t FRAME_TYPE_ACTION_EVENT = 0x85;   // [partId u16][servoCode][status][tick u32]
+const uint8_t FRAME_TYPE_STATS = 0x86;          // ProfileStats, see Profiling.h
+const uint8_t FRAME_TYPE_BIN_TABLE_ACK = 0x87;  // [status][tableCrc], status 0 = accepted
+const uint8_t FRAME_TYPE_CAPS = 0x88;          // [version][flags][baudCode][pendingActions][tick u32][deviceId u32], see CAPS_FLAG_*
+
+// Servo code in a COMMAND frame that leaves the servo where it is, so the PC's
+// heartbeat does not override scheduled actions.
+const uint8_t SERVO_CODE_KEEP = 0xFF;
+
+// Status of an ACTION_EVENT.
+const uint8_t ACTION_STATUS_ON_TIME = 0;
+const uint8_t ACTION_STATUS_LATE = 1;       // The gate tick had already passed when it was scheduled
+const uint8_t ACTION_STATUS_DROPPED = 2;    // The queue was full
+
+// QUERY_STATS flag: restart the min/max measurements after reporting them.
+const uint8_t STATS_FLAG_RESET = 0x01;
+
+// Flags of a CAPS frame. QUERY_CAPS is answered in any mode and at once, so a
+// host that reopens the port can tell within milliseconds whether the board
+// kept running and resume a binary session without a new HELLO.
+const uint8_t CAPS_FLAG_BINARY = 0x01;      // The binary protocol is active, at the rate of baudCode
+const uint8_t CAPS_FLAG_STAY_ALIVE = 0x02;  // Host outages are ridden out, see STAY_ALIVE_MODE
+const uint8_t CAPS_FLAG_LINK_LOST = 0x04;   // The heartbeat timed out since the last HELLO or QUERY_CAPS
+
+// --- Bin Table ---
+// Class codes (the servo code of COMMAND and SCHEDULE) index a table of bins,
+// and each bin has a servo angle. Classes in BIN_HOME send the servo home.
+const uint8_t BIN_TABLE_MAX_BINS = 8;
+const uint8_t BIN_TABLE_CLASSES = 16;
+const uint8_t BIN_HOME = 0xFF;
+const uint8_t BIN_TABLE_PAYLOAD = 1 + BIN_TABLE_MAX_BINS + BIN_TABLE_CLASSES;
+const uint8_t BIN_TABLE_EEPROM_SIZE = BIN_TABLE_PAYLOAD + 2; // Plus magic and CRC
+const uint8_t BIN_TABLE_STATUS_OK = 0;
+const uint8_t BIN_TABLE_STATUS_INVALID = 1;
+
+// Binary telemetry pairs every sample with micros() and the encoder tick count,
+// so the host can tell the belt position at the moment a frame was captured.
+// Status bits of telemetry samples. ASCII telemetry only carries the obstacle state.
+const uint8_t TELEMETRY_STATUS_OBSTACLE = 0x01;
+const uint8_t TELEMETRY_STATUS_SERVO_READY = 0x02; // The diverter reached its target and settled
+
+// --- Telemetry Batch ---
+// Each sample is [timestampUs u32][tick u32][rpm u16][status u8][pwm u8].
+// Unused trailing samples (index >= count) are zero.
+const uint8_t TELEMETRY_BATCH_SAMPLES = 8;
+const uint8_t TELEMETRY_SAMPLE_SIZE = 12;
+const uint8_t TELEMETRY_BATCH_PAYLOAD = 1 + TELEMETRY_BATCH_SAMPLES * TELEMETRY_SAMPLE_SIZE;
+
+// --- Baud Rate Codes ---
+// Sent in HELLO to request a faster link. Code 0 keeps the current rate.
+const uint8_t BAUD_CODE_KEEP = 0;
+const uint8_t BAUD_CODE_COUNT = 5;
+
+// Largest Host -> Device payload; sizes the receive buffer.
+const uint8_t PROTOCOL_MAX_PAYLOAD = BIN_TABLE_PAYLOAD;
+const uint8_t PROTOCOL_INVALID_SIZE = 0xFF;
+
+// Returns the payload size for a frame type, or PROTOCOL_INVALID_SIZE if unknown.
+uint8_t protocolPayloadSize(uint8_t frameType);
+
+// Returns the baud rate for a baud code, or 0 for BAUD_CODE_KEEP and unknown codes.
+long protocolBaudRate(uint8_t baudCode);
+
+// Folds one byte into a running CRC-8.
+uint8_t crc8Update(uint8_t crc, uint8_t data);
+
+#endif
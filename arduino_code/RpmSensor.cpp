@@ -2,6 +2,13 @@
 
 // Initialize static members
 volatile unsigned long RpmSensor::_pulseCount = 0;
+volatile unsigned long RpmSensor::_tickCount = 0;
+volatile unsigned long RpmSensor::_lastPulseUs = 0;
+volatile unsigned long RpmSensor::_periodSum = 0;
+volatile unsigned long RpmSensor::_periods[RPM_PERIOD_AVERAGE_SAMPLES] = { 0 };
+volatile uint8_t RpmSensor::_periodIndex = 0;
+volatile uint8_t RpmSensor::_periodSamples = 0;
+volatile bool RpmSensor::_hasLastPulse = false;
 
 RpmSensor::RpmSensor(int sensorPin, int pulsesPerRevolution) {
     _sensorPin = sensorPin;
@@ -16,22 +23,111 @@ void RpmSensor::setup() {
 }
 
 void RpmSensor::update() {
+    if (RPM_PERIOD_MODE) {
+        updateFromPeriod();
+    } else {
+        updateFromPulseCount();
+    }
+}
+
+void RpmSensor::updateFromPulseCount() {
     unsigned long currentTime = millis();
     if (currentTime - _lastRpmTime >= 1000) { // Calculate RPM every second
-        detachInterrupt(digitalPinToInterrupt(_sensorPin)); // Safely read pulseCount
-        
-        _currentRpm = (_pulseCount / (float)_pulsesPerRevolution) * 60.0;
+        // Read and reset atomically; the interrupt stays attached so no pulse is lost.
+        noInterrupts();
+        unsigned long pulses = _pulseCount;
         _pulseCount = 0; // Reset for the next second
-        
+        interrupts();
+
+        _currentRpm = (pulses / (float)_pulsesPerRevolution) * 60.0;
         _lastRpmTime = currentTime;
-        attachInterrupt(digitalPinToInterrupt(_sensorPin), countPulse, RISING); // Re-attach interrupt
     }
 }
 
+void RpmSensor::updateFromPeriod() {
+    noInterrupts();
+    unsigned long lastPulseUs = _lastPulseUs;
+    bool hasLastPulse = _hasLastPulse;
+    interrupts();
+
+    if (hasLastPulse && micros() - lastPulseUs > RPM_STALL_TIMEOUT_US) {
+        // The belt stopped. Forget the old periods so that the very long gap
+        // before the next pulse is not averaged into the new speed.
+        noInterrupts();
+        // Check again: a pulse may have arrived since the first read.
+        if (_hasLastPulse && micros() - _lastPulseUs > RPM_STALL_TIMEOUT_US) {
+            _hasLastPulse = false;
+            _periodSamples = 0;
+            _periodSum = 0;
+            for (uint8_t i = 0; i < RPM_PERIOD_AVERAGE_SAMPLES; i++) {
+                _periods[i] = 0;
+            }
+        }
+        interrupts();
+    }
+
+    unsigned long periodUs = getPeriodUs();
+    _currentRpm = periodUs == 0 ? 0.0 : 60000000.0 / ((float)periodUs * _pulsesPerRevolution);
+}
+
+unsigned long RpmSensor::getPeriodUs() {
+    // Save and restore SREG instead of noInterrupts()/interrupts() so this
+    // does not re-enable interrupts when called from inside an ISR.
+    uint8_t oldSREG = SREG;
+    cli();
+    unsigned long periodSum = _periodSum;
+    uint8_t samples = _periodSamples;
+    unsigned long lastPulseUs = _lastPulseUs;
+    bool hasLastPulse = _hasLastPulse;
+    SREG = oldSREG;
+
+    if (!hasLastPulse || samples == 0) {
+        return 0; // Stopped, or only one pulse so far
+    }
+    unsigned long sinceLastPulse = micros() - lastPulseUs;
+    if (sinceLastPulse > RPM_STALL_TIMEOUT_US) {
+        return 0;
+    }
+
+    // A gap longer than the average means the belt is slowing down right now.
+    unsigned long periodUs = periodSum / samples;
+    return sinceLastPulse > periodUs ? sinceLastPulse : periodUs;
+}
+
+unsigned int RpmSensor::getRpmFromPeriod() {
+    unsigned long periodUs = getPeriodUs();
+    if (periodUs == 0) {
+        return 0;
+    }
+    return (unsigned int)(60000000UL / (periodUs * (unsigned long)_pulsesPerRevolution));
+}
+
+unsigned long RpmSensor::getTickCount() {
+    uint8_t oldSREG = SREG;
+    cli();
+    unsigned long ticks = _tickCount;
+    SREG = oldSREG;
+    return ticks;
+}
+
 float RpmSensor::getRpm() {
     return _currentRpm;
 }
 
 void RpmSensor::countPulse() {
     _pulseCount++;
+    _tickCount++;
+
+    unsigned long now = micros();
+    if (_hasLastPulse) {
+        unsigned long period = now - _lastPulseUs;
+        _periodSum += period - _periods[_periodIndex];
+        _periods[_periodIndex] = period;
+        _periodIndex = (_periodIndex + 1) & (RPM_PERIOD_AVERAGE_SAMPLES - 1);
+        if (_periodSamples < RPM_PERIOD_AVERAGE_SAMPLES) {
+            _periodSamples++;
+        }
+    }
+    _lastPulseUs = now;
+    _hasLastPulse = true;
 }
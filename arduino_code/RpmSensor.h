@@ -2,6 +2,7 @@
 #define RPM_SENSOR_H
 
 #include <Arduino.h>
+#include "config.h"
 
 class RpmSensor {
 public:
@@ -11,12 +12,34 @@ public:
     float getRpm();
     static void countPulse(); // Needs to be static for ISR
 
+    // Period mode only: the averaged pulse period in microseconds, or 0 if the
+    // belt is stopped. Safe to call from an ISR.
+    static unsigned long getPeriodUs();
+    // Integer RPM computed from getPeriodUs(), for fixed-point control loops.
+    unsigned int getRpmFromPeriod();
+    // Running count of encoder pulses since boot, i.e. belt position. Wraps at 2^32.
+    // Safe to call from an ISR.
+    static unsigned long getTickCount();
+
 private:
     int _sensorPin;
     int _pulsesPerRevolution;
     unsigned long _lastRpmTime;
     float _currentRpm;
     static volatile unsigned long _pulseCount; // Static for ISR
+    static volatile unsigned long _tickCount;  // Never reset, unlike _pulseCount
+
+    // Period mode: the ISR timestamps every pulse and keeps a moving sum of the
+    // last RPM_PERIOD_AVERAGE_SAMPLES inter-pulse periods.
+    static volatile unsigned long _lastPulseUs;
+    static volatile unsigned long _periodSum;
+    static volatile unsigned long _periods[RPM_PERIOD_AVERAGE_SAMPLES];
+    static volatile uint8_t _periodIndex;
+    static volatile uint8_t _periodSamples;
+    static volatile bool _hasLastPulse;
+
+    void updateFromPulseCount();
+    void updateFromPeriod();
 };
 
 #endif
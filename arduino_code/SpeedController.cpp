@@ -0,0 +1,124 @@
+#include "config.h"
+#include "SpeedController.h"
+
+static const long PID_TERM_LIMIT = 1L << 29;
+
+SpeedController* SpeedController::_instance = 0;
+volatile uint16_t SpeedController::_interruptCount = 0;
+
+SpeedController::SpeedController(ConveyorMotor* motor, RpmSensor* rpmSensor) {
+    _motor = motor;
+    _rpmSensor = rpmSensor;
+    _setpoint = 0;
+    _kp = PID_DEFAULT_KP;
+    _ki = PID_DEFAULT_KI;
+    _kd = PID_DEFAULT_KD;
+    _integral = 0;
+    _integralLimit = integralLimit(_ki);
+    _lastRpm = 0;
+    _ticksSinceUpdate = 0;
+}
+
+void SpeedController::setup() {
+    _instance = this;
+    // Timer0 already overflows every ~1 ms for millis(). A compare match half
+    // way through gives us a 1 kHz interrupt without touching its configuration.
+    // Pin 6 (OC0A) must not be used for analogWrite() as a consequence.
+    OCR0A = 0x80;
+    TIMSK0 |= _BV(OCIE0A);
+}
+
+void SpeedController::setSetpoint(unsigned int rpm) {
+    uint8_t oldSREG = SREG;
+    cli();
+    if (_setpoint == 0 && rpm != 0) {
+        reset(); // Bumpless start from a clean state
+    }
+    _setpoint = rpm;
+    SREG = oldSREG;
+    if (rpm == 0) {
+        _motor->setSpeed(0);
+    }
+}
+
+unsigned int SpeedController::getSetpoint() {
+    return _setpoint;
+}
+
+bool SpeedController::isEnabled() {
+    return _setpoint != 0;
+}
+
+void SpeedController::setGains(int kp, int ki, int kd) {
+    uint8_t oldSREG = SREG;
+    cli();
+    _kp = kp;
+    _ki = ki;
+    _kd = kd;
+    _integralLimit = integralLimit(ki);
+    _integral = constrain(_integral, -_integralLimit, _integralLimit);
+    SREG = oldSREG;
+}
+
+long SpeedController::integralLimit(int ki) {
+    // Any larger integral would saturate the output on its own and wind up;
+    // with KI = 0 the integral has no effect and stays at zero.
+    return ki == 0 ? 0 : PID_FULL_SCALE / abs(ki);
+}
+
+void SpeedController::reset() {
+    _integral = 0;
+    _lastRpm = (int)_rpmSensor->getRpmFromPeriod();
+    _ticksSinceUpdate = 0;
+}
+
+uint16_t SpeedController::getInterruptCount() {
+    uint8_t oldSREG = SREG;
+    cli();
+    uint16_t count = _interruptCount;
+    SREG = oldSREG;
+    return count;
+}
+
+void SpeedController::handleTimerInterrupt() {
+    _interruptCount++;
+    if (_instance != 0) {
+        _instance->tick();
+    }
+}
+
+void SpeedController::tick() {
+    if (++_ticksSinceUpdate < PID_PERIOD_MS) {
+        return;
+    }
+    _ticksSinceUpdate = 0;
+    if (_setpoint == 0) {
+        return;
+    }
+
+    int rpm = (int)_rpmSensor->getRpmFromPeriod();
+    long error = (long)_setpoint - rpm;
+
+    // Tentatively integrate; undone below if the output is saturated (anti-windup).
+    long previousIntegral = _integral;
+    _integral = constrain(_integral + error, -_integralLimit, _integralLimit);
+
+    // Derivative on the measurement, so setpoint changes do not kick the output.
+    long derivative = (long)rpm - _lastRpm;
+    _lastRpm = rpm;
+
+    // Each product fits a long for any 16-bit gain, but their sum may not.
+    // Bounded to 2^29, thousands of times the full PWM range, the sum does.
+    long proportional = constrain((long)_kp * error, -PID_TERM_LIMIT, PID_TERM_LIMIT);
+    long damping = constrain((long)_kd * derivative, -PID_TERM_LIMIT, PID_TERM_LIMIT);
+    long output = (proportional + (long)_ki * _integral - damping) >> PID_GAIN_SHIFT;
+    if ((output > 255 && error > 0) || (output < 0 && error < 0)) {
+        _integral = previousIntegral;
+    }
+
+    _motor->setSpeed((int)constrain(output, 0L, 255L));
+}
+
+ISR(TIMER0_COMPA_vect) {
+    SpeedController::handleTimerInterrupt();
+}
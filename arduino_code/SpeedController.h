@@ -0,0 +1,51 @@
+#ifndef SPEED_CONTROLLER_H
+#define SPEED_CONTROLLER_H
+
+#include <Arduino.h>
+#include "FastMotor.h"
+#include "RpmSensor.h"
+
+// Closed-loop PID speed control of the conveyor motor.
+// The loop runs every PID_PERIOD_MS from a Timer0 compare-match interrupt, so
+// its timing does not depend on loop() or on the USB round trip to the PC.
+// All arithmetic is integer: gains are Q8.8 fixed point (256 = 1.0) and the
+// speed is in whole RPM taken from the period-based RpmSensor.
+class SpeedController {
+public:
+    SpeedController(ConveyorMotor* motor, RpmSensor* rpmSensor);
+    void setup();
+
+    // A setpoint of 0 disables the loop and stops the motor; the PWM sent by
+    // the PC is then used again.
+    void setSetpoint(unsigned int rpm);
+    unsigned int getSetpoint();
+    bool isEnabled();
+    void setGains(int kp, int ki, int kd);
+
+    static void handleTimerInterrupt(); // Called from the Timer0 ISR
+    // Timer interrupts since boot. Wraps at 2^16.
+    static uint16_t getInterruptCount();
+
+private:
+    ConveyorMotor* _motor;
+    RpmSensor* _rpmSensor;
+
+    // Shared with the ISR
+    volatile unsigned int _setpoint;
+    volatile int _kp;
+    volatile int _ki;
+    volatile int _kd;
+    long _integral;
+    long _integralLimit; // Keeps KI * integral within the full PWM range at the current KI
+    int _lastRpm;
+    uint8_t _ticksSinceUpdate;
+
+    static SpeedController* _instance;
+    static volatile uint16_t _interruptCount;
+
+    void tick();
+    static long integralLimit(int ki);
+    void reset();
+};
+
+#endif
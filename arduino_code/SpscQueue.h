@@ -0,0 +1,57 @@
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <Arduino.h>
+
+// Lock-free single-producer/single-consumer ring buffer for handing data from
+// an ISR to the main loop (or the other way round) without disabling interrupts.
+// Indices are 8-bit, so every access to them is atomic on AVR.
+// CAPACITY must be a power of two no larger than 128; one slot is kept free to
+// tell a full queue from an empty one.
+template <typename T, uint8_t CAPACITY>
+class SpscQueue {
+public:
+    SpscQueue() : _head(0), _tail(0), _dropped(0) {}
+
+    // Producer side. Returns false (and counts a drop) if the queue is full.
+    bool push(const T& item) {
+        uint8_t head = _head;
+        uint8_t next = (head + 1) & (CAPACITY - 1);
+        if (next == _tail) {
+            _dropped++;
+            return false;
+        }
+        _items[head] = item;
+        __asm__ __volatile__("" ::: "memory"); // Publish the item before the index.
+        _head = next;
+        return true;
+    }
+
+    // Consumer side. Returns false if the queue is empty.
+    bool pop(T& item) {
+        uint8_t tail = _tail;
+        if (tail == _head) {
+            return false;
+        }
+        item = _items[tail];
+        __asm__ __volatile__("" ::: "memory"); // Read the item before releasing the slot.
+        _tail = (tail + 1) & (CAPACITY - 1);
+        return true;
+    }
+
+    bool isEmpty() const {
+        return _head == _tail;
+    }
+
+    uint8_t getDroppedCount() const {
+        return _dropped;
+    }
+
+private:
+    volatile uint8_t _head;
+    volatile uint8_t _tail;
+    volatile uint8_t _dropped;
+    T _items[CAPACITY];
+};
+
+#endif
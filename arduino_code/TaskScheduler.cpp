@@ -0,0 +1,100 @@
+#include "TaskScheduler.h"
+
+TaskScheduler::TaskScheduler(Task* tasks, uint8_t taskCount) {
+    _tasks = tasks;
+    _taskCount = taskCount;
+    _passCount = 0;
+    resetStats();
+}
+
+void TaskScheduler::setup() {
+    unsigned long now = micros();
+    for (uint8_t i = 0; i < _taskCount; i++) {
+        _tasks[i].nextRunUs = now;
+    }
+    resetStats();
+}
+
+void TaskScheduler::runPending() {
+    unsigned long passStartUs = micros();
+
+    for (uint8_t i = 0; i < _taskCount; i++) {
+        Task& task = _tasks[i];
+        unsigned long startUs = micros();
+
+        if (task.periodUs != 0) {
+            long lateUs = (long)(startUs - task.nextRunUs); // Signed, survives micros() wrap
+            if (lateUs < 0) {
+                continue; // Not due yet
+            }
+            if ((unsigned long)lateUs >= task.periodUs) {
+                task.overruns++;
+                task.nextRunUs = startUs + task.periodUs;
+            } else {
+                task.nextRunUs += task.periodUs;
+            }
+        }
+
+        task.run();
+
+        unsigned long runUs = micros() - startUs;
+        if (runUs > task.maxRunUs) {
+            task.maxRunUs = runUs;
+        }
+    }
+
+    unsigned long passUs = micros() - passStartUs;
+    if (passUs < _minPassUs) {
+        _minPassUs = passUs;
+    }
+    if (passUs > _maxPassUs) {
+        _maxPassUs = passUs;
+    }
+    if (_passSumUs > 0x7FFFFFFFUL) {
+        // Halve the window rather than overflow; the mean stays the same.
+        _passSumUs >>= 1;
+        _passSamples >>= 1;
+    }
+    _passSumUs += passUs;
+    _passSamples++;
+    _passCount++;
+}
+
+uint8_t TaskScheduler::getTaskCount() {
+    return _taskCount;
+}
+
+unsigned long TaskScheduler::getMaxRunUs(uint8_t index) {
+    return index < _taskCount ? _tasks[index].maxRunUs : 0;
+}
+
+unsigned int TaskScheduler::getOverrunCount(uint8_t index) {
+    return index < _taskCount ? _tasks[index].overruns : 0;
+}
+
+unsigned long TaskScheduler::getMinPassUs() {
+    return _passSamples > 0 ? _minPassUs : 0;
+}
+
+unsigned long TaskScheduler::getMaxPassUs() {
+    return _maxPassUs;
+}
+
+unsigned long TaskScheduler::getMeanPassUs() {
+    return _passSamples > 0 ? _passSumUs / _passSamples : 0;
+}
+
+unsigned long TaskScheduler::getPassCount() {
+    return _passCount;
+}
+
+void TaskScheduler::resetStats() {
+    _minPassUs = 0xFFFFFFFFUL;
+    _maxPassUs = 0;
+    _passSumUs = 0;
+    _passSamples = 0;
+    for (uint8_t i = 0; i < _taskCount; i++) {
+        _tasks[i].maxRunUs = 0;
+        _tasks[i].overruns = 0;
+    }
+}
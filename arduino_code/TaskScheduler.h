@@ -0,0 +1,47 @@
+#ifndef TASK_SCHEDULER_H
+#define TASK_SCHEDULER_H
+
+#include <Arduino.h>
+
+// One entry of the static task table. Only run and periodUs need a value in
+// the table; the remaining fields are bookkeeping filled in by the scheduler.
+struct Task {
+    void (*run)();
+    unsigned long periodUs;   // 0 = run on every pass of loop()
+    unsigned long nextRunUs;
+    unsigned long maxRunUs;   // Worst-case execution time seen
+    unsigned int overruns;    // Releases missed because the task started a full period late
+};
+
+// Cooperative scheduler for loop(). Tasks run to completion in table order,
+// each one when its period has elapsed on the micros() clock. Releases are
+// kept on a fixed grid (next = previous + period) so periodic tasks do not
+// drift; a task that falls a whole period behind counts an overrun and is
+// re-phased instead of being run several times in a row to catch up.
+class TaskScheduler {
+public:
+    TaskScheduler(Task* tasks, uint8_t taskCount);
+    void setup();
+    void runPending(); // Call from loop()
+
+    uint8_t getTaskCount();
+    unsigned long getMaxRunUs(uint8_t index);
+    unsigned int getOverrunCount(uint8_t index);
+    // Duration of a whole runPending() pass, i.e. of loop().
+    unsigned long getMinPassUs();
+    unsigned long getMaxPassUs();
+    unsigned long getMeanPassUs();
+    unsigned long getPassCount();
+    void resetStats();
+
+private:
+    Task* _tasks;
+    uint8_t _taskCount;
+    unsigned long _minPassUs;
+    unsigned long _maxPassUs;
+    unsigned long _passSumUs;    // Over _passSamples passes, for the mean
+    unsigned long _passSamples;
+    unsigned long _passCount;
+};
+
+#endif
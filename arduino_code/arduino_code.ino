@@ -1,26 +1,117 @@
 #include "config.h"
-#include "Motor.h"
+#include "FastMotor.h"
+#include "BinTable.h"
 #include "ClassifierServo.h"
 #include "RpmSensor.h"
 #include "ObstacleSensor.h"
+#include "SpeedController.h"
+#include "ActuationQueue.h"
 #include "Communication.h"
+#include "TaskScheduler.h"
+#include "Profiling.h"
 
 // --- Component Objects ---
-Motor conveyorMotor(CONVEYOR_MOTOR_PWM_PIN);
-ClassifierServo classifierServo(CLASSIFIER_SERVO_PIN);
+ConveyorMotor conveyorMotor;
+BinTable binTable;
+ClassifierServo classifierServo(&binTable);
 RpmSensor rpmSensor(CONVEYOR_ENCODER_PIN, ENCODER_PULSES_PER_REVOLUTION);
-ObstacleSensor obstacleSensor(OBSTACLE_IR_SENSOR_PIN);
-Communication serialCommunicator(SERIAL_BAUD_RATE, &conveyorMotor, &classifierServo);
+ConveyorObstacleSensor obstacleSensor;
+SpeedController speedController(&conveyorMotor, &rpmSensor);
+ActuationQueue actuationQueue(&classifierServo);
+Communication serialCommunicator(SERIAL_BAUD_RATE, &conveyorMotor, &classifierServo, &speedController, &actuationQueue, &binTable);
+
+// --- Tasks ---
+void serialInputTask() {
+    serialCommunicator.handleSerial();
+}
+
+void obstacleEventTask() {
+    ObstacleEvent event;
+    while (obstacleSensor.popEvent(event)) {
+        serialCommunicator.sendObstacleEvent(event);
+    }
+}
+
+void actuationTask() {
+    unsigned long tick = RpmSensor::getTickCount();
+    PendingAction action;
+    if (actuationQueue.update(tick, action)) {
+        serialCommunicator.sendActionEvent(action, tick);
+    }
+}
+
+void rpmTask() {
+    rpmSensor.update();
+}
+
+void telemetryTask() {
+    serialCommunicator.sendDataToPC(rpmSensor.getRpm(), obstacleSensor.getState());
+}
+
+void heartbeatTask() {
+    serialCommunicator.checkHeartbeat();
+}
+
+void binTablePersistTask() {
+    binTable.persistTask();
+}
+
+void statsTask();
+
+// Run in this order on every pass of loop() that they are due.
+Task tasks[] = {
+    { actuationTask, 0, 0, 0, 0 },
+    { obstacleEventTask, 0, 0, 0, 0 },
+    { serialInputTask, 0, 0, 0, 0 },
+    { rpmTask, RPM_TASK_PERIOD_US, 0, 0, 0 },
+    { telemetryTask, TELEMETRY_TASK_PERIOD_US, 0, 0, 0 },
+    { heartbeatTask, HEARTBEAT_TASK_PERIOD_US, 0, 0, 0 },
+    { statsTask, 0, 0, 0, 0 },
+    { binTablePersistTask, 0, 0, 0, 0 },
+};
+TaskScheduler scheduler(tasks, sizeof(tasks) / sizeof(tasks[0]));
+
+// Answers a QUERY_STATS frame. Defined after the table since it reads the scheduler.
+void statsTask() {
+    bool reset;
+    if (!serialCommunicator.takeStatsRequest(reset)) {
+        return;
+    }
+
+    ProfileStats stats;
+    stats.loopMinUs = saturateUint16(scheduler.getMinPassUs());
+    stats.loopMaxUs = saturateUint16(scheduler.getMaxPassUs());
+    stats.loopMeanUs = saturateUint16(scheduler.getMeanPassUs());
+    stats.loopCount = scheduler.getPassCount();
+    stats.encoderPulses = RpmSensor::getTickCount();
+    stats.obstacleEdges = ConveyorObstacleSensor::getEdgeCount();
+    stats.timerTicks = SpeedController::getInterruptCount();
+    stats.rxOverflows = serialCommunicator.getRxOverflowCount();
+    stats.lineOverflows = serialCommunicator.getLineOverflowCount();
+    stats.parseErrors = serialCommunicator.getParseErrorCount();
+    stats.crcErrors = serialCommunicator.getCrcErrorCount();
+    stats.maxParseUs = saturateUint16(serialCommunicator.getMaxParseTimeMicros());
+    stats.freeSram = freeSram();
+    stats.droppedEvents = obstacleSensor.getDroppedEventCount();
+    serialCommunicator.sendStats(stats);
+
+    if (reset) {
+        scheduler.resetStats();
+        serialCommunicator.resetMaxParseTime();
+    }
+}
 
 void setup() {
     conveyorMotor.setup();
+    binTable.setup();
     classifierServo.setup();
     rpmSensor.setup();
     obstacleSensor.setup();
+    speedController.setup();
     serialCommunicator.setup();
+    scheduler.setup();
 }
 
 void loop() {
-    rpmSensor.update();
-    serialCommunicator.update(rpmSensor.getRpm(), obstacleSensor.getState());
+    scheduler.runPending();
 }
@@ -11,18 +11,45 @@
 
 // --- Pin Definitions ---
 // Assigns microcontroller pins to different hardware components.
-// IMPORTANT: CONVEYOR_MOTOR_PWM_PIN was moved from 9 to 11 to avoid a timer conflict with the Servo library.
+// IMPORTANT: CONVEYOR_MOTOR_PWM_PIN was moved from 9 to 11 because Timer1 (pins 9 and 10) generates the servo pulses.
 const int CONVEYOR_MOTOR_PWM_PIN = 11;
-const int CLASSIFIER_SERVO_PIN = 10;
+const int CLASSIFIER_SERVO_PIN = 10;     // Must be 10 (OC1B), driven by Timer1 hardware PWM
 const int OBSTACLE_IR_SENSOR_PIN = 7;
 const int CONVEYOR_ENCODER_PIN = 2;      // Must be an interrupt-capable pin (e.g., 2 or 3 on Arduino Uno)
 
 
+// --- Obstacle Sensor ---
+// In interrupt mode every edge of the IR sensor is timestamped in a pin-change ISR
+// and pushed to the PC right away, instead of being polled once per loop().
+// The sensor pin must then be on port D (pins 0-7 on Arduino Uno).
+const bool OBSTACLE_INTERRUPT_MODE = true;
+const int OBSTACLE_EVENT_QUEUE_SIZE = 16;   // Pending edge events; must be a power of two.
+
+
 // --- Serial Communication ---
 // Configuration for the serial connection with the host computer.
 const long SERIAL_BAUD_RATE = 9600;
 const unsigned long SERIAL_SEND_INTERVAL_MS = 100;    // How often to send data (RPM, sensor state) to the PC.
-const unsigned long HEARTBEAT_TIMEOUT_MS = 2000;      // If no command is received from PC in this time, enter safe mode.
+// In event mode telemetry is sent when something changes instead of every SERIAL_SEND_INTERVAL_MS:
+// right away on an obstacle edge, on an RPM change of at least the deadband, and otherwise as a
+// slow keepalive. Batched high-speed telemetry is always continuous.
+const bool TELEMETRY_EVENT_MODE = true;
+const int TELEMETRY_RPM_DEADBAND = 2;                 // RPM change that triggers a send.
+const unsigned long TELEMETRY_MIN_INTERVAL_MS = 20;   // Rate limit for RPM-triggered sends; edges are never delayed.
+const unsigned long TELEMETRY_KEEPALIVE_MS = 500;     // Longest gap between two telemetry messages.
+const unsigned long TELEMETRY_SAMPLE_INTERVAL_US = 2000; // Sample period of batched telemetry in high-speed mode (500 Hz).
+const unsigned long HEARTBEAT_TIMEOUT_MS = 2000;      // If no command is received from PC in this time, the link is lost.
+// With STAY_ALIVE_MODE a lost link only starts a grace period: the belt keeps its speed, queued
+// servo moves keep firing on encoder ticks and the protocol mode is kept, so the parts in flight
+// are still sorted and a host that reopens the port resumes after a QUERY_CAPS. The safe state
+// (belt stopped, queue cleared, servo home) follows if the host stays away for LINK_LOSS_SAFE_STATE_MS.
+// Without it the safe state is entered as soon as the heartbeat times out.
+// The board only keeps running across a reopen of the port if its auto-reset on DTR is disabled
+// (cut the RESET-EN jumper, or 10 uF between RESET and GND; undo it to upload a sketch).
+const bool STAY_ALIVE_MODE = true;
+const unsigned long LINK_LOSS_SAFE_STATE_MS = 10000;
+const int SERIAL_LINE_BUFFER_SIZE = 16;               // Longest accepted ASCII command line ("255_9" needs 5).
+const int SERIAL_MAX_BYTES_PER_UPDATE = 32;           // Upper bound of bytes parsed per loop, keeps loop() time bounded.
 
 
 // --- Encoder & Motor Configuration ---
@@ -41,6 +68,51 @@ const int MOTOR_GEAR_RATIO = 30; // <-- CHANGE THIS TO MATCH YOUR MOTOR
 // Final calculation for pulses per full revolution of the output shaft.
 const int ENCODER_PULSES_PER_REVOLUTION = ENCODER_BASE_CPR * MOTOR_GEAR_RATIO;
 
+// --- RPM Measurement ---
+// In period mode the RPM comes from the time between encoder pulses, averaged
+// over the last few pulses, which gives a reading every few milliseconds.
+// Otherwise pulses are counted over a fixed 1 s window.
+const bool RPM_PERIOD_MODE = true;
+const int RPM_PERIOD_AVERAGE_SAMPLES = 8;            // Moving-average length; must be a power of two.
+const unsigned long RPM_STALL_TIMEOUT_US = 200000;   // No pulse for this long reads as 0 RPM.
+
+
+// --- Closed-Loop Speed Control ---
+// PID loop run on a timer interrupt once the PC sends an RPM setpoint.
+// Gains are Q8.8 fixed point (256 = 1.0) and can be changed from the PC at runtime.
+const int PID_PERIOD_MS = 10;                // Control period; the timer ticks at 1 kHz.
+const int PID_DEFAULT_KP = 384;              // 1.5 PWM steps per RPM of error
+const int PID_DEFAULT_KI = 16;               // 0.0625 PWM steps per RPM per period
+const int PID_DEFAULT_KD = 0;
+const int PID_GAIN_SHIFT = 8;                // Fractional bits of the gains.
+const long PID_FULL_SCALE = 255L << PID_GAIN_SHIFT; // Full PWM, in the units of the gain products.
+
+
+// --- Scheduled Servo Actuation ---
+// The PC classifies a part and asks for the servo to move once the belt has
+// advanced SERVO_GATE_OFFSET_TICKS encoder pulses past the tick at which the part
+// tripped the IR sensor. Several parts can be pending at once.
+// !!                  CALIBRATE THIS VALUE                     !!
+const unsigned long SERVO_GATE_OFFSET_TICKS = 960;  // IR sensor to diverter gate distance, in encoder pulses.
+const int ACTUATION_QUEUE_SIZE = 8;                 // Parts that can be in flight between sensor and gate.
+
+
+// --- Task Scheduler ---
+// Periods of the loop() tasks. Serial input, obstacle events and scheduled
+// servo moves are checked on every pass instead.
+const unsigned long RPM_TASK_PERIOD_US = 2000;
+const unsigned long TELEMETRY_TASK_PERIOD_US = TELEMETRY_SAMPLE_INTERVAL_US;
+const unsigned long HEARTBEAT_TASK_PERIOD_US = 100000;
+
+
+// --- Servo Motion ---
+// The servo moves along a minimum-jerk profile instead of jumping to the target.
+// Pulse limits match the Servo library defaults, so angles mean the same as before.
+const int SERVO_PULSE_MIN_US = 544;          // Pulse width at 0 degrees
+const int SERVO_PULSE_MAX_US = 2400;         // Pulse width at 180 degrees
+const int SERVO_MAX_SPEED_DEG_PER_S = 600;   // Peak speed of a move; keep at or below the servo rating (0.1 s/60 deg = 600).
+const int SERVO_SETTLE_MS = 60;              // Extra wait after a move before the arm reports ready.
+
 
 // --- Servo Positions ---
 // Defines the angle (in degrees) for the servo arm for each classification.
@@ -50,5 +122,15 @@ const int SERVO_POS_SQUARE = 90;
 const int SERVO_POS_CIRCLE = 150;
 const int SERVO_POS_UNKNOWN = 0;   // Home/default position.
 
+// Factory default angle of each diverter bin, used until the PC uploads a bin
+// table (see BinTable.h); class code N goes to bin N. Up to 8 bins.
+constexpr int SERVO_BIN_ANGLES[] = {
+    SERVO_POS_TRIANGLE,  // 0: 'TRIANGLE' or 'RED' or 'SMALL'
+    SERVO_POS_SQUARE,    // 1: 'SQUARE' or 'YELLOW' or 'MEDIUM'
+    SERVO_POS_CIRCLE     // 2: 'CIRCLE' or 'GREEN' or 'LARGE'
+};
+constexpr int SERVO_BIN_COUNT = sizeof(SERVO_BIN_ANGLES) / sizeof(SERVO_BIN_ANGLES[0]);
+const int BIN_TABLE_EEPROM_ADDRESS = 0;   // Where the uploaded bin table is kept.
+
 
 #endif // CONFIG_H
@@ -0,0 +1,95 @@
+"""Per-part stage latencies from the simulator's ground truth and the host's timestamps.
+
+Parts are identified by the encoder tick of their leading edge, which the
+firmware stamps into the OBSTACLE_EVENT, the host sends back in the SCHEDULE
+frame and the simulator logs with both.
+"""
+from typing import NamedTuple
+
+# Pipeline stages of one part, in order:
+#   uplink     IR edge -> the host read the obstacle event
+#   decision   event read -> classification decided and the SCHEDULE queued
+#   downlink   SCHEDULE queued -> the firmware read it
+#   slack      firmware read the SCHEDULE -> the part reached the gate (negative: late)
+#   actuation  the part reached the gate -> the firmware executed the move
+#   total      IR edge -> the firmware executed the move
+STAGES = ("uplink", "decision", "downlink", "slack", "actuation", "total")
+
+
+class PartTiming(NamedTuple):
+    part: int
+    edge_tick: int
+    on_time: bool
+    stages: dict  # Stage name -> seconds, None where the part never got that far
+
+
+def percentile(values: list[float], share: float) -> float:
+    """The share (0-1) percentile of values, interpolated between the closest ranks."""
+    ordered = sorted(values)
+    position = (len(ordered) - 1) * share
+    low = int(position)
+    high = min(low + 1, len(ordered) - 1)
+    return ordered[low] + (ordered[high] - ordered[low]) * (position - low)
+
+
+def _span(start: float | None, end: float | None) -> float | None:
+    return end - start if start is not None and end is not None else None
+
+
+def part_timings(sim_events: list[dict], event_read_times: dict, dispatch_times: dict) -> list[PartTiming]:
+    """Follows every part from its IR edge to its servo move.
+
+    Args:
+        sim_events (list[dict]): The simulator's log, see FirmwareSim.events().
+        event_read_times (dict): Edge tick -> host time the obstacle event was read.
+        dispatch_times (dict): Detection tick -> host time the SCHEDULE was queued.
+    """
+    gate_times = {event["part"]: event["time"] for event in sim_events if event["event"] == "gate"}
+    schedule_times = {}
+    for event in sim_events:
+        if event["event"] == "schedule":
+            schedule_times.setdefault(event["detection_tick"], event["time"])
+    # Moves run in gate order, which is the order the parts arrived in.
+    action_times = sorted(event["time"] for event in sim_events if event["event"] == "action")
+    next_action = 0
+
+    timings = []
+    for edge in (event for event in sim_events if event["event"] == "edge" and event["state"] == 1):
+        tick = edge["tick"]
+        gate_time = gate_times.get(edge["part"])
+        schedule_time = schedule_times.get(tick)
+        action_time = None
+        if schedule_time is not None and gate_time is not None:
+            due = max(gate_time, schedule_time)
+            while next_action < len(action_times) and action_times[next_action] < due:
+                next_action += 1
+            if next_action < len(action_times):
+                action_time = action_times[next_action]
+                next_action += 1
+
+        read_time = event_read_times.get(tick)
+        dispatch_time = dispatch_times.get(tick)
+        stages = {
+            "uplink": _span(edge["time"], read_time),
+            "decision": _span(read_time, dispatch_time),
+            "downlink": _span(dispatch_time, schedule_time),
+            "slack": _span(schedule_time, gate_time),
+            "actuation": _span(gate_time, action_time),
+            "total": _span(edge["time"], action_time),
+        }
+        on_time = stages["slack"] is not None and stages["slack"] > 0 and action_time is not None
+        timings.append(PartTiming(edge["part"], tick, on_time, stages))
+    return timings
+
+
+def summarize(timings: list[PartTiming]) -> dict:
+    """p50/p99 of every stage in milliseconds, and how many parts were sorted on time."""
+    summary = {"parts": len(timings), "on_time": sum(timing.on_time for timing in timings), "stages": {}}
+    for stage in STAGES:
+        values = [timing.stages[stage] * 1000.0 for timing in timings if timing.stages[stage] is not None]
+        summary["stages"][stage] = {
+            "count": len(values),
+            "p50_ms": percentile(values, 0.5) if values else None,
+            "p99_ms": percentile(values, 0.99) if values else None,
+        }
+    return summary
@@ -0,0 +1,114 @@
+"""Builds and runs the firmware-in-the-loop simulator.
+
+bench/sim/simulator.cpp compiles the unmodified firmware in arduino_code/
+natively against a host Arduino shim, models the belt, encoder, IR sensor
+and servo around it, and serves the firmware's UART on a pseudo terminal
+that the application opens like the Arduino's serial port. The simulator
+logs what really happened (edges, gate crossings, SCHEDULE frames as the
+firmware read them, servo moves) as JSON lines.
+"""
+import json
+import os
+import shutil
+import subprocess
+from pathlib import Path
+
+REPO_ROOT = Path(__file__).resolve().parent.parent
+FIRMWARE_DIR = REPO_ROOT / "arduino_code"
+SIM_DIR = REPO_ROOT / "bench" / "sim"
+SIM_BINARY = REPO_ROOT / "build" / "firmware_sim"
+
+
+def find_compiler() -> str | None:
+    """The C++ compiler to build the simulator with: $CXX, g++ or clang++."""
+    return os.environ.get("CXX") or shutil.which("g++") or shutil.which("clang++")
+
+
+def build_simulator(force: bool = False) -> Path:
+    """Compiles the simulator unless the binary is newer than all of its sources.
+
+    Raises:
+        RuntimeError: If no C++ compiler is found.
+        subprocess.CalledProcessError: If the build fails.
+    """
+    sketch = FIRMWARE_DIR / "arduino_code.ino"
+    sources = sorted(FIRMWARE_DIR.glob("*.cpp")) + [SIM_DIR / "simulator.cpp"]
+    inputs = [sketch, *sources, *FIRMWARE_DIR.glob("*.h"), *SIM_DIR.rglob("*.h")]
+    if not force and SIM_BINARY.exists() and \
+            SIM_BINARY.stat().st_mtime >= max(path.stat().st_mtime for path in inputs):
+        return SIM_BINARY
+
+    compiler = find_compiler()
+    if compiler is None:
+        raise RuntimeError("No C++ compiler found to build the firmware simulator; set CXX")
+    SIM_BINARY.parent.mkdir(exist_ok=True)
+    # The Arduino IDE includes Arduino.h in the sketch implicitly. EEPROM
+    # addresses are integers cast to pointers, which is fine on the AVR.
+    command = [compiler, "-std=gnu++17", "-O2", "-Wno-int-to-pointer-cast", "-I", str(SIM_DIR), "-I", str(FIRMWARE_DIR),
+               "-include", "Arduino.h", "-x", "c++", str(sketch), "-x", "none",
+               *map(str, sources), "-o", str(SIM_BINARY)]
+    subprocess.run(command, check=True)
+    return SIM_BINARY
+
+
+class FirmwareSim:
+    """A simulator process, started by start() or by entering the context.
+
+    Keyword options are passed on as command-line options of the simulator,
+    e.g. parts=20, interval_ms=500 becomes --parts 20 --interval-ms 500; see
+    Options in bench/sim/simulator.cpp for the names and defaults.
+
+    Args:
+        log_path (str | Path): Where the simulator writes its event log.
+    """
+    def __init__(self, log_path, **options):
+        self.log_path = Path(log_path)
+        self.options = options
+        self.port = None
+        self._process = None
+
+    def start(self) -> str:
+        """Starts the simulator and returns the path of its serial port."""
+        binary = build_simulator()
+        command = [str(binary), "--log", str(self.log_path)]
+        for name, value in self.options.items():
+            command += ["--" + name.replace("_", "-"), str(value)]
+        self._process = subprocess.Popen(command, stdout=subprocess.PIPE, text=True)
+        self.port = self._process.stdout.readline().strip()
+        if not self.port:
+            self._process.wait()
+            raise RuntimeError(f"Firmware simulator exited with code {self._process.returncode}")
+        return self.port
+
+    def wait(self, timeout: float | None = None) -> int:
+        """Waits for the simulator to finish its parts; returns its exit code.
+
+        Raises:
+            subprocess.TimeoutExpired: If it is still running after timeout seconds.
+        """
+        return self._process.wait(timeout)
+
+    def stop(self):
+        if self._process is None:
+            return
+        if self._process.poll() is None:
+            self._process.terminate()
+            self._process.wait()
+        self._process.stdout.close()
+
+    @property
+    def running(self) -> bool:
+        return self._process is not None and self._process.poll() is None
+
+    def events(self, kind: str | None = None) -> list[dict]:
+        """The logged events so far, optionally only those of one kind."""
+        with open(self.log_path) as log:
+            events = [json.loads(line) for line in log if line.strip()]
+        return [event for event in events if kind is None or event["event"] == kind]
+
+    def __enter__(self):
+        self.start()
+        return self
+
+    def __exit__(self, *exc_info):
+        self.stop()
@@ -0,0 +1,84 @@
+import threading
+import time
+import cv2
+
+
+class ReplayCamera:
+    """Plays a recorded clip in place of the Camera, at the clip's frame rate.
+
+    The clip is decoded into memory by initialize(), so decoding does not show
+    up in the measurements, and is played in a loop. read_frame() behaves like
+    the threaded Camera: it returns the newest frame that has been "captured"
+    by now, never the same frame twice, and None while the next one is not
+    due yet. Frames that came due but were never read count as dropped.
+    Returned frames are shared between loops of the clip and must not be
+    written to.
+
+    Args:
+        source (str | list): A video file, or the frames themselves.
+        fps (float, optional): Playback rate; defaults to the file's rate, or 30.
+        max_frames (int): Most frames decoded from a file.
+    """
+    DEFAULT_FPS = 30.0
+
+    def __init__(self, source, fps=None, max_frames=900):
+        self.source = source
+        self.fps = fps
+        self.max_frames = max_frames
+        self.frames = []
+        self.last_frame_time = None
+        self.dropped_frames = 0
+        self._start_time = None
+        self._last_index = -1
+        self._lock = threading.Lock()
+
+    def initialize(self):
+        """Loads the clip and starts playback.
+
+        Raises:
+            IOError: If the clip cannot be read or has no frames.
+        """
+        if isinstance(self.source, str):
+            cap = cv2.VideoCapture(self.source)
+            if not cap.isOpened():
+                raise IOError(f"Cannot open video {self.source}")
+            self.fps = self.fps or cap.get(cv2.CAP_PROP_FPS) or self.DEFAULT_FPS
+            self.frames = []
+            while len(self.frames) < self.max_frames:
+                ret, frame = cap.read()
+                if not ret:
+                    break
+                self.frames.append(frame)
+            cap.release()
+        else:
+            self.frames = list(self.source)
+            self.fps = self.fps or self.DEFAULT_FPS
+        if not self.frames:
+            raise IOError(f"No frames in {self.source if isinstance(self.source, str) else 'the clip'}")
+        self._start_time = time.time()
+        self._last_index = -1
+
+    def read_frame(self, timeout=0.0):
+        """Returns the newest due frame, waiting up to timeout seconds for one."""
+        deadline = time.time() + timeout
+        with self._lock:
+            index = int((time.time() - self._start_time) * self.fps)
+            while index <= self._last_index:
+                next_due = self._start_time + (self._last_index + 1) / self.fps
+                if next_due > deadline:
+                    return None
+                time.sleep(max(0.0, next_due - time.time()))
+                index = int((time.time() - self._start_time) * self.fps)
+            if self._last_index >= 0:
+                self.dropped_frames += index - self._last_index - 1
+            self._last_index = index
+            self.last_frame_time = self._start_time + index / self.fps
+            return self.frames[index % len(self.frames)]
+
+    def read_frame_with_timestamp(self, timeout=0.0):
+        """Like read_frame(), but also returns the frame's (simulated) capture time."""
+        frame = self.read_frame(timeout)
+        return frame, self.last_frame_time if frame is not None else None
+
+    def release(self):
+        self.frames = []
@@ -0,0 +1,156 @@
+"""End-to-end latency and throughput benchmark.
+
+Runs the real ApplicationController against the firmware simulator, with a
+recorded clip standing in for the camera, once per part rate. Each run
+reports the p50/p99 latency of every pipeline stage (see bench/analysis.py)
+and how many parts were sorted before they reached the gate. The highest
+rate at which every part was sorted on time is the maximum stable rate.
+
+    python -m bench.run_benchmark --video clip.mp4 --rates 30,60,120,240
+
+The clip only has to show the kind of parts being sorted; the simulator
+decides when parts pass the sensor. The run fails on the first rate that
+is not stable unless --keep-going is given.
+"""
+import argparse
+import json
+import sys
+import tempfile
+import time
+from pathlib import Path
+
+from bench.analysis import STAGES, part_timings, summarize
+from bench.firmware_sim import FirmwareSim
+from bench.replay_camera import ReplayCamera
+from src.config.config import AppConfig
+from src.core.application_controller import ApplicationController
+
+
+class InstrumentedController(ApplicationController):
+    """The application controller, timestamping the two host-side stage boundaries.
+
+    Both are keyed by the part's edge tick, like the simulator's log.
+    """
+    def __init__(self, config):
+        super().__init__(config)
+        self.event_read_times = {}
+        self.dispatch_times = {}
+        read_obstacle_events = self.serial_manager.read_obstacle_events
+
+        def timed_read_obstacle_events():
+            events = read_obstacle_events()
+            now = time.time()
+            for event in events:
+                if event.state == 1:
+                    self.event_read_times.setdefault(event.tick, now)
+            return events
+        self.serial_manager.read_obstacle_events = timed_read_obstacle_events
+
+    def _dispatch_servo_code(self, servo_code, detection_tick):
+        if detection_tick is not None:
+            self.dispatch_times.setdefault(detection_tick, time.time())
+        return super()._dispatch_servo_code(servo_code, detection_tick)
+
+
+def run_rate(args, rate: float, log_dir: Path) -> dict:
+    """Sorts args.parts parts arriving at rate parts per minute; returns the summary."""
+    sim = FirmwareSim(log_dir / f"sim_{rate:g}.jsonl", parts=args.parts, interval_ms=60000.0 / rate,
+                      jitter_ms=args.jitter_ms, part_length_ticks=args.part_length_ticks, seed=args.seed)
+    with sim:
+        config = type("BenchConfig", (AppConfig,), {
+            "SERIAL_PORT": sim.port,
+            "SERIAL_CONNECT_DELAY_SECONDS": 0.1,
+            "SERIAL_HIGH_SPEED_BAUDRATE": args.baudrate,
+            "MULTI_PART_TRACKING": args.tracking,
+            "VISION_PIPELINE": args.pipeline,
+            "EVENT_LOG_DIRECTORY": None,
+            "METRICS_PORT": None,
+            "DEVICE_STATS_INTERVAL_SECONDS": None,
+            "CAMERA_THREADED_CAPTURE": False,
+        })
+        controller = InstrumentedController(config)
+        controller.camera = ReplayCamera(args.video, fps=args.fps)
+        if not controller.set_active_classifier(args.classifier):
+            raise SystemExit(f"Cannot use the {args.classifier} classifier here")
+        controller.start()
+        try:
+            deadline = time.time() + args.connect_timeout
+            while not controller.serial_manager.connected:
+                if time.time() > deadline:
+                    raise SystemExit(f"Could not connect to the simulator on {sim.port}")
+                time.sleep(0.01)
+            controller.set_pwm(args.pwm)
+            # What the UI timer does; without the pipeline this runs the vision path.
+            while sim.running:
+                controller.update_ui()
+                time.sleep(0.001)
+        finally:
+            controller.stop()
+        events = sim.events()
+
+    summary = summarize(part_timings(events, controller.event_read_times, controller.dispatch_times))
+    summary["rate_per_minute"] = rate
+    summary["dropped_frames"] = controller.camera.dropped_frames
+    if controller.pipeline:
+        summary["dropped_frames"] += controller.pipeline.dropped_frames
+    return summary
+
+
+def print_summary(summary: dict):
+    print(f"\n{summary['rate_per_minute']:g} parts/min: {summary['on_time']}/{summary['parts']} sorted on time, "
+          f"{summary['dropped_frames']} frames dropped")
+    print(f"  {'stage':<10} {'p50 ms':>9} {'p99 ms':>9} {'parts':>6}")
+    for stage in STAGES:
+        result = summary["stages"][stage]
+        p50 = f"{result['p50_ms']:9.1f}" if result["p50_ms"] is not None else f"{'-':>9}"
+        p99 = f"{result['p99_ms']:9.1f}" if result["p99_ms"] is not None else f"{'-':>9}"
+        print(f"  {stage:<10} {p50} {p99} {result['count']:>6}")
+
+
+def main(argv=None) -> int:
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    parser.add_argument("--video", required=True, help="Clip played in place of the camera")
+    parser.add_argument("--fps", type=float, help="Playback rate; defaults to the clip's")
+    parser.add_argument("--classifier", default="color", choices=("color", "shape", "composite"))
+    parser.add_argument("--rates", default="30,60,90,120,180,240", help="Part rates to try, parts per minute")
+    parser.add_argument("--parts", type=int, default=20, help="Parts per rate")
+    parser.add_argument("--jitter-ms", type=float, default=0.0, help="Random spread of the part arrivals")
+    parser.add_argument("--part-length-ticks", type=float, default=100.0)
+    parser.add_argument("--pwm", type=int, default=200, help="Belt motor PWM during the run")
+    parser.add_argument("--baudrate", type=int, default=AppConfig.SERIAL_HIGH_SPEED_BAUDRATE,
+                        help="High-speed baud rate requested in the handshake; 0 stays at 9600")
+    parser.add_argument("--tracking", action=argparse.BooleanOptionalAction, default=False,
+                        help="Multi-part tracking; needs a clip whose parts match the simulated arrivals")
+    parser.add_argument("--pipeline", action=argparse.BooleanOptionalAction, default=AppConfig.VISION_PIPELINE,
+                        help="Run the vision path on the staged pipeline instead of the UI timer")
+    parser.add_argument("--seed", type=int, default=1)
+    parser.add_argument("--connect-timeout", type=float, default=10.0)
+    parser.add_argument("--keep-going", action="store_true", help="Try every rate even after an unstable one")
+    parser.add_argument("--json", help="Also write the summaries to this file")
+    args = parser.parse_args(argv)
+    args.baudrate = args.baudrate or None
+
+    summaries = []
+    max_stable_rate = None
+    with tempfile.TemporaryDirectory() as log_dir:
+        for rate in sorted(float(rate) for rate in args.rates.split(",")):
+            summary = run_rate(args, rate, Path(log_dir))
+            summaries.append(summary)
+            print_summary(summary)
+            if summary["parts"] and summary["on_time"] == summary["parts"]:
+                max_stable_rate = rate
+            elif not args.keep_going:
+                break
+
+    if max_stable_rate is None:
+        print("\nNo rate was stable.")
+    else:
+        print(f"\nMaximum stable part rate: {max_stable_rate:g} parts/min")
+    if args.json:
+        with open(args.json, "w") as output:
+            json.dump({"max_stable_rate_per_minute": max_stable_rate, "runs": summaries}, output, indent=2)
+    return 0 if max_stable_rate is not None else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,99 @@
+#ifndef ARDUINO_H
+#define ARDUINO_H
+
+// =================================================================
+// ==           HOST BUILD OF THE ARDUINO CORE (SIMULATOR)        ==
+// =================================================================
+// The parts of the Arduino core and avr-libc that the firmware uses,
+// implemented by simulator.cpp so the unmodified sources in arduino_code/
+// run natively. Registers are plain variables the simulator reads and
+// writes, and ISRs are called from the simulator between passes of loop().
+// =================================================================
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+#define CHANGE 1
+#define FALLING 2
+#define RISING 3
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+#define _BV(bit) (1u << (bit))
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+void analogWrite(uint8_t pin, int value);
+
+#define digitalPinToInterrupt(pin) ((pin) == 2 ? 0 : ((pin) == 3 ? 1 : -1))
+void attachInterrupt(uint8_t interrupt, void (*isr)(void), int mode);
+void detachInterrupt(uint8_t interrupt);
+
+// ISRs never preempt loop() in the simulator, so masking is a no-op.
+inline void noInterrupts() {}
+inline void interrupts() {}
+inline void cli() {}
+inline void sei() {}
+
+// --- ATmega328P registers ---
+extern volatile uint8_t SREG;
+extern volatile uint8_t PIND, PINB, PINC, PORTD, PORTB, PORTC, DDRD, DDRB, DDRC;
+extern volatile uint8_t PCIFR, PCICR, PCMSK2;
+extern volatile uint8_t OCR0A, TIMSK0;
+extern volatile uint8_t TCCR1A, TCCR1B, TIMSK1;
+extern volatile uint16_t ICR1, OCR1A, OCR1B, TCNT1;
+extern volatile uint8_t TCCR2A, OCR2A, OCR2B;
+
+#define OCIE0A 1
+#define TOIE1 0
+#define WGM11 1
+#define WGM12 3
+#define WGM13 4
+#define CS11 1
+#define COM1A1 7
+#define COM1B1 5
+#define COM2A1 7
+#define COM2B1 5
+
+// Only port D has a pin-change vector in the simulator.
+#define digitalPinToPCICR(pin) (&PCICR)
+#define digitalPinToPCICRbit(pin) (2)
+#define digitalPinToPCMSK(pin) (&PCMSK2)
+#define digitalPinToPCMSKbit(pin) ((pin) & 7)
+
+#define ISR(vector) extern "C" void vector(void); extern "C" void vector(void)
+
+#define PROGMEM
+#define pgm_read_word(address) (*(const uint16_t*)(address))
+
+// The UART, with the bytes paced at the configured baud rate.
+class HardwareSerial {
+public:
+    void begin(unsigned long baudRate);
+    int available();
+    int read();
+    size_t write(uint8_t value);
+    size_t print(const char* text);
+    size_t print(int value);
+    size_t println(int value);
+    size_t println();
+    void flush(); // Waits until every byte has left the TX buffer
+};
+
+extern HardwareSerial Serial;
+
+#endif
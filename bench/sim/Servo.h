@@ -0,0 +1,13 @@
+#ifndef SERVO_H
+#define SERVO_H
+
+// The firmware drives the servo from Timer1 directly; Motor.cpp and older
+// sketches only need the class to exist.
+class Servo {
+public:
+    void attach(int) {}
+    void write(int) {}
+    void writeMicroseconds(int) {}
+};
+
+#endif
@@ -0,0 +1,13 @@
+#ifndef AVR_BOOT_H
+#define AVR_BOOT_H
+
+#include <stdint.h>
+
+// The signature row, filled by the simulator; its serial number bytes follow --device-serial.
+extern uint8_t simSignatureRow[32];
+
+inline uint8_t boot_signature_byte_get(uint8_t address) {
+    return simSignatureRow[address & 31];
+}
+
+#endif
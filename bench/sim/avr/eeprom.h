@@ -0,0 +1,15 @@
+#ifndef AVR_EEPROM_H
+#define AVR_EEPROM_H
+
+#include <stdint.h>
+
+// 1 KiB of simulated EEPROM, blank (0xFF) at every start of the simulator.
+// Like the ATmega328P, a write keeps it busy for 3.4 ms, and a read or
+// write started before that waits for it to finish.
+extern uint8_t simEeprom[1024];
+
+uint8_t eeprom_read_byte(const uint8_t* address);
+void eeprom_update_byte(uint8_t* address, uint8_t value);
+bool eeprom_is_ready();
+
+#endif
@@ -0,0 +1,648 @@
+// =================================================================
+// ==              FIRMWARE-IN-THE-LOOP SIMULATOR                 ==
+// =================================================================
+// Runs the firmware's setup() and loop() natively against a model of the
+// conveyor and serves its serial port on a pseudo terminal, so the host
+// application connects to it as it would to the Arduino. Built and started
+// by bench/firmware_sim.py.
+//
+// The model covers what the firmware sees of the hardware:
+//   - the belt motor, a first-order lag from the Timer2 PWM value to speed,
+//   - the encoder, one RISING interrupt per tick of belt travel,
+//   - the IR sensor, a pin-change interrupt on each part's leading and
+//     trailing edge, with parts arriving at a fixed interval once the belt
+//     is up to speed,
+//   - Timer0 (1 kHz PID interrupt) and Timer1 (20 ms servo frame),
+//   - the UART, with every byte taking 10 bit times at the current baud
+//     rate in each direction and 64-byte RX and TX buffers,
+//   - the signature row, whose serial number bytes (and so the device ID
+//     the firmware reports) follow --device-serial.
+// Interrupts run between two passes of loop(); micros() reports the exact
+// model time of the event while an ISR runs.
+//
+// The pty path is printed on stdout. Ground truth goes to --log as JSON lines:
+//   {"event":"edge","part":0,"state":1,"time":...,"tick":...}
+//   {"event":"gate","part":0,"time":...,"tick":...}
+//   {"event":"schedule","part_id":3,"servo_code":1,"detection_tick":...,"time":...}
+//   {"event":"action","time":...,"tick":...}
+//   {"event":"servo","pulse_us":...,"time":...}
+//   {"event":"end","time":...}
+// Times are host wall clock seconds (Python's time.time()), ticks are
+// encoder pulses. "schedule" is logged when the firmware reads the frame,
+// "action" when it executes a scheduled move and "servo" when the arm starts
+// moving, up to one servo frame later.
+// =================================================================
+
+#include <Arduino.h>
+#include <avr/eeprom.h>
+#include "config.h"
+#include "Protocol.h"
+#include "ActuationQueue.h"
+
+#include <math.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <time.h>
+#include <fcntl.h>
+#include <termios.h>
+#include <unistd.h>
+#include <algorithm>
+#include <deque>
+#include <random>
+#include <vector>
+
+void setup();
+void loop();
+extern "C" void PCINT2_vect(void);
+extern "C" void TIMER0_COMPA_vect(void);
+extern "C" void TIMER1_OVF_vect(void);
+extern ActuationQueue actuationQueue; // Defined in the sketch
+
+// --- ATmega328P registers and avr-libc symbols ---
+volatile uint8_t SREG;
+volatile uint8_t PIND = 0xFF, PINB = 0xFF, PINC = 0xFF, PORTD, PORTB, PORTC, DDRD, DDRB, DDRC;
+volatile uint8_t PCIFR, PCICR, PCMSK2;
+volatile uint8_t OCR0A, TIMSK0;
+volatile uint8_t TCCR1A, TCCR1B, TIMSK1;
+volatile uint16_t ICR1, OCR1A, OCR1B, TCNT1;
+volatile uint8_t TCCR2A, OCR2A, OCR2B;
+uint8_t simEeprom[1024];
+uint8_t simSignatureRow[32];
+char __heap_start;
+char* __brkval = 0;
+HardwareSerial Serial;
+
+namespace {
+
+struct Options {
+    int parts = 20;
+    double intervalMs = 1000.0;
+    double jitterMs = 0.0;
+    double partLengthTicks = 100.0;
+    double maxTicksPerSecond = 1600.0;  // Belt speed at PWM 255
+    double motorTimeConstantMs = 150.0;
+    double startMs = 1000.0;            // First part after the belt is up to speed
+    double durationS = 0.0;             // 0: until the last part has passed the gate
+    double tailMs = 1000.0;
+    unsigned seed = 1;
+    unsigned deviceSerial = 0;          // Serial number of the simulated chip
+    unsigned passSleepUs = 20;          // Gives the host CPU time between passes of loop()
+    const char* logPath = 0;
+};
+
+const uint64_t SLICE_US = 100;          // Resolution of the model
+const uint64_t TIMER0_PERIOD_US = 1000;
+const uint64_t TIMER1_PERIOD_US = 20000;
+const size_t UART_BUFFER_SIZE = 64;
+const uint8_t OBSTACLE_MASK = _BV(OBSTACLE_IR_SENSOR_PIN & 7);
+
+Options options;
+volatile sig_atomic_t stopRequested = 0;
+FILE* logFile = stderr;
+
+// --- Clock ---
+uint64_t startMonotonicUs;
+double startWallTime;
+bool inIsr = false;
+uint64_t isrTimeUs = 0;
+
+uint64_t monotonicUs() {
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000ULL + (uint64_t)now.tv_nsec / 1000ULL;
+}
+
+uint64_t nowUs() {
+    return inIsr ? isrTimeUs : monotonicUs() - startMonotonicUs;
+}
+
+double wallTime(uint64_t us) {
+    return startWallTime + us / 1e6;
+}
+
+void logEvent(const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    vfprintf(logFile, format, args);
+    va_end(args);
+    fputc('\n', logFile);
+}
+
+// --- UART on a pseudo terminal ---
+int ptyMaster = -1;
+int ptySlave = -1;
+unsigned long baudRate = 9600;
+std::deque<uint8_t> wireRx;   // Read from the pty, still on the wire
+std::deque<uint8_t> uartRx;   // The HardwareSerial RX ring
+std::deque<uint8_t> uartTx;   // The HardwareSerial TX ring
+std::vector<uint8_t> ptyOut;  // Sent on the wire, not yet written to the pty
+uint64_t rxDoneUs = 0;        // When the byte at the head of wireRx has arrived
+uint64_t txDoneUs = 0;        // When the byte at the head of uartTx has been sent
+
+uint64_t byteTimeUs() {
+    return 10000000ULL / baudRate; // Start bit, 8 data bits, stop bit
+}
+
+void pumpSerial(uint64_t now) {
+    uint8_t buffer[256];
+    ssize_t count;
+    while ((count = ::read(ptyMaster, buffer, sizeof(buffer))) > 0) {
+        if (wireRx.empty()) {
+            rxDoneUs = now + byteTimeUs();
+        }
+        wireRx.insert(wireRx.end(), buffer, buffer + count);
+    }
+    while (!wireRx.empty() && rxDoneUs <= now) {
+        // The AVR core keeps one slot of its ring free and drops bytes once it is full.
+        if (uartRx.size() < UART_BUFFER_SIZE - 1) {
+            uartRx.push_back(wireRx.front());
+        }
+        wireRx.pop_front();
+        rxDoneUs += byteTimeUs();
+    }
+
+    while (!uartTx.empty() && txDoneUs <= now) {
+        ptyOut.push_back(uartTx.front());
+        uartTx.pop_front();
+        txDoneUs += byteTimeUs();
+    }
+    if (!ptyOut.empty()) {
+        count = ::write(ptyMaster, ptyOut.data(), ptyOut.size());
+        if (count > 0) {
+            ptyOut.erase(ptyOut.begin(), ptyOut.begin() + count);
+        }
+    }
+}
+
+// Host -> device frames as the firmware reads them, to log when each SCHEDULE arrived.
+struct FrameSniffer {
+    enum State { WAIT_SYNC, READ_TYPE, READ_PAYLOAD, READ_CRC } state = WAIT_SYNC;
+    uint8_t type = 0;
+    uint8_t size = 0;
+    uint8_t index = 0;
+    uint8_t crc = 0;
+    uint8_t payload[PROTOCOL_MAX_PAYLOAD];
+
+    void feed(uint8_t value) {
+        switch (state) {
+            case WAIT_SYNC:
+                if (value == FRAME_SYNC_BYTE) {
+                    state = READ_TYPE;
+                }
+                break;
+            case READ_TYPE:
+                size = protocolPayloadSize(value);
+                if (size == PROTOCOL_INVALID_SIZE || size > PROTOCOL_MAX_PAYLOAD) {
+                    state = WAIT_SYNC;
+                    break;
+                }
+                type = value;
+                index = 0;
+                crc = crc8Update(0, value);
+                state = size > 0 ? READ_PAYLOAD : READ_CRC;
+                break;
+            case READ_PAYLOAD:
+                payload[index++] = value;
+                crc = crc8Update(crc, value);
+                if (index == size) {
+                    state = READ_CRC;
+                }
+                break;
+            case READ_CRC:
+                state = WAIT_SYNC;
+                if (value == crc) {
+                    frameReceived();
+                }
+                break;
+        }
+    }
+
+    void frameReceived() {
+        if (type != FRAME_TYPE_SCHEDULE) {
+            return;
+        }
+        unsigned partId = payload[0] | (payload[1] << 8);
+        unsigned long detectionTick = (unsigned long)payload[3] | ((unsigned long)payload[4] << 8) |
+                                      ((unsigned long)payload[5] << 16) | ((unsigned long)payload[6] << 24);
+        logEvent("{\"event\":\"schedule\",\"part_id\":%u,\"servo_code\":%u,\"detection_tick\":%lu,\"time\":%.6f}",
+                 partId, payload[2], detectionTick, wallTime(nowUs()));
+    }
+};
+
+FrameSniffer sniffer;
+
+// --- Conveyor model ---
+struct Part {
+    uint64_t arrivalUs;
+    double exitPosition;    // Belt position at which the trailing edge clears the sensor
+    unsigned long gateTick; // Tick at which the part reaches the diverter gate
+};
+
+std::vector<Part> parts;
+size_t nextArrival = 0;      // Next part to reach the sensor
+std::deque<size_t> onSensor; // Parts in front of the sensor, oldest first
+std::deque<size_t> toGate;   // Parts between sensor and gate, oldest first
+size_t gatesPassed = 0;
+uint64_t lastGateUs = 0;
+bool partsScheduled = false;
+
+double beltSpeed = 0.0;      // Ticks per second
+double beltPosition = 0.0;   // Ticks, fractional
+unsigned long encoderTicks = 0;
+void (*encoderIsr)(void) = 0;
+uint64_t modelTimeUs = 0;    // The model has been run up to here
+uint16_t lastServoPulse = 0;
+bool servoMoving = false;
+
+enum EventKind { ENCODER_PULSE, PART_ARRIVAL, PART_EXIT };
+
+struct ModelEvent {
+    uint64_t timeUs;
+    EventKind kind;
+    size_t part;
+    bool operator<(const ModelEvent& other) const { return timeUs < other.timeUs; }
+};
+
+void schedulePartArrivals(uint64_t firstUs) {
+    std::mt19937 random(options.seed);
+    std::uniform_real_distribution<double> jitter(-options.jitterMs, options.jitterMs);
+    parts.resize(options.parts);
+    uint64_t previousUs = 0;
+    for (int i = 0; i < options.parts; i++) {
+        double offsetMs = i * options.intervalMs + (options.jitterMs > 0 ? jitter(random) : 0.0);
+        uint64_t arrivalUs = firstUs + (uint64_t)(offsetMs > 0 ? offsetMs * 1000.0 : 0.0);
+        parts[i].arrivalUs = i > 0 && arrivalUs <= previousUs ? previousUs + 1 : arrivalUs;
+        previousUs = parts[i].arrivalUs;
+    }
+    partsScheduled = true;
+}
+
+void setObstacle(bool present) {
+    uint8_t previous = PIND;
+    PIND = present ? (uint8_t)(PIND & ~OBSTACLE_MASK) : (uint8_t)(PIND | OBSTACLE_MASK); // LOW = obstacle
+    if (PIND != previous && (PCICR & _BV(2)) && (PCMSK2 & OBSTACLE_MASK)) {
+        PCINT2_vect();
+    }
+}
+
+void runEvent(const ModelEvent& event) {
+    inIsr = true;
+    isrTimeUs = event.timeUs;
+    switch (event.kind) {
+        case ENCODER_PULSE:
+            encoderTicks++;
+            if (encoderIsr) {
+                encoderIsr();
+            }
+            while (!toGate.empty() && (long)(encoderTicks - parts[toGate.front()].gateTick) >= 0) {
+                size_t part = toGate.front();
+                toGate.pop_front();
+                gatesPassed++;
+                lastGateUs = event.timeUs;
+                logEvent("{\"event\":\"gate\",\"part\":%zu,\"time\":%.6f,\"tick\":%lu}",
+                         part, wallTime(event.timeUs), encoderTicks);
+            }
+            break;
+        case PART_ARRIVAL:
+            onSensor.push_back(event.part);
+            parts[event.part].gateTick = encoderTicks + SERVO_GATE_OFFSET_TICKS;
+            toGate.push_back(event.part);
+            logEvent("{\"event\":\"edge\",\"part\":%zu,\"state\":1,\"time\":%.6f,\"tick\":%lu}",
+                     event.part, wallTime(event.timeUs), encoderTicks);
+            setObstacle(true);
+            break;
+        case PART_EXIT:
+            onSensor.pop_front();
+            logEvent("{\"event\":\"edge\",\"part\":%zu,\"state\":0,\"time\":%.6f,\"tick\":%lu}",
+                     event.part, wallTime(event.timeUs), encoderTicks);
+            setObstacle(!onSensor.empty());
+            break;
+    }
+    inIsr = false;
+}
+
+void runTimers(uint64_t timeUs) {
+    inIsr = true;
+    isrTimeUs = timeUs;
+    if (timeUs % TIMER0_PERIOD_US == 0 && (TIMSK0 & _BV(OCIE0A))) {
+        TIMER0_COMPA_vect();
+    }
+    if (timeUs % TIMER1_PERIOD_US == 0 && (TIMSK1 & _BV(TOIE1))) {
+        TIMER1_OVF_vect();
+        // A move starts with the first frame whose pulse differs from the last one.
+        bool moving = OCR1B != lastServoPulse;
+        if (moving && !servoMoving && lastServoPulse != 0) {
+            logEvent("{\"event\":\"servo\",\"pulse_us\":%u,\"time\":%.6f}", (unsigned)(OCR1B / 2), wallTime(timeUs));
+        }
+        servoMoving = moving;
+        lastServoPulse = OCR1B;
+    }
+    inIsr = false;
+}
+
+// Advances the model by one slice and runs the interrupts that fall into it, in time order.
+void runSlice(uint64_t startUs) {
+    double dt = SLICE_US / 1e6;
+    double targetSpeed = OCR2A / 255.0 * options.maxTicksPerSecond;
+    double endSpeed = targetSpeed + (beltSpeed - targetSpeed) * exp(-dt * 1000.0 / options.motorTimeConstantMs);
+    double startPosition = beltPosition;
+    double endPosition = beltPosition + (beltSpeed + endSpeed) / 2.0 * dt;
+    beltSpeed = endSpeed;
+    beltPosition = endPosition;
+
+    if (!partsScheduled && targetSpeed > 0 && beltSpeed >= 0.9 * targetSpeed) {
+        schedulePartArrivals(startUs + (uint64_t)(options.startMs * 1000.0));
+    }
+
+    auto timeAt = [&](double position) {
+        double fraction = endPosition > startPosition ? (position - startPosition) / (endPosition - startPosition) : 0.0;
+        return startUs + (uint64_t)(fraction * SLICE_US);
+    };
+    auto positionAt = [&](uint64_t timeUs) {
+        return startPosition + (endPosition - startPosition) * (double)(timeUs - startUs) / SLICE_US;
+    };
+
+    std::vector<ModelEvent> events;
+    for (double tick = floor(startPosition) + 1; tick <= endPosition; tick++) {
+        events.push_back({ timeAt(tick), ENCODER_PULSE, 0 });
+    }
+    size_t firstArrival = nextArrival;
+    while (nextArrival < parts.size() && parts[nextArrival].arrivalUs < startUs + SLICE_US) {
+        Part& part = parts[nextArrival];
+        part.exitPosition = positionAt(part.arrivalUs) + options.partLengthTicks;
+        events.push_back({ part.arrivalUs, PART_ARRIVAL, nextArrival });
+        nextArrival++;
+    }
+    // Exits are in arrival order, since every part has the same length.
+    for (size_t part : onSensor) {
+        if (parts[part].exitPosition <= endPosition) {
+            events.push_back({ timeAt(parts[part].exitPosition), PART_EXIT, part });
+        }
+    }
+    for (size_t part = firstArrival; part < nextArrival; part++) {
+        if (parts[part].exitPosition <= endPosition) {
+            events.push_back({ timeAt(parts[part].exitPosition), PART_EXIT, part });
+        }
+    }
+    std::stable_sort(events.begin(), events.end());
+    for (const ModelEvent& event : events) {
+        runEvent(event);
+    }
+    runTimers(startUs + SLICE_US);
+}
+
+void runModel(uint64_t now) {
+    while (modelTimeUs + SLICE_US <= now) {
+        runSlice(modelTimeUs);
+        modelTimeUs += SLICE_US;
+    }
+}
+
+// Lets time pass inside a blocking Serial call, as the hardware would.
+void waitForUart() {
+    usleep(options.passSleepUs > 0 ? options.passSleepUs : 1);
+    uint64_t now = nowUs();
+    runModel(now);
+    pumpSerial(now);
+}
+
+// --- EEPROM ---
+const uint64_t EEPROM_WRITE_US = 3400; // Erase and write of one byte
+uint64_t eepromBusyUntilUs = 0;
+
+// Waits for the write in progress like eeprom_busy_wait(), stalling the caller.
+void eepromBusyWait() {
+    while (nowUs() < eepromBusyUntilUs) {
+        waitForUart();
+    }
+}
+
+bool finished(uint64_t now) {
+    if (options.durationS > 0 && now >= (uint64_t)(options.durationS * 1e6)) {
+        return true;
+    }
+    return options.parts > 0 && gatesPassed == (size_t)options.parts &&
+           now >= lastGateUs + (uint64_t)(options.tailMs * 1000.0);
+}
+
+bool openPty() {
+    ptyMaster = posix_openpt(O_RDWR | O_NOCTTY);
+    if (ptyMaster < 0 || grantpt(ptyMaster) != 0 || unlockpt(ptyMaster) != 0) {
+        return false;
+    }
+    // Kept open so the master stays readable while the host reconnects.
+    ptySlave = open(ptsname(ptyMaster), O_RDWR | O_NOCTTY);
+    if (ptySlave < 0) {
+        return false;
+    }
+    termios settings;
+    tcgetattr(ptySlave, &settings);
+    cfmakeraw(&settings);
+    tcsetattr(ptySlave, TCSANOW, &settings);
+    fcntl(ptyMaster, F_SETFL, fcntl(ptyMaster, F_GETFL) | O_NONBLOCK);
+    return true;
+}
+
+bool parseOptions(int argc, char** argv) {
+    for (int i = 1; i < argc; i++) {
+        const char* name = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : 0;
+        if (!value) {
+            fprintf(stderr, "Missing value for %s\n", name);
+            return false;
+        }
+        i++;
+        if (!strcmp(name, "--parts")) options.parts = atoi(value);
+        else if (!strcmp(name, "--interval-ms")) options.intervalMs = atof(value);
+        else if (!strcmp(name, "--jitter-ms")) options.jitterMs = atof(value);
+        else if (!strcmp(name, "--part-length-ticks")) options.partLengthTicks = atof(value);
+        else if (!strcmp(name, "--max-ticks-per-second")) options.maxTicksPerSecond = atof(value);
+        else if (!strcmp(name, "--motor-time-constant-ms")) options.motorTimeConstantMs = atof(value);
+        else if (!strcmp(name, "--start-ms")) options.startMs = atof(value);
+        else if (!strcmp(name, "--duration-s")) options.durationS = atof(value);
+        else if (!strcmp(name, "--tail-ms")) options.tailMs = atof(value);
+        else if (!strcmp(name, "--seed")) options.seed = (unsigned)atoi(value);
+        else if (!strcmp(name, "--device-serial")) options.deviceSerial = (unsigned)strtoul(value, 0, 0);
+        else if (!strcmp(name, "--pass-sleep-us")) options.passSleepUs = (unsigned)atoi(value);
+        else if (!strcmp(name, "--log")) options.logPath = value;
+        else {
+            fprintf(stderr, "Unknown option %s\n", name);
+            return false;
+        }
+    }
+    return true;
+}
+
+void requestStop(int) {
+    stopRequested = 1;
+}
+
+} // namespace
+
+// --- Arduino core ---
+unsigned long micros() {
+    return (unsigned long)(uint32_t)nowUs(); // Wraps at 2^32 like the AVR core
+}
+
+unsigned long millis() {
+    return (unsigned long)(uint32_t)(nowUs() / 1000);
+}
+
+void delay(unsigned long ms) {
+    uint64_t end = nowUs() + ms * 1000ULL;
+    while (nowUs() < end) {
+        waitForUart();
+    }
+}
+
+// --- avr-libc EEPROM ---
+bool eeprom_is_ready() {
+    return nowUs() >= eepromBusyUntilUs;
+}
+
+uint8_t eeprom_read_byte(const uint8_t* address) {
+    eepromBusyWait();
+    return simEeprom[(uintptr_t)address & 1023];
+}
+
+void eeprom_update_byte(uint8_t* address, uint8_t value) {
+    eepromBusyWait();
+    uint8_t& cell = simEeprom[(uintptr_t)address & 1023];
+    if (cell != value) {
+        cell = value;
+        eepromBusyUntilUs = nowUs() + EEPROM_WRITE_US;
+    }
+}
+
+void pinMode(uint8_t, uint8_t) {}
+void digitalWrite(uint8_t, uint8_t) {}
+
+int digitalRead(uint8_t pin) {
+    return pin < 8 ? (PIND >> pin) & 1 : HIGH;
+}
+
+void analogWrite(uint8_t pin, int value) {
+    if (pin == CONVEYOR_MOTOR_PWM_PIN) {
+        OCR2A = (uint8_t)constrain(value, 0, 255);
+    }
+}
+
+void attachInterrupt(uint8_t interrupt, void (*isr)(void), int) {
+    if (interrupt == digitalPinToInterrupt(CONVEYOR_ENCODER_PIN)) {
+        encoderIsr = isr;
+    }
+}
+
+void detachInterrupt(uint8_t interrupt) {
+    if (interrupt == digitalPinToInterrupt(CONVEYOR_ENCODER_PIN)) {
+        encoderIsr = 0;
+    }
+}
+
+void HardwareSerial::begin(unsigned long rate) {
+    baudRate = rate > 0 ? rate : 9600;
+}
+
+int HardwareSerial::available() {
+    return (int)uartRx.size();
+}
+
+int HardwareSerial::read() {
+    if (uartRx.empty()) {
+        return -1;
+    }
+    uint8_t value = uartRx.front();
+    uartRx.pop_front();
+    sniffer.feed(value);
+    return value;
+}
+
+size_t HardwareSerial::write(uint8_t value) {
+    while (uartTx.size() >= UART_BUFFER_SIZE) {
+        waitForUart(); // The AVR core blocks while the TX ring is full
+    }
+    if (uartTx.empty()) {
+        txDoneUs = nowUs() + byteTimeUs();
+    }
+    uartTx.push_back(value);
+    return 1;
+}
+
+size_t HardwareSerial::print(const char* text) {
+    size_t count = 0;
+    while (*text) {
+        count += write((uint8_t)*text++);
+    }
+    return count;
+}
+
+size_t HardwareSerial::print(int value) {
+    char text[12];
+    snprintf(text, sizeof(text), "%d", value);
+    return print(text);
+}
+
+size_t HardwareSerial::println(int value) {
+    return print(value) + println();
+}
+
+size_t HardwareSerial::println() {
+    return print("\r\n");
+}
+
+void HardwareSerial::flush() {
+    while (!uartTx.empty()) {
+        waitForUart();
+    }
+}
+
+int main(int argc, char** argv) {
+    if (!parseOptions(argc, argv)) {
+        return 2;
+    }
+    if (options.logPath && !(logFile = fopen(options.logPath, "w"))) {
+        perror(options.logPath);
+        return 1;
+    }
+    setvbuf(logFile, 0, _IOLBF, 0);
+    if (!openPty()) {
+        perror("pty");
+        return 1;
+    }
+    memset(simEeprom, 0xFF, sizeof(simEeprom));
+    memset(simSignatureRow, 0xFF, sizeof(simSignatureRow));
+    for (int i = 0; i < 4; i++) {
+        simSignatureRow[0x0E + i] = (uint8_t)(options.deviceSerial >> (8 * i));  // Lot number bytes
+    }
+    signal(SIGINT, requestStop);
+    signal(SIGTERM, requestStop);
+
+    timespec wall;
+    clock_gettime(CLOCK_REALTIME, &wall);
+    startWallTime = wall.tv_sec + wall.tv_nsec / 1e9;
+    startMonotonicUs = monotonicUs();
+    printf("%s\n", ptsname(ptyMaster));
+    fflush(stdout);
+
+    setup();
+    while (!stopRequested) {
+        uint64_t now = nowUs();
+        runModel(now);
+        pumpSerial(now);
+        uint8_t pendingActions = actuationQueue.getPendingCount();
+        loop();
+        if (actuationQueue.getPendingCount() == pendingActions - 1) {
+            logEvent("{\"event\":\"action\",\"time\":%.6f,\"tick\":%lu}", wallTime(nowUs()), encoderTicks);
+        }
+        if (finished(now)) {
+            break;
+        }
+        if (options.passSleepUs > 0) {
+            usleep(options.passSleepUs);
+        }
+    }
+    logEvent("{\"event\":\"end\",\"time\":%.6f}", wallTime(nowUs()));
+    fclose(logFile);
+    return 0;
+}
@@ -6,13 +6,18 @@ from PyQt6.QtWidgets import QApplication
 from src.config.config import AppConfig
 from src.core.application_controller import ApplicationController
 from src.gui.main_window import MainWindow
+from src.gui.multi_belt_window import MultiBeltWindow
 
 if __name__ == "__main__":
     app = QApplication(sys.argv)
 
     config = AppConfig()
-    controller = ApplicationController(config)
-    main_window = MainWindow(controller)
+    if config.BELTS:
+        # Each belt's controller runs in a worker process of its own.
+        main_window = MultiBeltWindow(config.BELTS)
+    else:
+        controller = ApplicationController(config)
+        main_window = MainWindow(controller)
     main_window.showMaximized()
 
     sys.exit(app.exec())
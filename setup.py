@@ -0,0 +1,19 @@
+"""Builds the optional native vision kernels.
+
+    python setup.py build_ext --inplace
+
+The application runs without them and falls back to plain OpenCV.
+"""
+from setuptools import Extension, setup
+
+setup(
+    name="bandacv-native",
+    ext_modules=[
+        Extension(
+            "src.vision._color_kernel",
+            sources=["src/vision/native/color_kernel.cpp"],
+            language="c++",
+            extra_compile_args=["-O3", "-std=c++11"],
+        ),
+    ],
+)
@@ -10,9 +10,10 @@ class AppConfig:
     # --- Camera Settings ---
     WEBCAM_INDEX = 0
     CAMERA_RESOLUTION = (600, 600)
+    CAMERA_THREADED_CAPTURE = True  # Capture on a background thread, always classify the newest frame
+    CAMERA_FRAME_TIMEOUT_SECONDS = 1.0  # How long calibration waits for a fresh frame
 
     # --- Vision Processing Thresholds ---
-    MAX_SAMPLES = 100  # For data deque in main
     LARGE_SIZE_THRESHOLD_CM = 5.0
     MEDIUM_SIZE_THRESHOLD_CM = 4.0
     SMALL_SIZE_THRESHOLD_CM = 2.0
@@ -22,8 +23,24 @@ class AppConfig:
 
     # --- Serial Communication Settings ---
     BAUDRATE = 9600
+    SERIAL_PORT = None  # Fixed port such as "/dev/ttyACM0"; None searches for SERIAL_DEVICE_IDENTIFIERS
     SERIAL_TIMEOUT_SECONDS = 1
     SERIAL_CONNECT_DELAY_SECONDS = 2  # Critical delay for some Arduinos to initialize
+    SERIAL_PREFER_BINARY_PROTOCOL = True  # Offer the binary frame protocol, fall back to ASCII
+    SERIAL_HANDSHAKE_TIMEOUT_SECONDS = 0.5
+    # Open the port with DTR low and ask the firmware for its state first, so a board whose
+    # auto-reset is disabled (see STAY_ALIVE_MODE in arduino_code/config.h) resumes without
+    # the connect delay. Boards that reset anyway are waited for as before.
+    SERIAL_SUPPRESS_DTR_RESET = True
+    SERIAL_RESUME_TIMEOUT_SECONDS = 0.05  # Wait for the answer at each rate; a running board answers in milliseconds
+    SERIAL_RX_QUEUE_SIZE = 4096  # Decoded samples/events buffered for the read loop, oldest dropped first
+    SERIAL_HIGH_SPEED_BAUDRATE = 1000000  # Requested in the handshake; 115200, 250000, 500000, 1000000 or None
+    # Bind to one board when several are attached (one per belt, see BELTS). SERIAL_DEVICE_ID is
+    # the ID the firmware reports and prints when connected (arduino_code/DeviceId.h), so it
+    # follows the board to any port; SERIAL_USB_SERIAL_NUMBER matches the USB adapter's serial
+    # number instead. None accepts any board.
+    SERIAL_DEVICE_ID = None
+    SERIAL_USB_SERIAL_NUMBER = None
     SERIAL_DEVICE_IDENTIFIERS = [
         "VID:PID=2341:0043",  # Arduino Uno
         "Arduino",
@@ -35,14 +52,85 @@ class AppConfig:
         "ttyUSB"              # Generic USB serial (often various microcontrollers)
     ]
 
+    # --- Diverter Bins ---
+    # Uploaded to the firmware at connect time (binary protocol only) and kept in
+    # its EEPROM; None leaves the table on the device alone. Class codes are the
+    # ServoCode values (0-2, 9 = unknown); codes up to 15 are free for composite
+    # classes such as "red circle".
+    DIVERTER_BIN_ANGLES = [30, 90, 150]       # Servo angle of each bin, up to 8
+    DIVERTER_CLASS_BINS = {0: 0, 1: 1, 2: 2}  # Class code -> bin index; unlisted codes go home
+
+    # --- Composite Classification ---
+    # Classifiers run together on every frame when "composite" is selected.
+    COMPOSITE_CLASSIFIERS = ("color", "shape")
+    # Class code of each combination of results, keyed in COMPOSITE_CLASSIFIERS
+    # order. Codes 3-8 and 10-15 are free; give them bins in DIVERTER_CLASS_BINS.
+    COMPOSITE_CLASS_CODES = {
+        ("Red", "Triangle"): 3, ("Red", "Square"): 4, ("Red", "Circle"): 5,
+        ("Yellow", "Triangle"): 6, ("Yellow", "Square"): 7, ("Yellow", "Circle"): 8,
+        ("Green", "Triangle"): 10, ("Green", "Square"): 11, ("Green", "Circle"): 12,
+    }
+
     # --- Application Logic Timings ---
-    DETECTION_PROCESSING_TIME_SECONDS = 2
-    UI_UPDATE_INTERVAL_MS = 0  # For UI refresh rate (0 means as fast as possible)
+    DETECTION_PROCESSING_TIME_SECONDS = 2  # Longest a part is classified before the leading vote is used
+    DETECTION_CONSECUTIVE_VOTES = 4  # Decide as soon as this many frames in a row agree; None disables
+    DETECTION_MAJORITY_SHARE = 0.75  # ...or as soon as one class has this share of the votes; None disables
+    DETECTION_MIN_VOTES = 6  # Votes needed before the majority rule applies
+    UI_UPDATE_INTERVAL_MS = 33  # Display refresh with VISION_PIPELINE; without it the UI timer runs as fast as possible
     HEARTBEAT_INTERVAL_SECONDS = 1
-    SERIAL_RECONNECT_DELAY_SECONDS = 1
+    DEVICE_STATS_INTERVAL_SECONDS = 30  # How often to query and log the firmware profiling counters; None disables
+    SERIAL_RECONNECT_DELAY_SECONDS = 0.2
     SERIAL_READ_LOOP_SLEEP_SECONDS = 0.05
     APP_SHUTDOWN_DELAY_SECONDS = 0.1
 
+    # --- RPM Graph ---
+    TELEMETRY_SAMPLE_RATE_HZ = 500  # Batched telemetry, TELEMETRY_SAMPLE_INTERVAL_US in arduino_code/config.h
+    RPM_HISTORY_SECONDS = 3600  # How far back the graph can go
+    MAX_SAMPLES = RPM_HISTORY_SECONDS * TELEMETRY_SAMPLE_RATE_HZ  # Telemetry samples kept
+    GRAPH_MAX_POINTS = 600  # Longer histories are drawn as the min/max of each stretch of samples
+    GRAPH_REFRESH_INTERVAL_SECONDS = 0.2
+
+    # --- Event Log ---
+    EVENT_LOG_DIRECTORY = "logs"  # Each run logs telemetry and decisions to a new directory here; None disables
+    EVENT_LOG_FLUSH_INTERVAL_SECONDS = 0.5
+    EVENT_LOG_FSYNC_INTERVAL_SECONDS = 5  # At most this much of the log is lost in a power cut
+    EVENT_LOG_MAX_PENDING_RECORDS = 100000  # Records waiting for the writer; further ones are dropped
+
+    # --- Metrics ---
+    # Frame rates, latencies, votes, serial link and firmware counters for Prometheus, at
+    # http://<METRICS_HOST>:<METRICS_PORT>/metrics; with BELTS, one endpoint labels every belt.
+    METRICS_PORT = 9108  # None disables
+    METRICS_HOST = "127.0.0.1"  # "0.0.0.0" to let another machine scrape it
+    METRICS_PUSH_INTERVAL_SECONDS = 1.0  # With BELTS, how often each belt's process reports its metrics
+
+    # --- Belts ---
+    # One host can drive several belts. Each entry overrides settings of this class for one belt,
+    # whose controller then runs in its own process and shows in its own tab, e.g.
+    #   BELTS = [{"NAME": "Line 1", "WEBCAM_INDEX": 0, "SERIAL_DEVICE_ID": 0x5E1A0C33},
+    #            {"NAME": "Line 2", "WEBCAM_INDEX": 2, "SERIAL_DEVICE_ID": 0x9B27F4D0}]
+    # Bind each belt to its board with SERIAL_DEVICE_ID or SERIAL_USB_SERIAL_NUMBER, since port
+    # names change with the order the boards enumerate in. None runs a single belt in this process.
+    BELTS = None
+
+    # --- Multi-Part Tracking ---
+    MULTI_PART_TRACKING = True  # Track and classify every part in view; False: one part at a time
+    TRACKER_MIN_BOX_AREA = 400  # px^2; smaller edge boxes are noise
+    TRACKER_IOU_THRESHOLD = 0.3
+    TRACKER_MAX_DISTANCE_PX = 80  # Centroid match when boxes no longer overlap between frames
+    TRACKER_MAX_MISSED_FRAMES = 5
+    TRACKER_CROP_MARGIN_PX = 10  # Context around a part's box given to the classifier
+    TRACK_OUTLINE_COLOR = (255, 0, 255)
+
+    # --- Vision Pipeline ---
+    VISION_PIPELINE = True  # Capture, analysis and decision on their own threads; False: all on the UI timer
+    VISION_WORKERS = None  # Analysis threads; None uses all cores but one
+    VISION_FRAME_QUEUE_SIZE = 2  # Captured frames waiting for a worker; the oldest is dropped when full
+    VISION_RESULT_BUFFER_SIZE = 8  # Analysed frames waiting for the decision stage; the workers wait when full
+    # "opencl" computes the color conversions, masks, blur and edges of every frame on the GPU
+    # through OpenCV's transparent API (cv2.UMat), leaving the CPU to the other stages; "cpu" otherwise.
+    # Falls back to the CPU when OpenCV finds no OpenCL device.
+    VISION_BACKEND = "cpu"
+
     # --- Color Detection HSV Ranges (example, these should be fine-tuned) ---
     RED_LOWER_HSV = (0, 120, 70)
     RED_UPPER_HSV = (10, 255, 255)
@@ -54,6 +142,12 @@ class AppConfig:
     # --- Kernel sizes for morphology operations ---
     MORPHOLOGY_KERNEL_SIZE = 5
 
+    # --- Region of Interest ---
+    ROI = None  # (x, y, width, height) the classifiers look at; None for the whole frame
+    BELT_MOVES_HORIZONTALLY = True  # Parts travel along the image x axis
+    ROI_LANE_MARGIN_CM = 1.5  # Calibration sets the ROI to the disc's lane plus this on each side; None: keep ROI
+    ROI_OUTLINE_COLOR = (255, 255, 0)
+
     # --- Font settings for OpenCV text ---
     OPENCV_FONT = cv2.FONT_HERSHEY_SIMPLEX
     OPENCV_FONT_SCALE = 0.5
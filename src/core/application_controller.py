@@ -1,12 +1,38 @@
+import os
 import time
 from collections import deque, Counter
 from threading import Thread, Event
+from typing import NamedTuple
 
 from src.config.config import AppConfig
+from src.core.event_log import EventLog
+from src.core.metrics import MetricsRegistry, MetricsServer
+from src.core.sample_history import SampleHistory
+from src.core.sequential_vote import SequentialVote
+from src.core.vision_pipeline import VisionPipeline
 from src.hardware.camera import Camera
+from src.hardware.protocol import ActionStatus, DeviceStats
 from src.hardware.serial_manager import SerialManager
 from src.vision.image_processor import ImageProcessor
-from src.vision.classifiers import BaseClassifier, ServoCode, ColorClassifier, ShapeClassifier, SizeClassifier
+from src.vision.classifiers import (BaseClassifier, ServoCode, ColorClassifier, CompositeClassifier, ShapeClassifier,
+                                    SizeClassifier)
+from src.vision.tracker import CentroidTracker, Track
+
+
+# Buckets of the share of a part's votes that its class had when it was decided.
+VOTE_SHARE_BUCKETS = (0.5, 0.6, 0.7, 0.8, 0.9, 0.99)
+
+
+class FrameAnalysis(NamedTuple):
+    """What the analysis of one frame hands to the decision stage."""
+    generation: int  # ApplicationController._vision_generation when the analysis started
+    frame_time: float
+    frame_tick: int | None
+    canvas: object  # Copy of the frame with the annotations
+    boxes: list | None  # Tracking: the parts found, None without a classifier
+    box_results: dict | None  # Tracking: box -> Classification
+    classification: tuple | None  # Single part: (ServoCode, friendly name) if the frame was classified
+
 
 class ApplicationController:
     """
@@ -14,7 +40,7 @@ class ApplicationController:
     """
     def __init__(self, config: AppConfig):
         self.config = config
-        self.camera = Camera(config.WEBCAM_INDEX, config.CAMERA_RESOLUTION)
+        self.camera = Camera(config.WEBCAM_INDEX, config.CAMERA_RESOLUTION, threaded=config.CAMERA_THREADED_CAPTURE)
         self.serial_manager = SerialManager(config, on_disconnect=self.handle_serial_disconnection)
         self.image_processor = ImageProcessor(config)
 
@@ -23,26 +49,61 @@ class ApplicationController:
             "shape": ShapeClassifier(config),
             "size": SizeClassifier(config)
         }
+        # Shares the instances above, so it uses the size calibration too.
+        self.classifiers["composite"] = CompositeClassifier(
+            config, [self.classifiers[key] for key in config.COMPOSITE_CLASSIFIERS])
         self.active_classifier_key = None
         self.active_classifier: BaseClassifier = None
 
-        self.data_deque = deque(maxlen=self.config.MAX_SAMPLES)
+        # (time, rpm, obstacle state) of the telemetry, for the graph and the polled sensor state.
+        self.samples = SampleHistory(self.config.MAX_SAMPLES)
         self.stop_event = Event()
         self.serial_read_thread = None
         self.heartbeat_thread = None
 
         self.pwm_value = 0
+        self.rpm_setpoint = 0
         self.current_servo_code = ServoCode.UNKNOWN
         self.pixels_per_cm = None
         self.calibrated = False
+        # Region of interest (x, y, width, height) the classifiers see; set by calibration.
+        self.roi = config.ROI
 
         self.is_classification_active = False
         self.previous_ir_state = 0
+        # (host time, encoder tick) of the rising obstacle edges reported by the
+        # firmware ISR, appended by the serial thread for process_video_frame.
+        self.ir_triggers = deque()
         self.detection_start_time = None
-        # Buffer for the hardware command value (e.g., '0', '1')
-        self.servo_codes_buffer = Counter()
+        self.detection_tick = None
+        self.next_part_id = 0
+        # Votes for the hardware command value (e.g., '0', '1'); decides early once they agree.
+        self.servo_codes_buffer = self._new_vote()
+        # With MULTI_PART_TRACKING every part in view has its own track and votes;
+        # edges wait here until the part they belong to shows up.
+        self.tracker = CentroidTracker(config.TRACKER_IOU_THRESHOLD, config.TRACKER_MAX_DISTANCE_PX,
+                                       config.TRACKER_MAX_MISSED_FRAMES, self._new_vote)
+        self.unmatched_triggers = deque()
         # Buffer for the display-friendly name (e.g., "Red", "Triangle")
         self.classification_name_buffer = Counter()
+        # Bumped when the classifier or the region of interest changes. Frames
+        # analysed before are not decided, and the decision stage starts over.
+        self._vision_generation = 0
+        self._decided_generation = 0
+        # Every run logs its telemetry and decisions to a new directory, for analysis after the shift.
+        self.event_log = None
+        if config.EVENT_LOG_DIRECTORY:
+            self.event_log = EventLog(os.path.join(config.EVENT_LOG_DIRECTORY, time.strftime("%Y%m%d-%H%M%S")),
+                                      config.EVENT_LOG_FLUSH_INTERVAL_SECONDS, config.EVENT_LOG_FSYNC_INTERVAL_SECONDS,
+                                      config.EVENT_LOG_MAX_PENDING_RECORDS)
+        self.pipeline = None
+        if config.VISION_PIPELINE:
+            workers = config.VISION_WORKERS or max(1, (os.cpu_count() or 1) - 1)
+            self.pipeline = VisionPipeline(self._capture_frame, self._analyse_frame, self._decide_frame, workers,
+                                           config.VISION_FRAME_QUEUE_SIZE, config.VISION_RESULT_BUFFER_SIZE)
+        self.metrics = MetricsRegistry()
+        self.metrics_server = None
+        self._register_metrics()
 
         # Callbacks for UI updates
         self.on_frame_update = None
@@ -52,6 +113,61 @@ class ApplicationController:
         self.on_status_message = None
         self.on_pwm_update = None
 
+    def _register_metrics(self):
+        """Creates the metrics the vision stages update, and the readings of everything else."""
+        metrics = self.metrics
+        self._frame_counters = {stage: metrics.counter("bandacv_frames_total", "Frames through each vision stage.",
+                                                       stage=stage)
+                                for stage in ("capture", "analysis", "decision", "display")}
+        self._analysis_seconds = metrics.histogram("bandacv_analysis_seconds", "Time to analyse one frame.")
+        self._frame_latency = metrics.histogram("bandacv_frame_latency_seconds",
+                                                "From a frame's capture until its decision stage is done.")
+        self._decision_latency = metrics.histogram("bandacv_decision_latency_seconds",
+                                                   "From a part's obstacle edge until its bin is sent.")
+        self._vote_share = metrics.histogram("bandacv_vote_share",
+                                             "Share of a part's votes that its class had when it was decided.",
+                                             VOTE_SHARE_BUCKETS)
+        metrics.counter("bandacv_camera_dropped_frames_total", "Frames the camera captured that were never read.",
+                        lambda: self.camera.dropped_frames)
+        if self.pipeline:
+            metrics.counter("bandacv_pipeline_dropped_frames_total",
+                            "Frames never analysed because all workers were busy.", lambda: self.pipeline.dropped_frames)
+        metrics.counter("bandacv_event_log_dropped_records_total", "Records the event log could not keep up with.",
+                        lambda: self.event_log.dropped_records if self.event_log else None)
+        metrics.gauge("bandacv_belt_rpm", "Latest belt speed.", lambda: (self.samples.latest() or (None, None))[1])
+        metrics.gauge("bandacv_belt_pwm", "PWM value sent to the motor.", lambda: self.pwm_value)
+
+        serial = self.serial_manager
+        metrics.gauge("bandacv_serial_connected", "Whether the board is connected.", lambda: int(serial.connected))
+        metrics.gauge("bandacv_serial_binary_protocol", "Whether the link uses the binary protocol.",
+                      lambda: int(serial.binary_protocol))
+        metrics.counter("bandacv_serial_received_bytes_total", "Bytes received from the board.",
+                        lambda: serial.received_bytes)
+        metrics.counter("bandacv_serial_sent_bytes_total", "Bytes sent to the board.", lambda: serial.sent_bytes)
+        errors = "Serial errors seen by the host."
+        metrics.counter("bandacv_serial_errors_total", errors, lambda: serial.crc_errors, kind="crc")
+        metrics.counter("bandacv_serial_errors_total", errors, lambda: serial.ascii_parse_errors, kind="ascii_parse")
+        metrics.counter("bandacv_serial_errors_total", errors, lambda: serial.link_errors, kind="link")
+        metrics.counter("bandacv_serial_connects_total", "Connections to the board, resumed sessions included.",
+                        lambda: serial.connect_count)
+        metrics.counter("bandacv_serial_resumes_total", "Connections that resumed the firmware's running session.",
+                        lambda: serial.resume_count)
+        # Counters of the firmware wrap around and restart with it, so they are gauges here.
+        for field in DeviceStats._fields:
+            metrics.gauge(f"bandacv_firmware_{field}", f"Firmware profiling value {field} of the last STATS report.",
+                          lambda field=field: getattr(serial.device_stats, field) if serial.device_stats else None)
+
+    def _record_decision(self, code_value: str, votes: SequentialVote, trigger_time: float | None):
+        """Updates the metrics of a part whose bin was just decided."""
+        self.metrics.counter("bandacv_decisions_total", "Parts decided, by class code.", class_code=code_value).inc()
+        self._vote_share.observe(votes.counts[code_value] / len(votes))
+        if trigger_time is not None:
+            self._decision_latency.observe(time.time() - trigger_time)
+
+    def _new_vote(self) -> SequentialVote:
+        return SequentialVote(self.config.DETECTION_CONSECUTIVE_VOTES, self.config.DETECTION_MAJORITY_SHARE,
+                              self.config.DETECTION_MIN_VOTES, ignored=ServoCode.UNKNOWN.value)
+
     def register_ui_callbacks(self, on_frame_update, on_graph_update, on_led_update, on_calibration_update, on_status_message, on_pwm_update):
         self.on_frame_update = on_frame_update
         self.on_graph_update = on_graph_update
@@ -67,12 +183,20 @@ class ApplicationController:
 
     def _read_serial_data_loop(self):
         start_time_read = time.time()
+        last_graph_update = 0.0
+        graph_stale = False
         while not self.stop_event.is_set():
             if not self.serial_manager.connected:
                 if self.serial_manager.connect():
+                    if self.serial_manager.resumed:
+                        # The firmware kept the belt and the servo queue going; carry on where we were.
+                        if self.on_status_message:
+                            self.on_status_message("Serial device reconnected, session resumed.")
+                        continue
                     if self.on_status_message:
                         self.on_status_message("Serial device reconnected.")
                     self.pwm_value = 0
+                    self.rpm_setpoint = 0
                     self.current_servo_code = ServoCode.UNKNOWN
                     if self.on_pwm_update:
                         self.on_pwm_update(self.pwm_value)
@@ -80,23 +204,61 @@ class ApplicationController:
                     time.sleep(self.config.SERIAL_RECONNECT_DELAY_SECONDS)
                     continue
 
-            data = self.serial_manager.read_data()
-            if data is not None:
-                rpm_value, obstacle_sensor_state_value = data
-                current_time = time.time() - start_time_read
-                self.data_deque.append((current_time, rpm_value, obstacle_sensor_state_value))
-
-                if self.on_graph_update:
-                    time_values = [d[0] for d in self.data_deque]
-                    rpm_values = [d[1] for d in self.data_deque]
-                    self.on_graph_update(time_values, rpm_values)
+            # Waits for the serial reader thread instead of polling.
+            samples = self.serial_manager.read_samples(timeout=self.config.SERIAL_READ_LOOP_SLEEP_SECONDS)
+            events = self.serial_manager.read_obstacle_events()
+            now = time.time()
+            for event in events:
+                if event.state == 1:
+                    self.ir_triggers.append((event.host_time if event.host_time is not None else now, event.tick))
+                if self.event_log:
+                    self.event_log.log_edge(event, now)
                 if self.on_led_update:
-                    self.on_led_update(obstacle_sensor_state_value)
-            else:
-                time.sleep(self.config.SERIAL_READ_LOOP_SLEEP_SECONDS)
+                    self.on_led_update(event.state)
+            for action in self.serial_manager.read_action_events():
+                if self.event_log:
+                    self.event_log.log_action(action, now)
+                if action.status == ActionStatus.DROPPED and self.on_status_message:
+                    self.on_status_message(f"Servo queue full, part {action.part_id} was not sorted.")
+
+            if samples:
+                last_timestamp_us = samples[-1].timestamp_us
+                for sample in samples:
+                    sample_time = now
+                    if sample.timestamp_us is not None:
+                        # Batched samples are spread back in time by their device timestamps.
+                        sample_time -= ((last_timestamp_us - sample.timestamp_us) & 0xFFFFFFFF) / 1e6
+                    self.samples.append(sample_time - start_time_read, sample.rpm, sample.obstacle_state)
+                    if self.event_log:
+                        self.event_log.log_telemetry(sample_time, sample)
+                graph_stale = True
+                if self.on_led_update and not events:
+                    self.on_led_update(samples[-1].obstacle_state)
+
+            # Redrawing costs the same however many samples arrived, so it follows its own clock.
+            if graph_stale and self.on_graph_update and \
+                    time.monotonic() - last_graph_update >= self.config.GRAPH_REFRESH_INTERVAL_SECONDS:
+                self.on_graph_update(*self.samples.decimated(self.config.GRAPH_MAX_POINTS))
+                last_graph_update = time.monotonic()
+                graph_stale = False
 
     def start(self):
         self.camera.initialize()
+        if self.event_log:
+            try:
+                self.event_log.start()
+            except OSError as e:
+                print(f"Event log disabled: {e}")
+                self.event_log = None
+        if self.config.METRICS_PORT is not None:
+            self.metrics_server = MetricsServer(self.metrics.collect, self.config.METRICS_PORT, self.config.METRICS_HOST)
+            try:
+                self.metrics_server.start()
+            except OSError as e:
+                print(f"Metrics endpoint disabled: {e}")
+                self.metrics_server = None
+        if self.pipeline:
+            self.pipeline.start()
         self.serial_read_thread = Thread(target=self._read_serial_data_loop)
         self.serial_read_thread.start()
         self.heartbeat_thread = Thread(target=self._send_heartbeat_loop)
@@ -106,6 +268,8 @@ class ApplicationController:
 
     def stop(self):
         self.stop_event.set()
+        if self.pipeline:
+            self.pipeline.stop()
         print("Sending stop command to motor...")
         self.serial_manager.send_command(0, ServoCode.UNKNOWN)
         time.sleep(self.config.APP_SHUTDOWN_DELAY_SECONDS)
@@ -117,21 +281,41 @@ class ApplicationController:
         
         self.serial_manager.disconnect()
         self.camera.release()
+        if self.event_log:
+            self.event_log.stop()
+        if self.metrics_server:
+            self.metrics_server.stop()
+            self.metrics_server = None
+        self.classifiers["composite"].close()
         if self.on_status_message:
             self.on_status_message("Application stopped.")
 
     def set_pwm(self, value: int):
         self.pwm_value = value
-        self.serial_manager.send_command(self.pwm_value, self.current_servo_code)
+        self.serial_manager.send_command(self.pwm_value, None)
+
+    def set_rpm_setpoint(self, rpm: int) -> bool:
+        """Hands belt speed control to the firmware PID loop (0 returns to PWM)."""
+        if not self.serial_manager.set_rpm_setpoint(rpm):
+            if self.on_status_message:
+                self.on_status_message("RPM control requires a connected device with the binary protocol.")
+            return False
+        self.rpm_setpoint = rpm
+        if self.on_status_message:
+            self.on_status_message(f"RPM setpoint: {rpm}" if rpm > 0 else "RPM control disabled, using PWM.")
+        return True
 
     def set_active_classifier(self, classifier_key: str) -> bool:
         if classifier_key in self.classifiers:
-            if classifier_key == "size" and not self.calibrated:
+            needs_calibration = classifier_key == "size" or \
+                (classifier_key == "composite" and "size" in self.config.COMPOSITE_CLASSIFIERS)
+            if needs_calibration and not self.calibrated:
                 if self.on_status_message:
                     self.on_status_message("Please calibrate the camera before using size detection.")
                 return False
             self.active_classifier_key = classifier_key
             self.active_classifier = self.classifiers[classifier_key]
+            self._vision_generation += 1
             if self.on_status_message:
                 self.on_status_message(f"Classifier set to: {classifier_key}")
             return True
@@ -143,7 +327,9 @@ class ApplicationController:
             return False
 
     def calibrate_camera(self):
-        frame = self.camera.read_frame()
+        timeout = self.config.CAMERA_FRAME_TIMEOUT_SECONDS
+        # The pipeline's capture thread owns the camera.
+        frame = self.pipeline.next_frame(timeout) if self.pipeline else self.camera.read_frame(timeout=timeout)
         if frame is None:
             if self.on_status_message:
                 self.on_status_message("Cannot calibrate: No frame from camera.")
@@ -155,6 +341,10 @@ class ApplicationController:
         if pixels_per_cm is not None:
             self.pixels_per_cm = pixels_per_cm
             self.calibrated = True
+            if self.config.ROI_LANE_MARGIN_CM is not None:
+                self.roi = self._lane_roi(size_classifier.calibration_rect, frame.shape)
+                self.image_processor.set_roi(self.roi)
+                self._vision_generation += 1
             if self.on_calibration_update:
                 self.on_calibration_update(pixels_per_cm)
             if self.on_status_message:
@@ -164,52 +354,279 @@ class ApplicationController:
             if self.on_status_message:
                 self.on_status_message("Calibration failed. Ensure a circular object is in view.")
 
+    def _lane_roi(self, calibration_rect: tuple, frame_shape: tuple) -> tuple[int, int, int, int]:
+        """Returns the belt lane through the calibration disc, spanning the frame along the belt."""
+        x, y, w, h = calibration_rect
+        margin = round(self.config.ROI_LANE_MARGIN_CM * self.pixels_per_cm)
+        frame_height, frame_width = frame_shape[:2]
+        if self.config.BELT_MOVES_HORIZONTALLY:
+            top, bottom = max(0, y - margin), min(frame_height, y + h + margin)
+            return 0, top, frame_width, bottom - top
+        left, right = max(0, x - margin), min(frame_width, x + w + margin)
+        return left, 0, right - left, frame_height
+
+    def update_ui(self):
+        """Called by the UI timer.
+
+        With VISION_PIPELINE this shows the newest processed frame, at the
+        timer's rate; otherwise it drives the vision path itself.
+        """
+        if self.pipeline is None:
+            self.process_video_frame()
+            return
+        frame = self.pipeline.take_output()
+        if frame is not None:
+            self._frame_counters["display"].inc()
+            if self.on_frame_update:
+                self.on_frame_update(frame)
+
     def process_video_frame(self):
+        """Captures, analyses and decides one frame on the calling thread, without the pipeline."""
         if self.stop_event.is_set(): return
-        frame = self.camera.read_frame()
+        # In threaded capture mode this is None until the camera delivers a new frame.
+        frame, frame_time = self.camera.read_frame_with_timestamp()
         if frame is None: return
+        self._frame_counters["capture"].inc()
+        processed_frame = self._decide_frame(self._analyse_frame(frame, frame_time))
+        self._frame_counters["display"].inc()
+        if self.on_frame_update:
+            self.on_frame_update(processed_frame)
+
+    def _capture_frame(self, timeout: float):
+        """The pipeline's capture stage. The camera reuses its buffers, so the frame is copied."""
+        frame, frame_time = self.camera.read_frame_with_timestamp(timeout)
+        if frame is None:
+            return None, frame_time
+        self._frame_counters["capture"].inc()
+        return frame.copy(), frame_time
 
-        processed_frame = frame.copy()
-        current_ir_state = self.data_deque[-1][2] if self.data_deque else 0
+    def _part_pending(self) -> bool:
+        """Whether a part is being classified or about to be, in single-part mode.
+
+        Read by the analysis workers without synchronization; a frame analysed
+        just before an edge arrives merely lacks a vote.
+        """
+        return self.is_classification_active or bool(self.ir_triggers) or self.samples.latest_obstacle_state() == 1
+
+    def _analyse_frame(self, frame, frame_time: float) -> FrameAnalysis:
+        """The work on a frame that does not depend on the frames before it.
+
+        Runs on the pipeline's workers, several frames at once. The frame is
+        left alone; the annotations go onto a copy.
+        """
+        start = time.perf_counter()
+        generation = self._vision_generation
+        classifier = self.active_classifier
+        # Where the belt was when the frame was exposed; None without binary telemetry.
+        frame_tick = self.serial_manager.belt_clock.tick_at(frame_time)
+        canvas = frame.copy()
+        boxes = box_results = classification = None
+        if self.config.MULTI_PART_TRACKING:
+            if classifier:
+                features = self.image_processor.extract_features(frame)
+                boxes = self.image_processor.detect_objects(features)
+                # Which tracks still need votes is only known in frame order, so every part in view is classified.
+                box_results = {box: self.image_processor.classify_box(features, canvas, box, classifier)
+                               for box in boxes}
+        elif classifier and self._part_pending():
+            result = self.image_processor.classify_frame(self.image_processor.extract_features(frame), canvas,
+                                                         classifier)
+            classification = (result.servo_code, result.name)
+        self._analysis_seconds.observe(time.perf_counter() - start)
+        self._frame_counters["analysis"].inc()
+        return FrameAnalysis(generation, frame_time, frame_tick, canvas, boxes, box_results, classification)
+
+    def _decide_frame(self, analysis: FrameAnalysis):
+        """The work on a frame that carries over between frames: edges, tracks, votes and dispatch.
+
+        Runs on the pipeline's decision thread, one frame at a time in capture
+        order. Returns the processed frame for the UI.
+        """
+        processed_frame = self._decide_parts(analysis)
+        self._frame_counters["decision"].inc()
+        self._frame_latency.observe(time.time() - analysis.frame_time)
+        return processed_frame
+
+    def _decide_parts(self, analysis: FrameAnalysis):
+        """_decide_frame() without the metrics."""
+        if analysis.generation != self._vision_generation:
+            # Analysed with the previous classifier or region; its edges wait for the next frame.
+            return analysis.canvas
+        if self._decided_generation != analysis.generation:
+            # Votes and tracks of the previous classifier or region mean nothing now.
+            self._decided_generation = analysis.generation
+            self.tracker.clear()
+
+        current_ir_state = self.samples.latest_obstacle_state()
+        polled_edge = current_ir_state == 1 and self.previous_ir_state == 0
+        self.previous_ir_state = current_ir_state
+
+        # Edges timestamped by the firmware are never missed, even if the part
+        # passes between two telemetry samples; the polled edge is the fallback.
+        triggers = []
+        while self.ir_triggers:
+            triggers.append(self.ir_triggers.popleft())
+
+        if self.config.MULTI_PART_TRACKING:
+            # The ASCII protocol reports no edges, only the sampled sensor state.
+            if polled_edge and not self.serial_manager.binary_protocol:
+                now = time.time()
+                triggers.append((now, self.serial_manager.belt_clock.tick_at(now)))
+            return self._decide_tracked_frame(analysis, triggers)
+        return self._decide_single_part_frame(analysis, triggers, polled_edge)
+
+    @staticmethod
+    def _captured_after(frame_time: float, frame_tick: int | None, trigger_time: float,
+                        trigger_tick: int | None) -> bool:
+        """Whether a frame shows the belt after a part's edge, by belt position when both ticks are known."""
+        if frame_tick is not None and trigger_tick is not None:
+            return (frame_tick - trigger_tick) & 0xFFFFFFFF < 0x80000000
+        return frame_time >= trigger_time
+
+    def _decide_single_part_frame(self, analysis: FrameAnalysis, triggers: list, polled_edge: bool):
+        """Classifies one part at a time: the whole view from its edge until its votes are conclusive."""
+        processed_frame = analysis.canvas
+        trigger_time, trigger_tick = triggers[-1] if triggers else (None, None)
+        ir_triggered = trigger_time is not None or polled_edge
 
         if not self.is_classification_active:
-            if current_ir_state == 1 and self.previous_ir_state == 0:
+            if ir_triggered:
                 if not self.active_classifier:
                     if self.on_status_message:
                         self.on_status_message("Obstacle detected. Select a classifier to begin.")
                 else:
                     self.is_classification_active = True
-                    self.detection_start_time = time.time()
+                    # Align the detection window with when the part actually arrived.
+                    if trigger_time is not None:
+                        self.detection_start_time, self.detection_tick = trigger_time, trigger_tick
+                    else:
+                        self.detection_start_time = time.time()
+                        self.detection_tick = self.serial_manager.belt_clock.tick_at(self.detection_start_time)
                     self.servo_codes_buffer.clear()
                     self.classification_name_buffer.clear()
                     if self.on_status_message:
                         self.on_status_message("IR Triggered! Classifying...")
         else:
-            if self.active_classifier:
-                servo_code_result, processed_frame, friendly_name = self.image_processor.process_frame(frame, self.active_classifier)
-                self.servo_codes_buffer[servo_code_result.value] += 1
+            # Frames captured before the part arrived may still be on their way through the pipeline.
+            if analysis.classification and self._captured_after(analysis.frame_time, analysis.frame_tick,
+                                                                self.detection_start_time, self.detection_tick):
+                servo_code_result, friendly_name = analysis.classification
+                self.servo_codes_buffer.add(servo_code_result.value)
                 self.classification_name_buffer[friendly_name] += 1
 
-            if time.time() - self.detection_start_time >= self.config.DETECTION_PROCESSING_TIME_SECONDS:
+            # The fixed window is only the timeout for parts that never get conclusive votes.
+            early_code_value = self.servo_codes_buffer.decision()
+            if early_code_value is not None or \
+                    time.time() - self.detection_start_time >= self.config.DETECTION_PROCESSING_TIME_SECONDS:
                 if self.servo_codes_buffer:
-                    most_common_code_value = self.servo_codes_buffer.most_common(1)[0][0]
+                    most_common_code_value = early_code_value or self.servo_codes_buffer.leader()
                     most_common_name = self.classification_name_buffer.most_common(1)[0][0]
                     
                     self.current_servo_code = ServoCode(most_common_code_value)
-                    self.serial_manager.send_command(self.pwm_value, self.current_servo_code)
+                    part_id = self._dispatch_servo_code(self.current_servo_code, self.detection_tick)
+                    self._record_decision(most_common_code_value, self.servo_codes_buffer, self.detection_start_time)
+                    if self.event_log:
+                        self.event_log.log_decision(
+                            None, int(most_common_code_value), len(self.servo_codes_buffer),
+                            self.servo_codes_buffer.counts[most_common_code_value], self.detection_start_time,
+                            analysis.frame_time, self.detection_tick, part_id)
                     
                     if self.on_status_message:
                         self.on_status_message(f"Classification complete: {most_common_name}")
                 
                 self.is_classification_active = False
                 self.detection_start_time = None
+                self.detection_tick = None
                 self.servo_codes_buffer.clear()
                 self.classification_name_buffer.clear()
 
-        self.previous_ir_state = current_ir_state
+        return processed_frame
 
-        if self.on_frame_update:
-            self.on_frame_update(processed_frame)
+    def _decide_tracked_frame(self, analysis: FrameAnalysis, triggers: list):
+        """Tracks every part in view and classifies each one on its own.
+
+        Parts pass the sensor in the order they appear, so each edge goes to
+        the oldest track without one that appeared within
+        DETECTION_PROCESSING_TIME_SECONDS of it. A track is classified on its
+        own crop from its edge on, and its bin is scheduled at its own tick as
+        soon as its votes are conclusive, so several parts can be in flight.
+        """
+        processed_frame = analysis.canvas
+        if analysis.box_results is None:
+            if triggers and self.on_status_message:
+                self.on_status_message("Obstacle detected. Select a classifier to begin.")
+            self.unmatched_triggers.clear()
+            return processed_frame
+
+        window = self.config.DETECTION_PROCESSING_TIME_SECONDS
+        now = time.time()
+        self.unmatched_triggers.extend(triggers)
+        # An edge whose part never showed up was noise, not the next part.
+        while self.unmatched_triggers and now - self.unmatched_triggers[0][0] > window:
+            self.unmatched_triggers.popleft()
+
+        tracks, lost = self.tracker.update(analysis.boxes, analysis.frame_time)
+        for track in tracks:
+            if track.trigger_time is not None:
+                continue
+            while self.unmatched_triggers and self.unmatched_triggers[0][0] < track.first_seen_time - window:
+                self.unmatched_triggers.popleft()
+            # A track far older than the edge is something lying in view, not the part.
+            if self.unmatched_triggers and self.unmatched_triggers[0][0] <= track.first_seen_time + window:
+                track.trigger_time, track.trigger_tick = self.unmatched_triggers.popleft()
+
+        for track in tracks:
+            classifying = track.trigger_time is not None and not track.decided
+            # Frames captured before the part arrived may still be on their way through the pipeline.
+            if classifying and track.missed_frames == 0 and \
+                    self._captured_after(analysis.frame_time, analysis.frame_tick, track.trigger_time,
+                                         track.trigger_tick):
+                result = analysis.box_results[track.box]
+                track.votes.add(result.servo_code.value)
+                track.names[result.name] += 1
+            if classifying and track.votes:
+                code_value = track.votes.decision()
+                if code_value is None and now - track.trigger_time >= window:
+                    code_value = track.votes.leader()
+                if code_value is not None:
+                    self._decide_track(track, code_value, analysis.frame_time)
+            label = track.names.most_common(1)[0][0] if track.names else ""
+            self.image_processor.draw_track(processed_frame, track.track_id, track.box, label)
+
+        for track in lost:
+            # The part left the view before its votes were conclusive.
+            if track.trigger_time is not None and not track.decided and track.votes:
+                self._decide_track(track, track.votes.leader(), analysis.frame_time)
+        return processed_frame
+
+    def _decide_track(self, track: Track, code_value: str, frame_time: float):
+        track.decided = True
+        self.current_servo_code = ServoCode(code_value)
+        part_id = self._dispatch_servo_code(self.current_servo_code, track.trigger_tick)
+        self._record_decision(code_value, track.votes, track.trigger_time)
+        if self.event_log:
+            self.event_log.log_decision(track.track_id, int(code_value), len(track.votes),
+                                        track.votes.counts[code_value], track.trigger_time, frame_time,
+                                        track.trigger_tick, part_id)
+        if self.on_status_message:
+            self.on_status_message(f"Part {track.track_id} classified: {track.names.most_common(1)[0][0]}")
+
+    def _dispatch_servo_code(self, servo_code: ServoCode, detection_tick: int | None) -> int | None:
+        """Sends the classification result of a part.
+
+        If the part's encoder tick is known, the firmware moves the servo once
+        the part reaches the gate; otherwise the servo moves right away.
+
+        Returns:
+            int | None: The part id of the scheduled move, None if the servo was moved right away.
+        """
+        if detection_tick is not None and \
+                self.serial_manager.schedule_servo_action(self.next_part_id, servo_code, detection_tick):
+            part_id = self.next_part_id
+            self.next_part_id = (self.next_part_id + 1) & 0xFFFF
+            return part_id
+        self.serial_manager.send_command(self.pwm_value, servo_code)
+        return None
 
     def send_debug_servo_command(self, servo_code: ServoCode):
         if self.on_status_message:
@@ -218,7 +635,14 @@ class ApplicationController:
         self.serial_manager.send_command(self.pwm_value, self.current_servo_code)
 
     def _send_heartbeat_loop(self):
+        last_stats_time = time.monotonic()
         while not self.stop_event.is_set():
             if self.serial_manager.connected:
-                self.serial_manager.send_command(self.pwm_value, self.current_servo_code)
+                # Keep the servo where it is so scheduled moves are not overridden.
+                self.serial_manager.send_command(self.pwm_value, None)
+                stats_interval = self.config.DEVICE_STATS_INTERVAL_SECONDS
+                if stats_interval and time.monotonic() - last_stats_time >= stats_interval:
+                    # Each report covers the loop timing since the previous one.
+                    self.serial_manager.request_device_stats(reset=True)
+                    last_stats_time = time.monotonic()
             time.sleep(self.config.HEARTBEAT_INTERVAL_SECONDS)
@@ -0,0 +1,193 @@
+"""Runs the controller of one belt in its own process, for hosts that drive several belts (AppConfig.BELTS)."""
+import multiprocessing
+import os
+import queue
+import re
+import time
+
+from src.config.config import AppConfig
+from src.core.metrics import label_families
+from src.core.shared_frame import SharedFrameBuffer
+
+# The controller methods the UI may call; each is a round trip to the worker process.
+COMMANDS = ("set_pwm", "set_rpm_setpoint", "set_active_classifier", "calibrate_camera", "send_debug_servo_command")
+
+
+def belt_config(overrides: dict) -> AppConfig:
+    """The configuration of one belt: AppConfig with the belt's entry of BELTS applied.
+
+    Each belt logs to its own directory under EVENT_LOG_DIRECTORY unless the
+    entry sets one.
+    """
+    attributes = dict(overrides)
+    name = attributes.setdefault("NAME", f"Belt {attributes.get('WEBCAM_INDEX', AppConfig.WEBCAM_INDEX)}")
+    if AppConfig.EVENT_LOG_DIRECTORY and "EVENT_LOG_DIRECTORY" not in attributes:
+        attributes["EVENT_LOG_DIRECTORY"] = os.path.join(AppConfig.EVENT_LOG_DIRECTORY,
+                                                         re.sub(r'\W+', '-', name).strip('-').lower())
+    return type("BeltConfig", (AppConfig,), attributes)()
+
+
+def run_belt(overrides: dict, frames: SharedFrameBuffer, events, commands):
+    """Entry point of a belt's worker process.
+
+    Runs an ApplicationController without a window: processed frames go to
+    the shared frame buffer and the other UI callbacks to the events queue
+    as (callback name, *args) tuples. Commands arrive on the commands pipe
+    as (method name, *args) and are answered with the method's result;
+    ("stop",) stops the controller and ends the process. With METRICS_PORT
+    set, the controller's metrics are sent as a ("metrics", families) event
+    every METRICS_PUSH_INTERVAL_SECONDS, for the endpoint of the UI process.
+    """
+    # Imported here so that the UI process does not load the vision stack for every belt.
+    from src.core.application_controller import ApplicationController
+
+    config = belt_config({**overrides, "METRICS_PORT": None})  # The UI process serves all belts
+    controller = ApplicationController(config)
+    controller.register_ui_callbacks(
+        frames.publish,
+        lambda times, rpms: events.put(("graph", times, rpms)),
+        lambda state: events.put(("led", state)),
+        lambda pixels_per_cm: events.put(("calibration", pixels_per_cm)),
+        lambda message: events.put(("status", message)),
+        lambda pwm: events.put(("pwm", pwm)))
+    try:
+        controller.start()
+    except IOError as e:
+        events.put(("status", f"{config.NAME} could not start: {e}"))
+        controller.stop()
+        frames.close()
+        return
+    interval = max(1, config.UI_UPDATE_INTERVAL_MS) / 1000 if config.VISION_PIPELINE else 0.001
+    last_metrics = 0.0
+    try:
+        while True:
+            if AppConfig.METRICS_PORT is not None and \
+                    time.monotonic() - last_metrics >= config.METRICS_PUSH_INTERVAL_SECONDS:
+                events.put(("metrics", controller.metrics.collect()))
+                last_metrics = time.monotonic()
+            # Waiting for a command paces the display like the UI timer of a single belt.
+            if commands.poll(interval):
+                name, *args = commands.recv()
+                if name == "stop":
+                    break
+                commands.send(getattr(controller, name)(*args) if name in COMMANDS else None)
+            controller.update_ui()
+    finally:
+        controller.stop()
+        frames.close()
+    commands.send(None)
+
+
+class BeltProcess:
+    """Stands in for the ApplicationController of one belt whose controller runs in a worker process.
+
+    It offers the part of the controller interface that MainWindow uses,
+    so each belt gets the usual window: update_ui() delivers the frames and
+    events the worker produced since the last call to the registered
+    callbacks, on the caller's thread, and the commands block until the
+    worker has carried them out.
+
+    Args:
+        overrides (dict): The belt's entry of AppConfig.BELTS.
+    """
+    def __init__(self, overrides: dict):
+        self.overrides = overrides
+        self.config = belt_config(overrides)
+        self.name = self.config.NAME
+        self.pwm_value = 0
+        self._metrics = []  # The latest families the worker reported
+        self.on_frame_update = None
+        self._callbacks = {}
+        self._context = multiprocessing.get_context("spawn")
+        self._frames = SharedFrameBuffer(self.config.CAMERA_RESOLUTION)
+        self._events = self._context.Queue()
+        self._commands, self._worker_commands = self._context.Pipe()
+        self._process = None
+
+    def register_ui_callbacks(self, on_frame_update, on_graph_update, on_led_update, on_calibration_update,
+                              on_status_message, on_pwm_update):
+        self.on_frame_update = on_frame_update
+        self._callbacks = {"graph": on_graph_update, "led": on_led_update, "calibration": on_calibration_update,
+                           "status": on_status_message, "pwm": on_pwm_update}
+
+    def start(self):
+        """Starts the worker process."""
+        self._process = self._context.Process(target=run_belt, name=f"belt-{self.name}",
+                                              args=(self.overrides, self._frames, self._events, self._worker_commands))
+        self._process.start()
+
+    def stop(self):
+        """Stops the worker's controller and waits for the process to end. Safe to call twice."""
+        if self._process is None:
+            return
+        if self._process.is_alive():
+            self._commands.send(("stop",))
+            if self._commands.poll(self.config.APP_SHUTDOWN_DELAY_SECONDS + self.config.SERIAL_TIMEOUT_SECONDS + 5):
+                self._commands.recv()
+            # The worker only exits once its queued events are read.
+            deadline = time.monotonic() + 5
+            while self._process.is_alive() and time.monotonic() < deadline:
+                self._dispatch_events()
+                self._process.join(0.05)
+            if self._process.is_alive():
+                self._process.terminate()
+        self._process = None
+        self._dispatch_events()
+        self.on_frame_update = None
+        self._frames.close()
+
+    def update_ui(self):
+        """Called by the UI timer: hands on the newest frame and the pending events."""
+        if self._process is None:
+            return
+        self._dispatch_events()
+        frame, _ = self._frames.take()
+        if frame is not None and self.on_frame_update:
+            self.on_frame_update(frame)
+
+    def _dispatch_events(self):
+        while True:
+            try:
+                name, *args = self._events.get_nowait()
+            except queue.Empty:
+                return
+            if name == "pwm":
+                self.pwm_value = args[0]
+            elif name == "metrics":
+                self._metrics = args[0]
+            callback = self._callbacks.get(name)
+            if callback:
+                callback(*args)
+
+    def metrics_families(self) -> list:
+        """The belt's metrics as last reported by its worker, labelled with the belt's name."""
+        up = self._process is not None and self._process.is_alive()
+        families = [("bandacv_belt_up", "gauge", "Whether the belt's worker process is running.",
+                     [("bandacv_belt_up", (), int(up))])]
+        return label_families(families + self._metrics, belt=self.name)
+
+    def _call(self, name: str, *args):
+        """Runs a controller method in the worker and returns its result, or None if the worker is gone."""
+        if self._process is None or not self._process.is_alive():
+            return None
+        self._commands.send((name, *args))
+        while not self._commands.poll(0.1):
+            if not self._process.is_alive():
+                return None
+        return self._commands.recv()
+
+    def set_pwm(self, value: int):
+        self.pwm_value = value
+        self._call("set_pwm", value)
+
+    def set_rpm_setpoint(self, rpm: int) -> bool:
+        return bool(self._call("set_rpm_setpoint", rpm))
+
+    def set_active_classifier(self, classifier_key: str) -> bool:
+        return bool(self._call("set_active_classifier", classifier_key))
+
+    def calibrate_camera(self):
+        self._call("calibrate_camera")
+
+    def send_debug_servo_command(self, servo_code):
+        self._call("send_debug_servo_command", servo_code)
@@ -0,0 +1,213 @@
+"""Append-only binary log of the telemetry and the sorting decisions of a run.
+
+Every stream is a file of fixed-size little-endian records behind a short
+header, so it can be mapped straight into a NumPy record array with
+load_stream(), and a file cut short by a crash only loses its last, partial
+record. Unknown values (e.g. ticks over the ASCII protocol) are stored as
+the all-ones value of their field, see UNKNOWN.
+"""
+import os
+import re
+import struct
+import threading
+import time
+from collections import deque, namedtuple
+
+import numpy as np
+
+HEADER_FORMAT = struct.Struct('<8sHHI')  # Magic, format version, record size, reserved
+HEADER_MAGIC = b'BANDACV\x00'
+FORMAT_VERSION = 1
+
+UNKNOWN = 0xFFFFFFFF  # 32-bit fields; 16-bit fields use 0xFFFF
+TELEMETRY_FLAG_OBSTACLE = 0x01
+TELEMETRY_FLAG_SERVO_READY = 0x02
+TELEMETRY_FLAG_DEVICE_TIME = 0x04  # device_us and tick are valid (binary protocol)
+TELEMETRY_FLAG_PWM = 0x08  # pwm is valid (batched samples)
+
+# Stream name -> (record format, field names); the file is <name>.bin.
+STREAMS = {
+    # A telemetry sample; host_time is when it was sampled, as far as the host can tell.
+    "telemetry": ('<dIIHBB', ('host_time', 'device_us', 'tick', 'rpm', 'pwm', 'flags')),
+    # An obstacle sensor edge timestamped by the firmware.
+    "edges": ('<dIIB3x', ('host_time', 'device_us', 'tick', 'state')),
+    # A part's bin was decided: when, from the votes of which frames, and how it was sent.
+    # part_id is the SCHEDULE id, UNKNOWN 16-bit if the servo was moved right away.
+    "decisions": ('<dddIIHHHBx', ('host_time', 'trigger_time', 'frame_time', 'track_id', 'detection_tick',
+                                  'part_id', 'votes', 'leader_votes', 'class_code')),
+    # The outcome of a scheduled move reported by the firmware (ActionStatus).
+    "actions": ('<dIHBB', ('host_time', 'tick', 'part_id', 'servo_code', 'status')),
+}
+
+_NUMPY_TYPES = {'d': '<f8', 'I': '<u4', 'H': '<u2', 'B': 'u1'}
+
+
+def stream_dtype(name: str) -> np.dtype:
+    """The NumPy record type of a stream, laid out exactly like its struct format."""
+    record_format, fields = STREAMS[name]
+    names, formats, offsets = [], [], []
+    offset = 0
+    field_names = iter(fields)
+    for count, code in re.findall(r'(\d*)(\w)', record_format[1:]):
+        if code != 'x':
+            names.append(next(field_names))
+            formats.append(_NUMPY_TYPES[code])
+            offsets.append(offset)
+        offset += struct.calcsize('<' + count + code)
+    return np.dtype({'names': names, 'formats': formats, 'offsets': offsets, 'itemsize': offset})
+
+
+def load_stream(path) -> np.ndarray:
+    """Maps a stream file read-only as a record array, e.g. load_stream("logs/<run>/telemetry.bin")["rpm"].
+
+    Raises:
+        ValueError: If the file is not a log stream of this format.
+    """
+    name = os.path.splitext(os.path.basename(path))[0]
+    with open(path, 'rb') as log:
+        magic, version, record_size, _ = HEADER_FORMAT.unpack(log.read(HEADER_FORMAT.size))
+    dtype = stream_dtype(name)
+    if magic != HEADER_MAGIC or version != FORMAT_VERSION or record_size != dtype.itemsize:
+        raise ValueError(f"{path} is not a version {FORMAT_VERSION} {name} log")
+    records = (os.path.getsize(path) - HEADER_FORMAT.size) // record_size
+    if records == 0:
+        return np.zeros(0, dtype=dtype)
+    return np.memmap(path, dtype=dtype, mode='r', offset=HEADER_FORMAT.size, shape=(records,))
+
+
+def read_records(path) -> list:
+    """The records of a stream file as namedtuples, without NumPy."""
+    name = os.path.splitext(os.path.basename(path))[0]
+    record_format, fields = STREAMS[name]
+    record = struct.Struct(record_format)
+    Record = namedtuple(name.capitalize(), fields)
+    with open(path, 'rb') as log:
+        log.read(HEADER_FORMAT.size)
+        data = log.read()
+    usable = len(data) - len(data) % record.size
+    return [Record(*values) for values in record.iter_unpack(data[:usable])]
+
+
+class EventLog:
+    """Streams telemetry and sorting events to disk on a background thread.
+
+    The log_* methods only append to a queue, so the serial and vision
+    threads never wait for the disk. The writer thread packs what has been
+    queued every flush_interval seconds and writes each stream in one call;
+    every fsync_interval seconds it also forces the files to disk, which
+    bounds what a power cut can take. If the writer falls behind by more
+    than max_pending records, new ones are dropped and counted.
+
+    Args:
+        directory (str): Where the stream files are created; appended to if they exist.
+        flush_interval (float): Seconds between writes.
+        fsync_interval (float): Seconds between fsyncs.
+        max_pending (int): Most records waiting for the writer.
+    """
+    def __init__(self, directory: str, flush_interval: float = 0.5, fsync_interval: float = 5.0,
+                 max_pending: int = 100000):
+        self.directory = directory
+        self.flush_interval = flush_interval
+        self.fsync_interval = fsync_interval
+        self.max_pending = max_pending
+        self.dropped_records = 0
+        self._formats = {name: struct.Struct(record_format) for name, (record_format, _) in STREAMS.items()}
+        # (stream, values) tuples; deque appends and pops are atomic, so producers take no lock.
+        self._pending = deque()
+        self._files = {}
+        self._stop_event = threading.Event()
+        self._thread = None
+
+    def start(self):
+        """Opens the stream files and starts the writer.
+
+        Raises:
+            OSError: If the directory or the files cannot be created.
+        """
+        os.makedirs(self.directory, exist_ok=True)
+        for name, record in self._formats.items():
+            log = open(os.path.join(self.directory, name + '.bin'), 'ab')
+            if log.tell() == 0:
+                log.write(HEADER_FORMAT.pack(HEADER_MAGIC, FORMAT_VERSION, record.size, 0))
+            self._files[name] = log
+        self._stop_event.clear()
+        self._thread = threading.Thread(target=self._write_loop, name="event-log", daemon=True)
+        self._thread.start()
+
+    def stop(self):
+        """Writes everything still queued, syncs and closes the files."""
+        self._stop_event.set()
+        if self._thread is not None:
+            self._thread.join()
+            self._thread = None
+        for log in self._files.values():
+            log.close()
+        self._files = {}
+
+    def _queue(self, stream: str, values: tuple):
+        if len(self._pending) >= self.max_pending:
+            self.dropped_records += 1
+            return
+        self._pending.append((stream, values))
+
+    def log_telemetry(self, host_time: float, sample):
+        """Logs a TelemetrySample."""
+        flags = (TELEMETRY_FLAG_OBSTACLE if sample.obstacle_state else 0) | \
+            (TELEMETRY_FLAG_SERVO_READY if sample.servo_ready else 0) | \
+            (TELEMETRY_FLAG_DEVICE_TIME if sample.timestamp_us is not None else 0) | \
+            (TELEMETRY_FLAG_PWM if sample.pwm is not None else 0)
+        self._queue("telemetry", (host_time, UNKNOWN if sample.timestamp_us is None else sample.timestamp_us,
+                                  UNKNOWN if sample.tick is None else sample.tick, sample.rpm,
+                                  0 if sample.pwm is None else sample.pwm, flags))
+
+    def log_edge(self, event, host_time: float):
+        """Logs an ObstacleEvent; host_time is used if the event has none yet."""
+        self._queue("edges", (event.host_time if event.host_time is not None else host_time,
+                              event.timestamp_us, event.tick, event.state))
+
+    def log_decision(self, track_id: int | None, class_code: int, votes: int, leader_votes: int,
+                     trigger_time: float | None, frame_time: float | None, detection_tick: int | None,
+                     part_id: int | None):
+        """Logs that a part's bin was decided, now."""
+        self._queue("decisions", (time.time(), float('nan') if trigger_time is None else trigger_time,
+                                  float('nan') if frame_time is None else frame_time,
+                                  UNKNOWN if track_id is None else track_id,
+                                  UNKNOWN if detection_tick is None else detection_tick,
+                                  0xFFFF if part_id is None else part_id,
+                                  min(votes, 0xFFFF), min(leader_votes, 0xFFFF), class_code))
+
+    def log_action(self, action, host_time: float):
+        """Logs an ActionEvent received at host_time."""
+        self._queue("actions", (host_time, action.tick, action.part_id, action.servo_code, int(action.status)))
+
+    def _write_loop(self):
+        last_sync = time.monotonic()
+        while True:
+            stopping = self._stop_event.wait(self.flush_interval)
+            self._write_pending()
+            if stopping or time.monotonic() - last_sync >= self.fsync_interval:
+                try:
+                    for log in self._files.values():
+                        os.fsync(log.fileno())
+                except OSError as e:
+                    print(f"Error syncing event log: {e}")
+                last_sync = time.monotonic()
+            if stopping:
+                return
+
+    def _write_pending(self):
+        batches = {name: [] for name in self._files}
+        for _ in range(len(self._pending)):
+            stream, values = self._pending.popleft()
+            try:
+                batches[stream].append(self._formats[stream].pack(*values))
+            except struct.error:
+                self.dropped_records += 1  # A value out of its field's range
+        try:
+            for name, records in batches.items():
+                if records:
+                    self._files[name].write(b''.join(records))
+                    # Readers, and load_stream() in particular, see whole batches.
+                    self._files[name].flush()
+        except OSError as e:
+            print(f"Error writing event log: {e}")
@@ -0,0 +1,233 @@
+"""Live counters, histograms and gauges of a belt, served over HTTP in the Prometheus text format.
+
+The hot paths (vision stages, serial threads) only touch the counters and
+histograms, which take no lock. Everything else is a gauge or counter read
+from the object that already keeps the value, when the endpoint is scraped.
+"""
+import bisect
+import math
+import threading
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+
+# Buckets of latency histograms, in seconds.
+LATENCY_BUCKETS = (0.005, 0.01, 0.02, 0.05, 0.1, 0.2, 0.5, 1.0, 2.0, 5.0)
+
+
+class _PerThreadCells:
+    """Values that each thread updates in a cell that only it writes.
+
+    A reader sums the cells, so updates need no lock and never contend; a
+    reader racing an update sees it or not, but never a torn value. A cell
+    outlives its thread, so nothing counted is lost.
+    """
+    def __init__(self, size: int):
+        self._size = size
+        self._local = threading.local()
+        self._cells = []  # list.append is atomic
+
+    def cell(self) -> list:
+        cell = getattr(self._local, "cell", None)
+        if cell is None:
+            cell = self._local.cell = [0] * self._size
+            self._cells.append(cell)
+        return cell
+
+    def totals(self) -> list:
+        totals = [0] * self._size
+        for cell in list(self._cells):
+            for index, value in enumerate(cell):
+                totals[index] += value
+        return totals
+
+
+class Counter:
+    """A count that only goes up; inc() is safe from any thread."""
+    def __init__(self):
+        self._cells = _PerThreadCells(1)
+
+    def inc(self, amount: float = 1):
+        self._cells.cell()[0] += amount
+
+    @property
+    def value(self) -> float:
+        return self._cells.totals()[0]
+
+    def samples(self, name: str, labels: tuple) -> list:
+        return [(name, labels, self.value)]
+
+
+class Histogram:
+    """Counts observations into buckets by upper bound; observe() is safe from any thread.
+
+    Args:
+        buckets (tuple): Upper bounds, ascending; +Inf is implied.
+    """
+    def __init__(self, buckets: tuple = LATENCY_BUCKETS):
+        self.buckets = tuple(buckets)
+        # Per bucket count, then the sum and the count of all observations.
+        self._cells = _PerThreadCells(len(self.buckets) + 3)
+
+    def observe(self, value: float):
+        cell = self._cells.cell()
+        cell[bisect.bisect_left(self.buckets, value)] += 1
+        cell[-2] += value
+        cell[-1] += 1
+
+    def samples(self, name: str, labels: tuple) -> list:
+        totals = self._cells.totals()
+        samples, cumulative = [], 0
+        for bound, count in zip(self.buckets + (math.inf,), totals):
+            cumulative += count
+            samples.append((name + "_bucket", labels + (("le", _format_value(bound)),), cumulative))
+        return samples + [(name + "_sum", labels, totals[-2]), (name + "_count", labels, totals[-1])]
+
+
+class Reading:
+    """A value read from elsewhere at scrape time; a function returning None leaves it out."""
+    def __init__(self, function):
+        self.function = function
+
+    def samples(self, name: str, labels: tuple) -> list:
+        value = self.function()
+        return [] if value is None else [(name, labels, float(value))]
+
+
+class MetricsRegistry:
+    """The metrics of one controller, by name and labels.
+
+    The counter(), histogram() and gauge() calls return the metric of that
+    name and label set, creating it on first use; callers keep it and
+    update it directly. collect() snapshots all of them as picklable
+    families, e.g. to send them to another process, and render() turns
+    families into the text exposition format.
+    """
+    def __init__(self):
+        # name -> [type, help, {labels: metric}]; guarded by _lock for creation only.
+        self._families = {}
+        self._lock = threading.Lock()
+
+    def _metric(self, kind: str, name: str, help_text: str, labels: dict, factory):
+        key = tuple(sorted(labels.items()))
+        family = self._families.get(name)
+        metric = family[2].get(key) if family else None
+        if metric is not None:
+            return metric
+        with self._lock:
+            family = self._families.setdefault(name, [kind, help_text, {}])
+            if family[0] != kind:
+                raise ValueError(f"Metric {name} is a {family[0]}, not a {kind}")
+            return family[2].setdefault(key, factory())
+
+    def counter(self, name: str, help_text: str, function=None, **labels):
+        """A Counter, or with function a counter kept elsewhere and read when scraped."""
+        return self._metric("counter", name, help_text, labels,
+                            (lambda: Reading(function)) if function else Counter)
+
+    def histogram(self, name: str, help_text: str, buckets: tuple = LATENCY_BUCKETS, **labels) -> Histogram:
+        return self._metric("histogram", name, help_text, labels, lambda: Histogram(buckets))
+
+    def gauge(self, name: str, help_text: str, function, **labels) -> Reading:
+        """A value read by calling function when scraped."""
+        return self._metric("gauge", name, help_text, labels, lambda: Reading(function))
+
+    def collect(self) -> list:
+        """The current values as (name, type, help, [(sample name, labels, value)]) families."""
+        families = []
+        for name, (kind, help_text, metrics) in list(self._families.items()):
+            samples = []
+            for labels, metric in list(metrics.items()):
+                try:
+                    samples += metric.samples(name, labels)
+                except Exception as e:  # A reading of an object that is being torn down
+                    print(f"Error reading metric {name}: {e}")
+            families.append((name, kind, help_text, samples))
+        return families
+
+
+def label_families(families: list, **labels) -> list:
+    """The families with labels added to every sample, e.g. belt="Line 1"."""
+    extra = tuple(labels.items())
+    return [(name, kind, help_text, [(sample, extra + sample_labels, value)
+                                     for sample, sample_labels, value in samples])
+            for name, kind, help_text, samples in families]
+
+
+def _format_value(value: float) -> str:
+    if math.isinf(value):
+        return "+Inf" if value > 0 else "-Inf"
+    if math.isnan(value):
+        return "NaN"
+    return repr(float(value)) if value != int(value) else str(int(value))
+
+
+def _escape(value) -> str:
+    return str(value).replace("\\", r"\\").replace("\n", r"\n").replace('"', r'\"')
+
+
+def render(families: list) -> str:
+    """The families in the Prometheus text exposition format; families with the same name are merged."""
+    merged = {}
+    for name, kind, help_text, samples in families:
+        merged.setdefault(name, (kind, help_text, []))[2].extend(samples)
+    lines = []
+    for name, (kind, help_text, samples) in merged.items():
+        lines.append(f"# HELP {name} {_escape(help_text)}")
+        lines.append(f"# TYPE {name} {kind}")
+        for sample, labels, value in samples:
+            label_text = ",".join(f'{key}="{_escape(label)}"' for key, label in labels)
+            lines.append(f"{sample}{{{label_text}}} {_format_value(value)}" if labels else
+                         f"{sample} {_format_value(value)}")
+    return "\n".join(lines) + "\n"
+
+
+class MetricsServer:
+    """Serves GET /metrics from a background thread.
+
+    Args:
+        collect (callable): () -> families, called for every scrape.
+        port (int): TCP port; 0 picks a free one, see port after start().
+        host (str): Address to listen on.
+    """
+    def __init__(self, collect, port: int, host: str = "127.0.0.1"):
+        self.collect = collect
+        self.port = port
+        self.host = host
+        self._server = None
+        self._thread = None
+
+    def start(self):
+        """Starts listening.
+
+        Raises:
+            OSError: If the port cannot be bound.
+        """
+        collect = self.collect
+
+        class Handler(BaseHTTPRequestHandler):
+            def do_GET(self):
+                if self.path.split("?")[0] != "/metrics":
+                    self.send_error(404)
+                    return
+                body = render(collect()).encode("utf-8")
+                self.send_response(200)
+                self.send_header("Content-Type", "text/plain; version=0.0.4; charset=utf-8")
+                self.send_header("Content-Length", str(len(body)))
+                self.end_headers()
+                self.wfile.write(body)
+
+            def log_message(self, format, *args):
+                pass  # A request every scrape interval would drown the console
+
+        self._server = ThreadingHTTPServer((self.host, self.port), Handler)
+        self._server.daemon_threads = True
+        self.port = self._server.server_address[1]
+        self._thread = threading.Thread(target=self._server.serve_forever, name="metrics-http", daemon=True)
+        self._thread.start()
+        print(f"Metrics served at http://{self.host}:{self.port}/metrics")
+
+    def stop(self):
+        if self._server is not None:
+            self._server.shutdown()
+            self._server.server_close()
+            self._thread.join()
+            self._server = None
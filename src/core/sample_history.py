@@ -0,0 +1,147 @@
+import threading
+import numpy as np
+
+
+def _newest_ranges(end: int, count: int, capacity: int, n: int) -> list[tuple[int, int]]:
+    """The index ranges of the newest n entries of a ring, oldest first."""
+    start = end - min(n, count)
+    if start >= 0:
+        return [(start, end)]
+    return [(capacity + start, capacity), (0, end)]
+
+
+def _gather(array: np.ndarray, ranges: list[tuple[int, int]]) -> np.ndarray:
+    return np.concatenate([array[start:stop] for start, stop in ranges])
+
+
+def _count_since(times: np.ndarray, end: int, count: int, capacity: int, since: float) -> int:
+    """How many entries of a ring, whose times increase along it, are at or after since."""
+    return sum((stop - start) - int(np.searchsorted(times[start:stop], since))
+               for start, stop in _newest_ranges(end, count, capacity, count))
+
+
+class _SummaryLevel:
+    """A ring of (time, min, max) entries, each summarising DECIMATION_FACTOR entries of the level below."""
+    def __init__(self, capacity: int):
+        self.capacity = capacity
+        self.times = np.empty(capacity)
+        self.lows = np.empty(capacity)
+        self.highs = np.empty(capacity)
+        self.end = 0
+        self.count = 0
+        # The entry being built from the level below; covers the newest samples.
+        self.pending = 0
+        self.pending_time = self.pending_low = self.pending_high = 0.0
+
+    def push(self, time: float, low: float, high: float):
+        self.times[self.end] = time
+        self.lows[self.end] = low
+        self.highs[self.end] = high
+        self.end = (self.end + 1) % self.capacity
+        self.count = min(self.count + 1, self.capacity)
+
+
+class SampleHistory:
+    """The newest telemetry samples, in preallocated NumPy rings.
+
+    Appending takes constant time and allocates nothing. Besides the samples,
+    every summary level keeps one (time, min, max) entry per
+    DECIMATION_FACTOR entries of the level below, so decimated() reads about
+    max_points entries however long the history is, and keeps the spikes
+    that plain subsampling would skip. Sample times must not decrease.
+
+    The serial thread appends while the UI reads, so access is locked.
+
+    Args:
+        capacity (int): Samples kept; the oldest ones are overwritten.
+    """
+    DECIMATION_FACTOR = 8
+
+    def __init__(self, capacity: int):
+        self.capacity = max(1, int(capacity))
+        self._times = np.empty(self.capacity)
+        self._rpms = np.empty(self.capacity)
+        self._states = np.empty(self.capacity, dtype=np.uint8)
+        self._end = 0
+        self._count = 0
+        self._levels = []
+        span = self.DECIMATION_FACTOR
+        while span < self.capacity:
+            self._levels.append(_SummaryLevel(-(-self.capacity // span)))
+            span *= self.DECIMATION_FACTOR
+        self._lock = threading.Lock()
+
+    def __len__(self):
+        with self._lock:
+            return self._count
+
+    def append(self, sample_time: float, rpm: float, obstacle_state: int):
+        with self._lock:
+            self._times[self._end] = sample_time
+            self._rpms[self._end] = rpm
+            self._states[self._end] = obstacle_state
+            self._end = (self._end + 1) % self.capacity
+            self._count = min(self._count + 1, self.capacity)
+            self._summarise(sample_time, rpm, rpm)
+
+    def _summarise(self, time: float, low: float, high: float):
+        for level in self._levels:
+            if level.pending == 0:
+                level.pending_time, level.pending_low, level.pending_high = time, low, high
+            else:
+                level.pending_low = min(level.pending_low, low)
+                level.pending_high = max(level.pending_high, high)
+            level.pending += 1
+            if level.pending < self.DECIMATION_FACTOR:
+                return
+            level.pending = 0
+            time, low, high = level.pending_time, level.pending_low, level.pending_high
+            level.push(time, low, high)
+
+    def latest(self) -> tuple[float, float, int] | None:
+        """The newest (time, rpm, obstacle state), or None if there are no samples."""
+        with self._lock:
+            if not self._count:
+                return None
+            index = self._end - 1
+            return float(self._times[index]), float(self._rpms[index]), int(self._states[index])
+
+    def latest_obstacle_state(self) -> int:
+        with self._lock:
+            return int(self._states[self._end - 1]) if self._count else 0
+
+    def decimated(self, max_points: int, since: float | None = None) -> tuple[np.ndarray, np.ndarray]:
+        """The samples from since (default: the oldest) on, reduced to about max_points for display.
+
+        Returns the samples themselves if there are few enough; otherwise,
+        from the finest summary level that fits, each entry as its minimum and
+        its maximum at the entry's time.
+
+        Returns:
+            tuple[np.ndarray, np.ndarray]: Copies of the times and the rpm values.
+        """
+        with self._lock:
+            if not self._count:
+                return np.empty(0), np.empty(0)
+            oldest = float(self._times[_newest_ranges(self._end, self._count, self.capacity, self._count)[0][0]])
+            since = oldest if since is None else max(since, oldest)
+            count = _count_since(self._times, self._end, self._count, self.capacity, since)
+            if count <= max_points or not self._levels:
+                ranges = _newest_ranges(self._end, self._count, self.capacity, count)
+                return _gather(self._times, ranges), _gather(self._rpms, ranges)
+
+            for index, level in enumerate(self._levels):
+                count = _count_since(level.times, level.end, level.count, level.capacity, since)
+                # The newest samples are still in the pending entries of this level and the ones below.
+                pending = [below for below in reversed(self._levels[:index + 1]) if below.pending]
+                if 2 * (count + len(pending)) <= max_points or index == len(self._levels) - 1:
+                    break
+            ranges = _newest_ranges(level.end, level.count, level.capacity, count)
+            times = np.concatenate([_gather(level.times, ranges), [below.pending_time for below in pending]])
+            lows = np.concatenate([_gather(level.lows, ranges), [below.pending_low for below in pending]])
+            highs = np.concatenate([_gather(level.highs, ranges), [below.pending_high for below in pending]])
+            points = 2 * len(times)
+            point_times, values = np.empty(points), np.empty(points)
+            point_times[0::2] = point_times[1::2] = times
+            values[0::2], values[1::2] = lows, highs
+            return point_times, values
@@ -0,0 +1,62 @@
+from collections import Counter
+
+
+class SequentialVote:
+    """Collects the per-frame classification votes of one part.
+
+    decision() reports the winner as soon as the votes are conclusive instead
+    of after a fixed window: either the leading class got the last
+    consecutive_votes votes in a row, or it holds at least majority_share of
+    at least min_votes votes. The ignored value (the unknown class) never wins
+    early, but it does count against the leader's share.
+
+    Args:
+        consecutive_votes (int | None): Length of a run that decides; None disables.
+        majority_share (float | None): Share of the votes that decides; None disables.
+        min_votes (int): Votes needed before the majority rule applies.
+        ignored (hashable, optional): A value that cannot win early.
+    """
+    def __init__(self, consecutive_votes: int | None, majority_share: float | None, min_votes: int,
+                 ignored=None):
+        self.consecutive_votes = consecutive_votes
+        self.majority_share = majority_share
+        self.min_votes = min_votes
+        self.ignored = ignored
+        self.counts = Counter()
+        self._run_value = None
+        self._run_length = 0
+
+    def __bool__(self) -> bool:
+        return bool(self.counts)
+
+    def __len__(self) -> int:
+        return self.counts.total()
+
+    def add(self, value):
+        self.counts[value] += 1
+        if value == self._run_value:
+            self._run_length += 1
+        else:
+            self._run_value = value
+            self._run_length = 1
+
+    def clear(self):
+        self.counts.clear()
+        self._run_value = None
+        self._run_length = 0
+
+    def leader(self):
+        """The value with the most votes so far, or None without votes."""
+        return self.counts.most_common(1)[0][0] if self.counts else None
+
+    def decision(self):
+        """The winning value if the votes are already conclusive, otherwise None."""
+        if self.consecutive_votes and self._run_value != self.ignored and \
+                self._run_length >= self.consecutive_votes:
+            return self._run_value
+        total = len(self)
+        if self.majority_share and total >= self.min_votes:
+            value, count = self.counts.most_common(1)[0]
+            if value != self.ignored and count >= self.majority_share * total:
+                return value
+        return None
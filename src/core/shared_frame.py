@@ -0,0 +1,105 @@
+"""Hands the newest frame of a belt's worker process to the UI process without pickling it."""
+import multiprocessing
+from multiprocessing import shared_memory
+
+import cv2
+import numpy as np
+
+# Control block at the start of the segment; the frame slots follow it.
+_CONTROL_SIZE = 64
+_READY, _READ, _NEW_FRAME = range(3)
+
+
+class SharedFrameBuffer:
+    """A triple buffer of BGR frames in shared memory, one writer process and one reader process.
+
+    Works like the capture buffer of Camera, across processes: publish()
+    copies a frame into the writer's slot and swaps it with the ready slot,
+    take() swaps the ready slot with the reader's slot and returns a view of
+    it. Only the swaps take the lock, as the writer's slot is never visible
+    to the reader. Neither side ever waits for the other beyond the swap.
+    A frame is never taken twice, and frames the reader did not take in
+    time are overwritten. The buffer is created by the reader and handed to
+    the writer as an argument of its Process, which attaches to the same
+    segment by name.
+
+    Args:
+        max_size (tuple): (width, height) of the largest frame, like
+            CAMERA_RESOLUTION; larger frames are scaled down to fit.
+    """
+    def __init__(self, max_size: tuple[int, int]):
+        self.max_size = tuple(max_size)
+        self.dropped_frames = 0  # Writer side: frames overwritten before they were taken
+        self._lock = multiprocessing.get_context("spawn").Lock()
+        width, height = self.max_size
+        size = _CONTROL_SIZE + 3 * width * height * 3
+        self._memory = shared_memory.SharedMemory(create=True, size=size)
+        self._owner = True
+        self._map()
+        self._control[:] = (1, 2, 0)
+
+    def _map(self):
+        width, height = self.max_size
+        buffer = self._memory.buf
+        # Guarded by the lock: the ready and read slot indices and whether the ready slot is new.
+        self._control = np.ndarray((3,), np.int32, buffer, 0)
+        # Per slot (height, width) of its frame and capture time, written with the slot.
+        self._shapes = np.ndarray((3, 2), np.int32, buffer, 16)
+        self._times = np.ndarray((3,), np.float64, buffer, 40)
+        self._slots = np.ndarray((3, height * width * 3), np.uint8, buffer, _CONTROL_SIZE)
+        self._capture_index = 0  # Not shared; only the writer uses it
+
+    def __getstate__(self):
+        return self.max_size, self._lock, self._memory.name
+
+    def __setstate__(self, state):
+        self.max_size, self._lock, name = state
+        self.dropped_frames = 0
+        # A spawned process shares the creator's resource tracker, so attaching
+        # does not make the segment outlive the creator's unlink().
+        self._memory = shared_memory.SharedMemory(name=name)
+        self._owner = False
+        self._map()
+
+    def publish(self, frame: np.ndarray, frame_time: float = 0.0):
+        """Writer side: makes a BGR frame the newest one."""
+        width, height = self.max_size
+        if frame.shape[1] > width or frame.shape[0] > height:
+            scale = min(width / frame.shape[1], height / frame.shape[0])
+            frame = cv2.resize(frame, (max(1, int(frame.shape[1] * scale)), max(1, int(frame.shape[0] * scale))),
+                               interpolation=cv2.INTER_AREA)
+        index = self._capture_index
+        np.copyto(self._slots[index, :frame.size].reshape(frame.shape), frame)
+        self._shapes[index] = frame.shape[:2]
+        self._times[index] = frame_time
+        with self._lock:
+            if self._control[_NEW_FRAME]:
+                self.dropped_frames += 1
+            self._capture_index, self._control[_READY] = int(self._control[_READY]), index
+            self._control[_NEW_FRAME] = 1
+
+    def take(self) -> tuple[np.ndarray | None, float | None]:
+        """Reader side: the newest frame not taken before, and its time.
+
+        Returns:
+            tuple[np.ndarray | None, float | None]: A view of the frame, valid
+            until the next call, or (None, None) if no new frame was published.
+        """
+        with self._lock:
+            if not self._control[_NEW_FRAME]:
+                return None, None
+            self._control[_READ], self._control[_READY] = self._control[_READY], self._control[_READ]
+            self._control[_NEW_FRAME] = 0
+            index = int(self._control[_READ])
+        height, width = self._shapes[index]
+        return self._slots[index, :height * width * 3].reshape(height, width, 3), float(self._times[index])
+
+    def close(self):
+        """Detaches from the segment, and frees it on the side that created it.
+
+        Views returned by take() must not be used afterwards.
+        """
+        self._control = self._shapes = self._times = self._slots = None
+        self._memory.close()
+        if self._owner:
+            self._memory.unlink()
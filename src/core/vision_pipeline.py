@@ -0,0 +1,198 @@
+import threading
+from collections import deque
+
+
+class DropOldestQueue:
+    """A bounded FIFO between two pipeline stages whose producer never waits.
+
+    When the queue is full, put() discards the oldest item, so a consumer
+    that falls behind works on the newest frames instead of an ever older
+    backlog.
+
+    Args:
+        maxsize (int): Most items held.
+    """
+    def __init__(self, maxsize: int):
+        self.dropped = 0
+        self._items = deque(maxlen=maxsize)
+        self._condition = threading.Condition()
+        self._closed = False
+
+    def put(self, item):
+        with self._condition:
+            if len(self._items) == self._items.maxlen:
+                self.dropped += 1
+            self._items.append(item)
+            self._condition.notify()
+
+    def get(self, timeout: float | None = None):
+        """Removes and returns the oldest item; None after timeout seconds or once closed."""
+        with self._condition:
+            self._condition.wait_for(lambda: self._items or self._closed, timeout)
+            if self._closed or not self._items:
+                return None
+            return self._items.popleft()
+
+    def close(self):
+        """Wakes up all waiting consumers; get() returns None from now on."""
+        with self._condition:
+            self._closed = True
+            self._items.clear()
+            self._condition.notify_all()
+
+    def __len__(self):
+        with self._condition:
+            return len(self._items)
+
+
+class VisionPipeline:
+    """Runs the vision path as stages on their own threads, joined by bounded queues.
+
+        capture -> frame queue -> analysis workers -> result buffer -> decision -> output slot
+
+    The capture thread reads frames as fast as the camera delivers them into
+    the frame queue, which drops the oldest frame when all workers are busy.
+    The workers analyse frames in parallel (OpenCV and the native kernels
+    release the GIL). The decision stage needs the frames in capture order for
+    tracking and voting, so it runs on one thread and the result buffer puts
+    the workers' results back in order; when the decision stage falls behind,
+    the workers wait for it and the frame queue drops frames instead. The
+    processed frame of each decision replaces the previous one in the output
+    slot, from which the UI takes the newest one at its own rate.
+
+    Args:
+        read_frame (callable): (timeout) -> (frame, capture_time), frame None if
+            none arrived. The frame is shared by the stages and must not change.
+        analyse (callable): (frame, capture_time) -> result, on a worker thread.
+        decide (callable): (result) -> output frame, on the decision thread.
+        workers (int): Analysis threads.
+        frame_queue_size (int): Captured frames waiting for a worker.
+        result_buffer_size (int): Analysed frames waiting for the decision stage.
+        read_timeout (float): How long the capture thread waits for a frame at a time.
+    """
+    def __init__(self, read_frame, analyse, decide, workers: int, frame_queue_size: int,
+                 result_buffer_size: int, read_timeout: float = 0.1):
+        self.read_frame = read_frame
+        self.analyse = analyse
+        self.decide = decide
+        self.workers = max(1, workers)
+        self.read_timeout = read_timeout
+        self.frames = DropOldestQueue(frame_queue_size)
+        self.result_buffer_size = max(1, result_buffer_size)
+        self._stop_event = threading.Event()
+        self._threads = []
+
+        # Frames are numbered as the workers take them, so the numbers have no gaps.
+        self._take_lock = threading.Lock()
+        self._next_number = 0
+        # Frame number -> analysis result; guarded by _result_condition.
+        self._results = {}
+        self._next_decision = 0
+        self._result_condition = threading.Condition()
+
+        # The last captured frame, for next_frame(); guarded by _capture_condition.
+        self._last_frame = None
+        self._captured = 0
+        self._capture_condition = threading.Condition()
+
+        self._output = None
+        self._output_lock = threading.Lock()
+
+    @property
+    def dropped_frames(self) -> int:
+        """Frames captured but never analysed because the workers were busy."""
+        return self.frames.dropped
+
+    def start(self):
+        self._stop_event.clear()
+        self._threads = [threading.Thread(target=self._capture_loop, name="vision-capture", daemon=True),
+                         threading.Thread(target=self._decision_loop, name="vision-decision", daemon=True)]
+        self._threads += [threading.Thread(target=self._analysis_loop, name=f"vision-worker-{index}", daemon=True)
+                          for index in range(self.workers)]
+        for thread in self._threads:
+            thread.start()
+
+    def stop(self, timeout: float = 1.0):
+        """Stops all stages. Frames still in the pipeline are discarded."""
+        self._stop_event.set()
+        self.frames.close()
+        with self._result_condition:
+            self._result_condition.notify_all()
+        with self._capture_condition:
+            self._capture_condition.notify_all()
+        for thread in self._threads:
+            thread.join(timeout)
+        self._threads = []
+
+    def take_output(self):
+        """Returns the newest processed frame not taken before, or None."""
+        with self._output_lock:
+            output, self._output = self._output, None
+            return output
+
+    def next_frame(self, timeout: float):
+        """Waits up to timeout seconds for the next captured frame, e.g. for calibration."""
+        with self._capture_condition:
+            captured = self._captured
+            self._capture_condition.wait_for(lambda: self._captured > captured or self._stop_event.is_set(),
+                                             timeout)
+            return self._last_frame if self._captured > captured else None
+
+    def _capture_loop(self):
+        while not self._stop_event.is_set():
+            try:
+                frame, capture_time = self.read_frame(self.read_timeout)
+            except Exception as e:
+                print(f"Error capturing frame: {e}")
+                self._stop_event.wait(self.read_timeout)
+                continue
+            if frame is None:
+                continue
+            with self._capture_condition:
+                self._last_frame = frame
+                self._captured += 1
+                self._capture_condition.notify_all()
+            self.frames.put((frame, capture_time))
+
+    def _analysis_loop(self):
+        while not self._stop_event.is_set():
+            with self._take_lock:
+                item = self.frames.get(self.read_timeout)
+                if item is None:
+                    continue
+                number = self._next_number
+                self._next_number += 1
+            try:
+                result = self.analyse(*item)
+            except Exception as e:
+                # The decision stage still has to move past this frame.
+                print(f"Error analysing frame: {e}")
+                result = None
+            with self._result_condition:
+                # The frame the decision stage waits for is always let in, or the buffer could fill up without it.
+                self._result_condition.wait_for(
+                    lambda: len(self._results) < self.result_buffer_size or number == self._next_decision or
+                    self._stop_event.is_set())
+                self._results[number] = result
+                self._result_condition.notify_all()
+
+    def _decision_loop(self):
+        while not self._stop_event.is_set():
+            with self._result_condition:
+                if not self._result_condition.wait_for(lambda: self._next_decision in self._results or
+                                                       self._stop_event.is_set(), self.read_timeout):
+                    continue
+                if self._stop_event.is_set():
+                    return
+                result = self._results.pop(self._next_decision)
+                self._next_decision += 1
+                self._result_condition.notify_all()
+            if result is None:
+                continue
+            try:
+                output = self.decide(result)
+            except Exception as e:
+                print(f"Error deciding frame: {e}")
+                continue
+            with self._output_lock:
+                self._output = output
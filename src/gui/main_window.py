@@ -97,7 +97,7 @@ class ServoDebugPanel(QWidget):
 class MainWindow(QMainWindow):
     """The main window of the BandaCV application."""
     frame_update_signal = pyqtSignal(np.ndarray)
-    graph_update_signal = pyqtSignal(list, list)
+    graph_update_signal = pyqtSignal(np.ndarray, np.ndarray)
     led_update_signal = pyqtSignal(int)
     calibration_update_signal = pyqtSignal(float)
     status_message_signal = pyqtSignal(str)
@@ -126,9 +126,10 @@ class MainWindow(QMainWindow):
             self.status_message_signal.emit, self.pwm_update_signal.emit
         )
 
+        # With the vision pipeline the timer only paces the display, otherwise it drives the vision path.
         self.video_timer = QTimer(self)
-        self.video_timer.timeout.connect(self.controller.process_video_frame)
-        self.video_timer.start(AppConfig.UI_UPDATE_INTERVAL_MS if AppConfig.UI_UPDATE_INTERVAL_MS > 0 else 1)
+        self.video_timer.timeout.connect(self.controller.update_ui)
+        self.video_timer.start(max(1, AppConfig.UI_UPDATE_INTERVAL_MS) if AppConfig.VISION_PIPELINE else 1)
 
         self.controller.start()
 
@@ -212,6 +213,11 @@ class MainWindow(QMainWindow):
         self.size_checkbox.toggled.connect(lambda checked: self.on_classifier_checkbox_toggled("size", checked))
         left_card_layout.addWidget(self.size_checkbox)
 
+        self.composite_checkbox = QCheckBox("Combined")
+        self.composite_checkbox.setStyleSheet(self.ui_config.STYLESHEET_CHECKBOX)
+        self.composite_checkbox.toggled.connect(lambda checked: self.on_classifier_checkbox_toggled("composite", checked))
+        left_card_layout.addWidget(self.composite_checkbox)
+
         left_card_layout.addStretch()
 
         button_layout = QHBoxLayout()
@@ -364,15 +370,15 @@ class MainWindow(QMainWindow):
         p = convert_to_qt_format.scaled(self.webcam_label.width(), self.webcam_label.height(), Qt.AspectRatioMode.KeepAspectRatio)
         self.webcam_label.setPixmap(QPixmap.fromImage(p))
 
-    def update_graph(self, time_values: list, rpm_values: list):
-        """Updates the RPM graph with new data."""
+    def update_graph(self, time_values: np.ndarray, rpm_values: np.ndarray):
+        """Updates the RPM graph with new data, already decimated to GRAPH_MAX_POINTS."""
         window_size = self.ui_config.GRAPH_SMOOTHING_WINDOW
         if len(rpm_values) >= window_size:
             smoothed_rpm_values = np.convolve(rpm_values, np.ones(window_size)/window_size, mode='valid')
             self.line.set_data(time_values[window_size-1:], smoothed_rpm_values)
             self.ax.relim()
             self.ax.autoscale_view()
-            self.canvas.draw()
+            self.canvas.draw_idle()
 
     def update_led(self, state: int):
         """Updates the obstacle sensor LED indicator."""
@@ -451,11 +457,14 @@ class MainWindow(QMainWindow):
             if classifier_key != "color": self.color_checkbox.setChecked(False)
             if classifier_key != "shape": self.shape_checkbox.setChecked(False)
             if classifier_key != "size": self.size_checkbox.setChecked(False)
+            if classifier_key != "composite": self.composite_checkbox.setChecked(False)
             
             if not self.controller.set_active_classifier(classifier_key):
                 if classifier_key == "size": self.size_checkbox.setChecked(False)
+                if classifier_key == "composite": self.composite_checkbox.setChecked(False)
         else:
-            if not self.color_checkbox.isChecked() and not self.shape_checkbox.isChecked() and not self.size_checkbox.isChecked():
+            if not self.color_checkbox.isChecked() and not self.shape_checkbox.isChecked() and \
+                    not self.size_checkbox.isChecked() and not self.composite_checkbox.isChecked():
                 self.controller.set_active_classifier(None)
 
     def closeEvent(self, event):
@@ -0,0 +1,56 @@
+from PyQt6.QtWidgets import QMainWindow, QTabWidget
+
+from src.config.config import AppConfig
+from src.config.ui_config import UIConfig
+from src.core.belt_process import BeltProcess
+from src.core.metrics import MetricsServer
+from src.gui.main_window import MainWindow
+
+
+class MultiBeltWindow(QMainWindow):
+    """One tab per belt, each holding the usual main window of that belt.
+
+    Every belt's controller runs in its own process (see BeltProcess), so
+    the belts do not compete for this process's interpreter and the UI
+    only draws what they hand over. The metrics of all belts are served from
+    one endpoint, labelled by belt.
+
+    Args:
+        belts (list[dict]): AppConfig.BELTS.
+    """
+    def __init__(self, belts: list[dict]):
+        super().__init__()
+        self.ui_config = UIConfig()
+        self.setWindowTitle(self.ui_config.APP_WINDOW_TITLE)
+        self.setGeometry(*self.ui_config.DEFAULT_WINDOW_GEOMETRY)
+        self.setStyleSheet(self.ui_config.STYLESHEET_MAIN_WINDOW)
+
+        self.tabs = QTabWidget()
+        self.setCentralWidget(self.tabs)
+        self.belt_windows = []
+        for overrides in belts:
+            belt = BeltProcess(overrides)
+            window = MainWindow(belt)
+            self.belt_windows.append(window)
+            self.tabs.addTab(window, belt.name)
+
+        self.metrics_server = None
+        if AppConfig.METRICS_PORT is not None:
+            self.metrics_server = MetricsServer(self.collect_metrics, AppConfig.METRICS_PORT, AppConfig.METRICS_HOST)
+            try:
+                self.metrics_server.start()
+            except OSError as e:
+                print(f"Metrics endpoint disabled: {e}")
+                self.metrics_server = None
+
+    def collect_metrics(self) -> list:
+        return [family for window in self.belt_windows for family in window.controller.metrics_families()]
+
+    def closeEvent(self, event):
+        """Stops every belt."""
+        for window in self.belt_windows:
+            window.controller.stop()
+        if self.metrics_server:
+            self.metrics_server.stop()
+            self.metrics_server = None
+        event.accept()
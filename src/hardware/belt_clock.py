@@ -0,0 +1,84 @@
+import threading
+from collections import deque
+
+from src.hardware.device_clock import DeviceClock
+
+
+class BeltClock:
+    """Maps host times onto encoder ticks, i.e. onto belt positions.
+
+    Binary telemetry pairs every sample's device timestamp with the tick count
+    of the RpmSensor ISR. The tick at a host time, such as the moment a frame
+    was exposed, is interpolated between the two samples around it in device
+    time, which keeps USB and OS latency out of the result. A time after the
+    newest sample is extrapolated at the recent belt speed, but by no more
+    than max_extrapolation_seconds.
+
+    Samples are observed on the serial reader thread and ticks are looked up
+    on the UI thread.
+
+    Args:
+        device_clock (DeviceClock): Maps host times onto device timestamps.
+        max_samples (int): How many samples are kept for lookups.
+        max_extrapolation_seconds (float): How far past the newest sample a tick is estimated.
+        rate_window_seconds (float): Span of samples the belt speed is estimated over.
+    """
+    WRAP = 1 << 32
+
+    def __init__(self, device_clock: DeviceClock, max_samples: int = 2048,
+                 max_extrapolation_seconds: float = 0.5, rate_window_seconds: float = 0.2):
+        self.device_clock = device_clock
+        self.max_extrapolation_us = max_extrapolation_seconds * 1e6
+        self.rate_window_us = rate_window_seconds * 1e6
+        # (unwrapped device time in us, unwrapped tick), in device order.
+        self._samples = deque(maxlen=max_samples)
+        self._lock = threading.Lock()
+
+    def observe(self, timestamp_us: int, tick: int):
+        """Records the tick count at a device timestamp.
+
+        Samples must be observed in device order, after the device clock has
+        observed their timestamp.
+        """
+        device_us = self.device_clock.unwrap_recent(timestamp_us)
+        with self._lock:
+            if self._samples:
+                last_us, last_tick = self._samples[-1]
+                if device_us < last_us:
+                    return
+                # The count never goes back, so a smaller raw value means it wrapped.
+                tick = last_tick + ((tick - last_tick) & (self.WRAP - 1))
+            self._samples.append((device_us, tick))
+
+    def tick_at(self, host_time: float) -> int | None:
+        """The 32-bit encoder tick at host_time, or None if it cannot be told."""
+        device_us = self.device_clock.to_device_time(host_time)
+        if device_us is None:
+            return None
+        with self._lock:
+            samples = self._samples
+            if not samples or device_us < samples[0][0]:
+                return None
+            newest_us, newest_tick = samples[-1]
+            if device_us >= newest_us:
+                if device_us - newest_us > self.max_extrapolation_us:
+                    return None
+                tick = newest_tick + self._rate() * (device_us - newest_us)
+            else:
+                # Lookups are for recent frames, so the search starts at the newest sample.
+                i = len(samples) - 1
+                while samples[i - 1][0] > device_us:
+                    i -= 1
+                (before_us, before_tick), (after_us, after_tick) = samples[i - 1], samples[i]
+                tick = before_tick + (after_tick - before_tick) * (device_us - before_us) / (after_us - before_us)
+        return round(tick) & (self.WRAP - 1)
+
+    def _rate(self) -> float:
+        """Ticks per microsecond over the last rate_window_us. Called with the lock held."""
+        newest_us, newest_tick = self._samples[-1]
+        for oldest_us, oldest_tick in reversed(self._samples):
+            if newest_us - oldest_us >= self.rate_window_us:
+                break
+        if oldest_us == newest_us:
+            return 0.0
+        return (newest_tick - oldest_tick) / (newest_us - oldest_us)
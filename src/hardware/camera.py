@@ -1,3 +1,5 @@
+import threading
+import time
 import cv2
 from src.config.config import AppConfig
 
@@ -7,14 +9,39 @@ class Camera:
     This class provides a simple interface for initializing, reading frames from,
     and releasing a webcam.
 
+    In threaded mode a capture thread reads frames as fast as the camera
+    delivers them into a triple buffer: one slot being captured into, one
+    holding the newest complete frame and one lent to the caller. read_frame()
+    then returns the newest frame without waiting for the camera, and a frame
+    is never returned twice, so stale frames from OpenCV's internal buffer are
+    skipped instead of processed. Every frame carries the host time at which it
+    was captured.
+
     Args:
         camera_index (int): The index of the camera to use.
         resolution (tuple): The desired resolution of the camera feed.
+        threaded (bool): Capture on a background thread.
     """
-    def __init__(self, camera_index=AppConfig.WEBCAM_INDEX, resolution=AppConfig.CAMERA_RESOLUTION):
+    def __init__(self, camera_index=AppConfig.WEBCAM_INDEX, resolution=AppConfig.CAMERA_RESOLUTION,
+                 threaded=False):
         self.camera_index = camera_index
         self.resolution = resolution
+        self.threaded = threaded
         self.cap = None
+        # Host time (time.time()) at which the frame last returned by read_frame() was captured.
+        self.last_frame_time = None
+        self.dropped_frames = 0
+        # Triple buffer slots, allocated by cap.read() on first use and reused
+        # afterwards. The indices and _new_frame are guarded by _frame_condition.
+        self._buffers = [None, None, None]
+        self._frame_times = [None, None, None]
+        self._capture_index = 0
+        self._ready_index = 1
+        self._read_index = 2
+        self._new_frame = False
+        self._frame_condition = threading.Condition()
+        self._stop_event = threading.Event()
+        self._capture_thread = None
 
     def initialize(self):
         """Initializes the camera capture.
@@ -27,11 +54,24 @@ class Camera:
             raise IOError(f"Cannot open webcam with index {self.camera_index}")
         self.cap.set(cv2.CAP_PROP_FRAME_WIDTH, self.resolution[0])
         self.cap.set(cv2.CAP_PROP_FRAME_HEIGHT, self.resolution[1])
+        if self.threaded:
+            # Frames are taken as soon as they arrive, so the driver queue only adds latency.
+            self.cap.set(cv2.CAP_PROP_BUFFERSIZE, 1)
+            self._new_frame = False
+            self._stop_event.clear()
+            self._capture_thread = threading.Thread(target=self._capture_loop, name="camera-capture", daemon=True)
+            self._capture_thread.start()
         print(f"Camera initialized with index {self.camera_index} and resolution {self.resolution}")
 
-    def read_frame(self):
+    def read_frame(self, timeout=0.0):
         """Reads a single frame from the camera.
 
+        In threaded mode this returns the newest captured frame that has not
+        been returned before. The frame stays valid until the next call.
+
+        Args:
+            timeout (float): Threaded mode only: how long to wait for a new frame.
+
         Returns:
             np.ndarray: The captured frame, or None if a frame could not be read.
 
@@ -40,14 +80,73 @@ class Camera:
         """
         if self.cap is None or not self.cap.isOpened():
             raise IOError("Camera not initialized or already released.")
+        if self.threaded:
+            return self._take_latest_frame(timeout)
         ret, frame = self.cap.read()
         if not ret:
             print("Warning: Could not read frame from camera.")
             return None
+        self.last_frame_time = self._capture_time()
         return frame
 
+    def read_frame_with_timestamp(self, timeout=0.0):
+        """Like read_frame(), but also returns the frame's capture time.
+
+        Returns:
+            tuple[np.ndarray | None, float | None]: The frame and the host time
+                                                  (time.time()) it was captured.
+        """
+        frame = self.read_frame(timeout)
+        return frame, self.last_frame_time if frame is not None else None
+
+    def _take_latest_frame(self, timeout):
+        with self._frame_condition:
+            if not self._new_frame and timeout > 0:
+                self._frame_condition.wait(timeout)
+            if not self._new_frame:
+                return None
+            self._read_index, self._ready_index = self._ready_index, self._read_index
+            self._new_frame = False
+            self.last_frame_time = self._frame_times[self._read_index]
+            return self._buffers[self._read_index]
+
+    def _capture_loop(self):
+        while not self._stop_event.is_set():
+            # The capture slot is not visible to the reader, so no lock is needed here.
+            ret, frame = self.cap.read(self._buffers[self._capture_index])
+            if not ret:
+                if not self.cap.isOpened():
+                    return
+                time.sleep(0.01)
+                continue
+            self._buffers[self._capture_index] = frame
+            self._frame_times[self._capture_index] = self._capture_time()
+            with self._frame_condition:
+                if self._new_frame:
+                    self.dropped_frames += 1  # The previous frame was never read
+                self._capture_index, self._ready_index = self._ready_index, self._capture_index
+                self._new_frame = True
+                self._frame_condition.notify_all()
+
+    def _capture_time(self):
+        """Returns the host time at which the frame just read was exposed.
+
+        V4L2 reports the driver's buffer timestamp, taken on CLOCK_MONOTONIC,
+        as CAP_PROP_POS_MSEC; it is used when it looks like one. Other backends
+        report a stream position, in which case the time of the read is used.
+        """
+        now = time.time()
+        age = time.monotonic() - float(self.cap.get(cv2.CAP_PROP_POS_MSEC)) / 1000.0
+        if 0.0 <= age < 1.0:
+            return now - age
+        return now
+
     def release(self):
         """Releases the camera capture and cleans up resources."""
+        if self._capture_thread is not None:
+            self._stop_event.set()
+            self._capture_thread.join(timeout=1.0)
+            self._capture_thread = None
         if self.cap is not None:
             self.cap.release()
             print("Camera resources released.")
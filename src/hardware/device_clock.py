@@ -0,0 +1,87 @@
+import threading
+from collections import deque
+
+
+class DeviceClock:
+    """Maps firmware micros() timestamps onto the host clock.
+
+    The firmware timestamp is unwrapped to 64 bits (micros() wraps every ~71
+    minutes) and the host/device offset is estimated as the smallest
+    (host receive time - device time) seen within a sliding window. The
+    smallest value is the sample that suffered the least USB/OS latency; the
+    window lets the estimate follow the drift between the two clocks.
+
+    Timestamps are observed on the serial reader thread and converted on the
+    vision and decision threads.
+
+    Args:
+        window_seconds (float): How long an offset measurement stays relevant.
+    """
+    WRAP_US = 1 << 32
+
+    def __init__(self, window_seconds: float = 10.0):
+        self.window_seconds = window_seconds
+        self._last_raw_us = None
+        self._wrap_offset_us = 0
+        # Monotonic deque of (host_time, offset) with increasing offsets, so the
+        # minimum over the window is always at the left end.
+        self._offsets = deque()
+        self._lock = threading.Lock()
+
+    def unwrap(self, timestamp_us: int) -> int:
+        """Extends a 32-bit device timestamp to a monotonic 64-bit value."""
+        if self._last_raw_us is not None and timestamp_us < self._last_raw_us and \
+                self._last_raw_us - timestamp_us > self.WRAP_US // 2:
+            self._wrap_offset_us += self.WRAP_US
+        self._last_raw_us = timestamp_us
+        return timestamp_us + self._wrap_offset_us
+
+    def observe(self, timestamp_us: int, host_time: float):
+        """Records that a frame stamped timestamp_us was received at host_time.
+
+        Timestamps must be observed in device order.
+        """
+        with self._lock:
+            offset = host_time - self.unwrap(timestamp_us) / 1e6
+            while self._offsets and self._offsets[-1][1] >= offset:
+                self._offsets.pop()
+            self._offsets.append((host_time, offset))
+            while self._offsets[0][0] < host_time - self.window_seconds:
+                self._offsets.popleft()
+
+    @property
+    def synchronized(self) -> bool:
+        """Whether at least one timestamp has been observed."""
+        return bool(self._offsets)
+
+    def to_host_time(self, timestamp_us: int) -> float | None:
+        """Converts a device timestamp to host time, or None if not synchronized.
+
+        The timestamp is unwrapped relative to the last observed one, so it
+        must not be older than half a wrap period (~35 minutes).
+        """
+        with self._lock:
+            if not self._offsets:
+                return None
+            return self._unwrap_recent(timestamp_us) / 1e6 + self._offsets[0][1]
+
+    def unwrap_recent(self, timestamp_us: int) -> int:
+        """Extends a device timestamp close to the last observed one, without recording it."""
+        with self._lock:
+            return self._unwrap_recent(timestamp_us)
+
+    def _unwrap_recent(self, timestamp_us: int) -> int:
+        unwrapped = timestamp_us + self._wrap_offset_us
+        if self._last_raw_us is not None:
+            if timestamp_us - self._last_raw_us > self.WRAP_US // 2:
+                unwrapped -= self.WRAP_US  # Stamped just before the last wrap
+            elif self._last_raw_us - timestamp_us > self.WRAP_US // 2:
+                unwrapped += self.WRAP_US  # Stamped just after a wrap not observed yet
+        return unwrapped
+
+    def to_device_time(self, host_time: float) -> float | None:
+        """Converts a host time to unwrapped device microseconds, or None if not synchronized."""
+        with self._lock:
+            if not self._offsets:
+                return None
+            return (host_time - self._offsets[0][1]) * 1e6
@@ -0,0 +1,276 @@
+import struct
+from collections import namedtuple
+from enum import IntEnum
+
+# Binary frame layout shared with the firmware (see arduino_code/Protocol.h):
+# [SYNC][TYPE][PAYLOAD ...][CRC8]. Every frame type has a fixed payload size,
+# and the CRC-8 (polynomial 0x07, init 0x00) covers TYPE and PAYLOAD.
+FRAME_SYNC_BYTE = 0xA5
+PROTOCOL_VERSION = 7
+
+
+class FrameType(IntEnum):
+    """Frame types of the binary serial protocol."""
+    # Host -> Device
+    HELLO = 0x01
+    COMMAND = 0x02
+    SET_RPM = 0x03
+    SET_GAINS = 0x04
+    SCHEDULE = 0x05
+    QUERY_STATS = 0x06
+    SET_BIN_TABLE = 0x07
+    QUERY_CAPS = 0x08
+    # Device -> Host
+    HELLO_ACK = 0x81
+    TELEMETRY = 0x82
+    TELEMETRY_BATCH = 0x83
+    OBSTACLE_EVENT = 0x84
+    ACTION_EVENT = 0x85
+    STATS = 0x86
+    BIN_TABLE_ACK = 0x87
+    CAPS = 0x88
+
+
+# A single sample is [rpm u16][status u8][timestamp_us u32][tick u32]; a batch
+# carries a count followed by a fixed number of
+# [timestamp_us u32][tick u32][rpm u16][status u8][pwm u8] samples.
+TELEMETRY_FORMAT = struct.Struct('<HBII')
+TELEMETRY_BATCH_SAMPLES = 8
+TELEMETRY_SAMPLE_FORMAT = struct.Struct('<IIHBB')
+
+# Firmware profiling counters, in the field order of ProfileStats (arduino_code/Profiling.h).
+DEVICE_STATS_FORMAT = struct.Struct('<HHHIIHHHHHHHHB')
+# Status bits of binary telemetry; ASCII telemetry only carries the obstacle state.
+TELEMETRY_STATUS_OBSTACLE = 0x01
+TELEMETRY_STATUS_SERVO_READY = 0x02  # The diverter reached its target and settled
+
+# QUERY_STATS flag: restart the min/max measurements after reporting them.
+STATS_FLAG_RESET = 0x01
+
+# Answer to HELLO: [version][accepted_baud_code][device_id u32]. device_id
+# identifies the board (a hash of the chip's serial number, arduino_code/DeviceId.h).
+HELLO_ACK_FORMAT = struct.Struct('<BBI')
+
+# Answer to QUERY_CAPS: [version][flags][baud_code][pending_actions][tick u32][device_id u32].
+# The firmware answers it in any mode, so a host that reopens the port learns
+# at once whether the board kept running and can resume a binary session.
+CAPS_FORMAT = struct.Struct('<BBBBII')
+CAPS_FLAG_BINARY = 0x01      # The binary protocol is active, at the rate of baud_code
+CAPS_FLAG_STAY_ALIVE = 0x02  # The firmware rides out host outages
+CAPS_FLAG_LINK_LOST = 0x04   # The heartbeat timed out since the last HELLO or QUERY_CAPS
+
+# Class-to-bin table: [bin_count][angle x BIN_TABLE_MAX_BINS][bin x BIN_TABLE_CLASSES].
+# The servo code of COMMAND and SCHEDULE frames is the class code that indexes it.
+BIN_TABLE_MAX_BINS = 8
+BIN_TABLE_CLASSES = 16
+BIN_HOME = 0xFF  # Classes in this bin send the servo home
+BIN_TABLE_PAYLOAD_SIZE = 1 + BIN_TABLE_MAX_BINS + BIN_TABLE_CLASSES
+
+PAYLOAD_SIZES = {
+    FrameType.HELLO: 2,
+    FrameType.COMMAND: 2,
+    FrameType.SET_RPM: 2,
+    FrameType.SET_GAINS: 6,
+    FrameType.SCHEDULE: 7,
+    FrameType.QUERY_STATS: 1,
+    FrameType.SET_BIN_TABLE: BIN_TABLE_PAYLOAD_SIZE,
+    FrameType.QUERY_CAPS: 1,
+    FrameType.HELLO_ACK: HELLO_ACK_FORMAT.size,
+    FrameType.TELEMETRY: TELEMETRY_FORMAT.size,
+    FrameType.TELEMETRY_BATCH: 1 + TELEMETRY_BATCH_SAMPLES * TELEMETRY_SAMPLE_FORMAT.size,
+    FrameType.OBSTACLE_EVENT: 9,
+    FrameType.ACTION_EVENT: 8,
+    FrameType.STATS: DEVICE_STATS_FORMAT.size,
+    FrameType.BIN_TABLE_ACK: 2,
+    FrameType.CAPS: CAPS_FORMAT.size,
+}
+
+# Baud rates the firmware can switch to after the handshake. Code 0 keeps the current rate.
+BAUD_CODE_KEEP = 0
+BAUD_CODES = {
+    115200: 1,
+    250000: 2,
+    500000: 3,
+    1000000: 4,
+}
+
+# PID gains are sent as Q8.8 fixed point.
+GAIN_SCALE = 256
+
+# Servo code that leaves the servo where it is, so COMMAND frames can carry the
+# motor speed and heartbeat without overriding a scheduled move.
+SERVO_CODE_KEEP = 0xFF
+
+
+class ActionStatus(IntEnum):
+    """Outcome of a scheduled servo move, reported in ACTION_EVENT frames."""
+    ON_TIME = 0
+    LATE = 1      # The part had already reached the gate when the move was scheduled.
+    DROPPED = 2   # The firmware queue was full.
+
+# timestamp_us, pwm, servo_ready and tick (the encoder tick count) are None for
+# samples that came over the ASCII protocol.
+TelemetrySample = namedtuple('TelemetrySample', ['timestamp_us', 'rpm', 'obstacle_state', 'pwm', 'servo_ready', 'tick'],
+                             defaults=[None])
+
+# An obstacle sensor edge timestamped by the firmware ISR, with the encoder
+# tick count at that moment. host_time is filled in by the SerialManager once
+# the device clock is synchronized.
+ObstacleEvent = namedtuple('ObstacleEvent', ['timestamp_us', 'tick', 'state', 'host_time'])
+
+# A scheduled servo move that the firmware executed (or dropped) at the given tick.
+ActionEvent = namedtuple('ActionEvent', ['part_id', 'servo_code', 'status', 'tick'])
+
+# Loop timing and health counters reported by the firmware. Times are in
+# microseconds and saturate at 0xFFFF; counters wrap.
+DeviceStats = namedtuple('DeviceStats', [
+    'loop_min_us', 'loop_max_us', 'loop_mean_us', 'loop_count',
+    'encoder_pulses', 'obstacle_edges', 'timer_ticks',
+    'rx_overflows', 'line_overflows', 'parse_errors', 'crc_errors',
+    'max_parse_us', 'free_sram', 'dropped_events'])
+
+# The firmware's link state, from a CAPS frame. baud_code is the code of the
+# rate the link runs at (BAUD_CODE_KEEP for the default rate) and tick the
+# encoder tick count when the frame was sent.
+DeviceCapabilities = namedtuple('DeviceCapabilities', [
+    'version', 'binary', 'stay_alive', 'link_lost', 'baud_code', 'pending_actions', 'tick', 'device_id'])
+
+
+def crc8(data: bytes, crc: int = 0) -> int:
+    """Computes the CRC-8 (polynomial 0x07) used by the frame protocol."""
+    for byte in data:
+        crc ^= byte
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x07) & 0xFF if crc & 0x80 else (crc << 1) & 0xFF
+    return crc
+
+
+def encode_frame(frame_type: FrameType, payload: bytes) -> bytes:
+    """Builds a complete frame for the given type and payload.
+
+    Raises:
+        ValueError: If the payload size does not match the frame type.
+    """
+    if len(payload) != PAYLOAD_SIZES[frame_type]:
+        raise ValueError(f"Frame {frame_type.name} expects {PAYLOAD_SIZES[frame_type]} payload bytes, got {len(payload)}")
+    body = bytes([frame_type]) + payload
+    return bytes([FRAME_SYNC_BYTE]) + body + bytes([crc8(body)])
+
+
+def decode_telemetry(payload: bytes) -> TelemetrySample:
+    """Decodes a single TELEMETRY frame payload."""
+    rpm, status, timestamp_us, tick = TELEMETRY_FORMAT.unpack(payload)
+    return TelemetrySample(timestamp_us, rpm, status & TELEMETRY_STATUS_OBSTACLE, None,
+                           bool(status & TELEMETRY_STATUS_SERVO_READY), tick)
+
+
+def decode_telemetry_batch(payload: bytes) -> list[TelemetrySample]:
+    """Decodes every valid sample of a TELEMETRY_BATCH frame payload."""
+    count = min(payload[0], TELEMETRY_BATCH_SAMPLES)
+    samples = TELEMETRY_SAMPLE_FORMAT.iter_unpack(payload[1:])
+    return [TelemetrySample(timestamp_us, rpm, status & TELEMETRY_STATUS_OBSTACLE, pwm,
+                            bool(status & TELEMETRY_STATUS_SERVO_READY), tick)
+            for _, (timestamp_us, tick, rpm, status, pwm) in zip(range(count), samples)]
+
+
+def decode_obstacle_event(payload: bytes) -> ObstacleEvent:
+    """Decodes an OBSTACLE_EVENT frame payload."""
+    timestamp_us, tick, state = struct.unpack('<IIB', payload)
+    return ObstacleEvent(timestamp_us, tick, state, None)
+
+
+def encode_schedule(part_id: int, servo_code: int, detection_tick: int) -> bytes:
+    """Builds a SCHEDULE frame for a part detected at the given encoder tick."""
+    payload = struct.pack('<HBI', part_id & 0xFFFF, servo_code, detection_tick & 0xFFFFFFFF)
+    return encode_frame(FrameType.SCHEDULE, payload)
+
+
+def decode_device_stats(payload: bytes) -> DeviceStats:
+    """Decodes a STATS frame payload."""
+    return DeviceStats(*DEVICE_STATS_FORMAT.unpack(payload))
+
+
+def decode_capabilities(payload: bytes) -> DeviceCapabilities:
+    """Decodes a CAPS frame payload."""
+    version, flags, baud_code, pending_actions, tick, device_id = CAPS_FORMAT.unpack(payload)
+    return DeviceCapabilities(version, bool(flags & CAPS_FLAG_BINARY), bool(flags & CAPS_FLAG_STAY_ALIVE),
+                              bool(flags & CAPS_FLAG_LINK_LOST), baud_code, pending_actions, tick, device_id)
+
+
+def encode_bin_table(bin_angles: list[int], class_bins: dict[int, int]) -> bytes:
+    """Builds a SET_BIN_TABLE payload.
+
+    Args:
+        bin_angles (list[int]): Servo angle in degrees of each bin.
+        class_bins (dict[int, int]): Bin index of each class code. Classes
+                                     that are not listed go home.
+
+    Raises:
+        ValueError: If the table does not fit the protocol limits.
+    """
+    if len(bin_angles) > BIN_TABLE_MAX_BINS:
+        raise ValueError(f"At most {BIN_TABLE_MAX_BINS} bins are supported, got {len(bin_angles)}")
+    if any(not 0 <= angle <= 180 for angle in bin_angles):
+        raise ValueError(f"Bin angles must be between 0 and 180 degrees: {bin_angles}")
+    bins = [BIN_HOME] * BIN_TABLE_CLASSES
+    for class_code, bin_index in class_bins.items():
+        if not 0 <= class_code < BIN_TABLE_CLASSES:
+            raise ValueError(f"Class code {class_code} is outside 0-{BIN_TABLE_CLASSES - 1}")
+        if bin_index != BIN_HOME and not 0 <= bin_index < len(bin_angles):
+            raise ValueError(f"Class code {class_code} maps to unknown bin {bin_index}")
+        bins[class_code] = bin_index
+    angles = list(bin_angles) + [0] * (BIN_TABLE_MAX_BINS - len(bin_angles))
+    return bytes([len(bin_angles)] + angles + bins)
+
+
+def decode_action_event(payload: bytes) -> ActionEvent:
+    """Decodes an ACTION_EVENT frame payload."""
+    part_id, servo_code, status, tick = struct.unpack('<HBBI', payload)
+    return ActionEvent(part_id, servo_code, ActionStatus(status), tick)
+
+
+class FrameParser:
+    """Incremental parser that extracts frames from a serial byte stream.
+
+    Bytes outside a frame are discarded, so the parser resynchronizes on the
+    next sync byte after line noise or a CRC error.
+    """
+    def __init__(self):
+        self._buffer = bytearray()
+        self.crc_errors = 0
+
+    def feed(self, data: bytes) -> list[tuple[FrameType, bytes]]:
+        """Appends received bytes and returns every complete, valid frame.
+
+        Returns:
+            list[tuple[FrameType, bytes]]: The (type, payload) of each frame.
+        """
+        self._buffer.extend(data)
+        frames = []
+        while True:
+            start = self._buffer.find(FRAME_SYNC_BYTE)
+            if start < 0:
+                self._buffer.clear()
+                return frames
+            if start > 0:
+                del self._buffer[:start]
+            if len(self._buffer) < 2:
+                return frames
+
+            try:
+                frame_type = FrameType(self._buffer[1])
+            except ValueError:
+                del self._buffer[:1]  # Unknown type, look for the next sync byte.
+                continue
+
+            frame_length = PAYLOAD_SIZES[frame_type] + 3
+            if len(self._buffer) < frame_length:
+                return frames
+
+            body = bytes(self._buffer[1:frame_length - 1])
+            if crc8(body) == self._buffer[frame_length - 1]:
+                frames.append((frame_type, body[1:]))
+                del self._buffer[:frame_length]
+            else:
+                self.crc_errors += 1
+                del self._buffer[:1]
@@ -0,0 +1,126 @@
+import threading
+import time
+from collections import deque
+
+
+class SerialIOEngine:
+    """Runs the blocking serial reads and writes on two background threads.
+
+    The reader thread blocks on the port and hands every chunk, together with
+    its receive time, to on_receive. The writer thread sends queued messages
+    in order. A message queued with a key replaces the last queued message if
+    that one has the same key and has not been sent yet, so a burst of
+    commands (e.g. while the PWM slider is dragged) goes out as the latest
+    one only. Only the tail is merged, so coalescing never reorders messages.
+
+    Serial errors end both threads and are reported once through on_error.
+
+    Args:
+        ser: An open port with read(), write() and in_waiting, e.g. serial.Serial.
+        on_receive (callable): Called from the reader thread with (data, receive_time).
+        on_error (callable, optional): Called with the exception when the port fails.
+    """
+    def __init__(self, ser, on_receive, on_error=None):
+        self.ser = ser
+        self.on_receive = on_receive
+        self.on_error = on_error
+        self.coalesced_writes = 0
+        # Each only written by its own thread.
+        self.received_bytes = 0
+        self.sent_bytes = 0
+        # [key, data] pairs, oldest first. Guarded by _condition.
+        self._write_queue = deque()
+        self._condition = threading.Condition()
+        self._stop_event = threading.Event()
+        self._failed = False
+        self._reader_thread = None
+        self._writer_thread = None
+
+    @property
+    def running(self) -> bool:
+        return self._reader_thread is not None and not self._stop_event.is_set()
+
+    def start(self):
+        self._stop_event.clear()
+        self._reader_thread = threading.Thread(target=self._read_loop, name="serial-reader", daemon=True)
+        self._writer_thread = threading.Thread(target=self._write_loop, name="serial-writer", daemon=True)
+        self._reader_thread.start()
+        self._writer_thread.start()
+
+    def stop(self, timeout: float = 1.0):
+        """Stops both threads. Messages that were not sent yet are discarded.
+
+        The reader only notices the stop after its current read returns, i.e.
+        within the port's read timeout.
+        """
+        self._stop_event.set()
+        with self._condition:
+            self._write_queue.clear()
+            self._condition.notify_all()
+        for thread in (self._reader_thread, self._writer_thread):
+            if thread is not None and thread is not threading.current_thread():
+                thread.join(timeout)
+
+    def write(self, data: bytes, key=None) -> bool:
+        """Queues data for the writer thread.
+
+        Args:
+            data (bytes): The encoded message.
+            key (hashable, optional): Coalescing key; None always appends.
+
+        Returns:
+            bool: False if the engine is not running.
+        """
+        if not self.running:
+            return False
+        with self._condition:
+            if key is not None and self._write_queue and self._write_queue[-1][0] == key:
+                self._write_queue[-1][1] = data
+                self.coalesced_writes += 1
+            else:
+                self._write_queue.append([key, data])
+            self._condition.notify()
+        return True
+
+    def pending_writes(self) -> int:
+        with self._condition:
+            return len(self._write_queue)
+
+    def _read_loop(self):
+        while not self._stop_event.is_set():
+            try:
+                chunk = self.ser.read(self.ser.in_waiting or 1)
+            except Exception as e:  # pyserial raises SerialException, but also TypeError/AttributeError once closed
+                self._fail(e)
+                return
+            if chunk:
+                self.received_bytes += len(chunk)
+                self.on_receive(chunk, time.time())
+
+    def _write_loop(self):
+        while True:
+            with self._condition:
+                while not self._write_queue and not self._stop_event.is_set():
+                    self._condition.wait()
+                if self._stop_event.is_set():
+                    return
+                _, data = self._write_queue.popleft()
+            try:
+                self.ser.write(data)
+            except Exception as e:
+                self._fail(e)
+                return
+            self.sent_bytes += len(data)
+
+    def _fail(self, error: Exception):
+        with self._condition:
+            if self._failed or self._stop_event.is_set():
+                # An error caused by stop() closing the port is expected.
+                self._stop_event.set()
+                return
+            self._failed = True
+            self._stop_event.set()
+            self._write_queue.clear()
+            self._condition.notify_all()
+        if self.on_error:
+            self.on_error(error)
@@ -1,14 +1,51 @@
 import serial
 import serial.tools.list_ports
+import struct
+import threading
 import time
+from collections import deque
 from src.config.config import AppConfig
+from src.hardware.belt_clock import BeltClock
+from src.hardware.device_clock import DeviceClock
+from src.hardware.serial_io import SerialIOEngine
+from src.hardware.protocol import (BAUD_CODE_KEEP, BAUD_CODES, GAIN_SCALE, HELLO_ACK_FORMAT, PROTOCOL_VERSION,
+                                   SERVO_CODE_KEEP, STATS_FLAG_RESET, ActionEvent, DeviceCapabilities, DeviceStats, FrameParser,
+                                   FrameType, ObstacleEvent, TelemetrySample, crc8, decode_action_event,
+                                   decode_capabilities, decode_device_stats, decode_obstacle_event, decode_telemetry,
+                                   decode_telemetry_batch, encode_bin_table, encode_frame, encode_schedule)
 from src.vision.classifiers import ServoCode
 
 class SerialManager:
     """Manages the serial communication with the Arduino.
 
     This class handles finding the correct serial port, connecting to the device,
-    reading data, and sending commands.
+    reading data, and sending commands. At connect time it offers the binary
+    frame protocol and falls back to the legacy ASCII protocol if the firmware
+    does not answer the handshake. The handshake can also switch the link to
+    a higher baud rate, in which case telemetry arrives in batched frames.
+    Obstacle sensor edges timestamped by the firmware are collected separately
+    and mapped onto the host clock. With the binary protocol, servo moves can
+    be scheduled against the belt encoder so the firmware fires them when the
+    part reaches the gate. The firmware's loop timing and error counters can
+    be queried with request_device_stats(); the latest report is kept in
+    device_stats. The class-to-bin table of the diverter is uploaded at
+    connect time and stored in the firmware's EEPROM.
+
+    With SERIAL_SUPPRESS_DTR_RESET the port is opened without pulsing DTR and
+    the firmware is asked for its link state (QUERY_CAPS) before anything
+    else. A board that kept running through an outage answers within
+    milliseconds; if its binary session is still up, connect() resumes it as
+    it was (see resumed) instead of waiting for a reboot and a new handshake.
+
+    Several belts can each run a SerialManager on the same host. Ports are
+    opened exclusively, and with SERIAL_DEVICE_ID set only the board whose
+    firmware reports that ID (device_id, from CAPS or HELLO_ACK) is kept,
+    whatever port it enumerates on; the others are closed and skipped.
+
+    After the handshake all port I/O runs on the threads of a SerialIOEngine:
+    incoming data is decoded on the reader thread into bounded queues, and
+    commands are queued for the writer thread, which merges repeated PWM
+    commands, so neither the GUI nor the read loop ever blocks on the port.
 
     Args:
         config (AppConfig): The application configuration object.
@@ -19,25 +56,75 @@ class SerialManager:
         self.ser = None
         self.connected = False
         self.on_disconnect = on_disconnect
+        self.binary_protocol = False
+        self.high_speed = False
+        self._frame_parser = FrameParser()
+        self._io_engine: SerialIOEngine | None = None
+        # Filled by the reader thread, drained by the read_* methods. A deque
+        # with one producer and one consumer needs no lock; once full, the
+        # oldest entries are dropped.
+        self._pending_samples = deque(maxlen=config.SERIAL_RX_QUEUE_SIZE)
+        self._pending_events = deque(maxlen=config.SERIAL_RX_QUEUE_SIZE)
+        self._pending_actions = deque(maxlen=config.SERIAL_RX_QUEUE_SIZE)
+        self._data_available = threading.Event()
+        self._line_buffer = bytearray()
+        self.ascii_parse_errors = 0
+        # Link health over the manager's lifetime, for the metrics endpoint.
+        self.connect_count = 0
+        self.resume_count = 0
+        self.link_errors = 0
+        # Of the parsers and I/O engines of earlier connections.
+        self._retired_crc_errors = 0
+        self._retired_received_bytes = 0
+        self._retired_sent_bytes = 0
+        self._last_servo_code = ServoCode.UNKNOWN
+        self.device_clock = DeviceClock()
+        self.belt_clock = BeltClock(self.device_clock)
+        self.device_stats: DeviceStats | None = None
+        self.device_capabilities: DeviceCapabilities | None = None
+        # The firmware's ID of the connected board; None over the ASCII protocol.
+        self.device_id: int | None = None
+        # Whether the last connect() picked up the firmware's running session.
+        self.resumed = False
+        self._last_port = None
+        # Rate of the last session; the firmware keeps it through a short outage.
+        self._session_baudrate = config.BAUDRATE
+        # CRC of the bin table the device confirmed, and of the one sent but not acknowledged yet.
+        self._bin_table_crc = None
+        self._pending_bin_table_crc = None
+        # Whether the diverter arm has settled at its last target, from the
+        # latest binary telemetry; None until known.
+        self.servo_ready: bool | None = None
 
-    def _find_serial_device_port(self) -> str | None:
-        """Finds a suitable serial port based on configured identifiers.
+    def _candidate_ports(self) -> list[str]:
+        """Lists the serial ports that may hold the device, most likely first.
 
         Returns:
-            str | None: The device port string if found, otherwise None.
+            list[str]: SERIAL_PORT if set, otherwise the ports matching
+            SERIAL_DEVICE_IDENTIFIERS (and SERIAL_USB_SERIAL_NUMBER, if set).
         """
-        ports = list(serial.tools.list_ports.comports())
-        for port in ports:
+        if self.config.SERIAL_PORT:
+            return [self.config.SERIAL_PORT]
+        candidates = []
+        for port in serial.tools.list_ports.comports():
+            if self.config.SERIAL_USB_SERIAL_NUMBER and port.serial_number != self.config.SERIAL_USB_SERIAL_NUMBER:
+                continue
             for identifier in self.config.SERIAL_DEVICE_IDENTIFIERS:
                 if identifier in port.description or identifier in port.hwid or identifier in port.device:
-                    return str(port.device)
-        return None
+                    candidates.append(str(port.device))
+                    break
+        # A board that comes back after a USB drop usually gets its old name again.
+        if self._last_port in candidates:
+            candidates.remove(self._last_port)
+            candidates.insert(0, self._last_port)
+        return candidates
 
     def connect(self) -> bool:
         """Attempts to connect to the serial device once.
 
         This method searches for the serial device and establishes a connection.
-        It is non-blocking and will return success or failure after one attempt.
+        It is non-blocking and will return success or failure after one attempt
+        at each candidate port.
 
         Returns:
             bool: True if the connection is successful, False otherwise.
@@ -45,80 +132,477 @@ class SerialManager:
         if self.connected and self.ser and self.ser.is_open:
             return True
 
-        port = self._find_serial_device_port()
-        if port is None:
-            return False
+        for port in self._candidate_ports():
+            if self._connect_port(port):
+                return True
+        return False
 
+    def _connect_port(self, port: str) -> bool:
+        """Connects to the device on port, if it is the configured one."""
+        self._close_port()
         try:
-            self.ser = serial.Serial(
-                port,
-                self.config.BAUDRATE,
-                timeout=self.config.SERIAL_TIMEOUT_SECONDS
-            )
-            # The short sleep is critical for some Arduino boards to initialize
-            # after a serial connection is made.
-            time.sleep(self.config.SERIAL_CONNECT_DELAY_SECONDS)
+            self.ser = self._open_port(port)
+            capabilities = None
+            if self.config.SERIAL_SUPPRESS_DTR_RESET and self.config.SERIAL_PREFER_BINARY_PROTOCOL:
+                capabilities = self._query_capabilities()
+            self.device_capabilities = capabilities
+            self.device_id = capabilities.device_id if capabilities is not None else None
+            # A running board identifies itself before anything about its state changes.
+            if capabilities is not None and not self._is_configured_device():
+                return False
+            self.resumed = capabilities is not None and capabilities.binary and \
+                capabilities.version == PROTOCOL_VERSION
+            if self.resumed:
+                # Device and belt clocks carry on, since the firmware's micros() and ticks did.
+                self._replace_frame_parser()
+                self.binary_protocol = True
+                self.high_speed = capabilities.baud_code != BAUD_CODE_KEEP
+            else:
+                if capabilities is None:
+                    # The short sleep is critical for some Arduino boards to
+                    # initialize after a serial connection is made.
+                    time.sleep(self.config.SERIAL_CONNECT_DELAY_SECONDS)
+                self.binary_protocol = self.config.SERIAL_PREFER_BINARY_PROTOCOL and self._negotiate_binary_protocol()
+                if not self._is_configured_device():
+                    return False
+            self._session_baudrate = self.ser.baudrate
+            self._last_port = port
+            self._line_buffer.clear()
+            self._io_engine = SerialIOEngine(self.ser, self._on_serial_data, self._on_serial_error)
+            self._io_engine.start()
             self.connected = True
-            print(f"Successfully connected to serial device on port {port}")
+            self.connect_count += 1
+            self.resume_count += self.resumed
+            # A resumed firmware still has the table this process stored, if it stored one.
+            if self.config.DIVERTER_BIN_ANGLES is not None and (not self.resumed or self._bin_table_crc is None):
+                self.upload_bin_table(self.config.DIVERTER_BIN_ANGLES, self.config.DIVERTER_CLASS_BINS)
+            protocol_name = "binary" if self.binary_protocol else "ASCII"
+            device = f", device ID {self.device_id:#010x}" if self.device_id is not None else ""
+            if self.resumed:
+                lost = ", the heartbeat had timed out" if capabilities.link_lost else ""
+                print(f"Resumed the session on serial port {port} ({capabilities.pending_actions} servo moves "
+                      f"pending{lost}{device})")
+            else:
+                print(f"Successfully connected to serial device on port {port} ({protocol_name} protocol{device})")
             return True
         except serial.SerialException as e:
-            print(f"Error connecting to serial device: {e}")
-            self.ser = None
+            print(f"Error connecting to serial device on port {port}: {e}")
+            self._close_port()
             self.connected = False
             return False
 
+    def _is_configured_device(self) -> bool:
+        """Checks device_id against SERIAL_DEVICE_ID, closing the port if it is another board."""
+        expected = self.config.SERIAL_DEVICE_ID
+        if expected is None or self.device_id == expected:
+            return True
+        found = "no ID" if self.device_id is None else f"ID {self.device_id:#010x}"
+        print(f"Skipping serial port {self.ser.port}: the board reports {found}, not {expected:#010x}")
+        self._close_port()
+        return False
+
+    def _open_port(self, port: str) -> serial.Serial:
+        """Opens the port at the default rate, without resetting the board if so configured."""
+        if not self.config.SERIAL_SUPPRESS_DTR_RESET:
+            return serial.Serial(port, self.config.BAUDRATE, timeout=self.config.SERIAL_TIMEOUT_SECONDS,
+                                 exclusive=True)
+        # DTR, and RTS which some adapters wire to reset instead, must be low
+        # before the port opens; setting them afterwards would fire the reset.
+        ser = serial.Serial()
+        ser.port = port
+        ser.baudrate = self.config.BAUDRATE
+        ser.timeout = self.config.SERIAL_TIMEOUT_SECONDS
+        ser.dtr = False
+        ser.rts = False
+        ser.exclusive = True  # Another belt's process may be probing the same ports
+        ser.open()
+        return ser
+
+    def _query_capabilities(self) -> DeviceCapabilities | None:
+        """Asks a board that may have kept running for its link state.
+
+        The rate of the previous session is tried first, since the firmware
+        keeps a high-speed link through a short outage, then the default rate
+        (and, when binding by SERIAL_DEVICE_ID, the high-speed rate).
+        Each try waits SERIAL_RESUME_TIMEOUT_SECONDS, much less than the board
+        would take to boot.
+
+        Returns:
+            DeviceCapabilities | None: The answer, or None if the board is
+            rebooting or its firmware predates QUERY_CAPS. The port is left at
+            the rate that answered, or at the default rate.
+        """
+        rates = list(dict.fromkeys([self._session_baudrate, self.config.BAUDRATE]))
+        if self.config.SERIAL_DEVICE_ID is not None and self.config.SERIAL_HIGH_SPEED_BAUDRATE:
+            # A board another belt's process said HELLO to, and let go as not its own.
+            rates.append(self.config.SERIAL_HIGH_SPEED_BAUDRATE)
+        rates = list(dict.fromkeys(rates))
+        self.ser.timeout = self.config.SERIAL_RESUME_TIMEOUT_SECONDS
+        try:
+            for rate in rates:
+                self.ser.baudrate = rate
+                self.ser.reset_input_buffer()
+                self.ser.write(encode_frame(FrameType.QUERY_CAPS, bytes([PROTOCOL_VERSION])))
+                parser = FrameParser()
+                deadline = time.monotonic() + self.config.SERIAL_RESUME_TIMEOUT_SECONDS
+                while time.monotonic() < deadline:
+                    for frame_type, payload in parser.feed(self.ser.read(self.ser.in_waiting or 1)):
+                        if frame_type == FrameType.CAPS:
+                            return decode_capabilities(payload)
+            self.ser.baudrate = self.config.BAUDRATE
+            return None
+        finally:
+            self.ser.timeout = self.config.SERIAL_TIMEOUT_SECONDS
+
+    def _negotiate_binary_protocol(self) -> bool:
+        """Offers the binary frame protocol to the firmware.
+
+        Sends a HELLO frame and waits for the HELLO_ACK. Older firmware ignores
+        the frame, in which case the ASCII protocol is kept. If the firmware
+        accepts the requested high-speed baud rate, the port is switched over.
+
+        Returns:
+            bool: True if the firmware acknowledged the binary protocol.
+        """
+        self._replace_frame_parser()
+        self._pending_samples.clear()
+        self._pending_events.clear()
+        self._pending_actions.clear()
+        self._last_servo_code = ServoCode.UNKNOWN
+        self.device_clock = DeviceClock()
+        self.belt_clock = BeltClock(self.device_clock)
+        self.device_stats = None
+        self.servo_ready = None
+        self.high_speed = False
+        baud_code = BAUD_CODES.get(self.config.SERIAL_HIGH_SPEED_BAUDRATE, BAUD_CODE_KEEP)
+        try:
+            self.ser.reset_input_buffer()
+            self.ser.write(encode_frame(FrameType.HELLO, bytes([PROTOCOL_VERSION, baud_code])))
+            deadline = time.monotonic() + self.config.SERIAL_HANDSHAKE_TIMEOUT_SECONDS
+            while time.monotonic() < deadline:
+                chunk = self.ser.read(self.ser.in_waiting or 1)
+                receive_time = time.time()
+                for frame_type, payload in self._frame_parser.feed(chunk):
+                    if frame_type == FrameType.HELLO_ACK:
+                        self.device_id = HELLO_ACK_FORMAT.unpack(payload)[2]
+                        if baud_code != BAUD_CODE_KEEP and payload[1] == baud_code:
+                            self.ser.baudrate = self.config.SERIAL_HIGH_SPEED_BAUDRATE
+                            self.high_speed = True
+                        return True
+                    self._handle_frame(frame_type, payload, receive_time)
+        except serial.SerialException as e:
+            print(f"Error during protocol handshake: {e}")
+        return False
+
+    def _handle_frame(self, frame_type: FrameType, payload: bytes, receive_time: float):
+        """Decodes a device frame and queues any samples or events it carries."""
+        if frame_type == FrameType.TELEMETRY:
+            sample = decode_telemetry(payload)
+            self.device_clock.observe(sample.timestamp_us, receive_time)
+            self.belt_clock.observe(sample.timestamp_us, sample.tick)
+            self.servo_ready = sample.servo_ready
+            self._pending_samples.append(sample)
+        elif frame_type == FrameType.TELEMETRY_BATCH:
+            samples = decode_telemetry_batch(payload)
+            for sample in samples:
+                self.device_clock.observe(sample.timestamp_us, receive_time)
+                self.belt_clock.observe(sample.timestamp_us, sample.tick)
+            if samples:
+                self.servo_ready = samples[-1].servo_ready
+            self._pending_samples.extend(samples)
+        elif frame_type == FrameType.OBSTACLE_EVENT:
+            event = decode_obstacle_event(payload)
+            # Events are sent the moment they happen, so they are also a good clock reference.
+            self.device_clock.observe(event.timestamp_us, receive_time)
+            self._pending_events.append(event._replace(host_time=self.device_clock.to_host_time(event.timestamp_us)))
+        elif frame_type == FrameType.ACTION_EVENT:
+            self._pending_actions.append(decode_action_event(payload))
+        elif frame_type == FrameType.BIN_TABLE_ACK:
+            status, table_crc = payload
+            pending_crc, self._pending_bin_table_crc = self._pending_bin_table_crc, None
+            if status == 0 and pending_crc is not None and table_crc == pending_crc:
+                self._bin_table_crc = pending_crc
+            else:
+                # Not known to hold the configured table, so it is uploaded again on the next connect.
+                self._bin_table_crc = None
+                print("Device rejected the bin table." if status != 0 else
+                      "Device bin table does not match the uploaded one.")
+        elif frame_type == FrameType.STATS:
+            self.device_stats = decode_device_stats(payload)
+            self._log_device_stats(self.device_stats)
+
+    @staticmethod
+    def _log_device_stats(stats: DeviceStats):
+        print(f"Device stats: loop {stats.loop_min_us}/{stats.loop_mean_us}/{stats.loop_max_us} us "
+              f"(min/mean/max) over {stats.loop_count} passes, max parse {stats.max_parse_us} us, "
+              f"free SRAM {stats.free_sram} B, RX overflows {stats.rx_overflows}, "
+              f"line overflows {stats.line_overflows}, parse errors {stats.parse_errors}, "
+              f"CRC errors {stats.crc_errors}, dropped events {stats.dropped_events}")
+
+    def _on_serial_data(self, chunk: bytes, receive_time: float):
+        """Decodes received data. Runs on the reader thread."""
+        if self.binary_protocol:
+            for frame_type, payload in self._frame_parser.feed(chunk):
+                self._handle_frame(frame_type, payload, receive_time)
+        else:
+            self._line_buffer.extend(chunk)
+            *lines, rest = self._line_buffer.split(b'\n')
+            self._line_buffer = bytearray(rest)
+            for line in lines:
+                self._handle_line(line.decode('utf-8', errors='ignore').strip())
+        self._data_available.set()
+
+    def _handle_line(self, line: str):
+        """Parses an ASCII telemetry line "RPM_OBSTACLE_STATE"."""
+        if not line:
+            return
+        data_list = line.split('_')
+        try:
+            if len(data_list) != 2:
+                raise ValueError(f"unexpected field count in {line!r}")
+            sample = TelemetrySample(None, int(data_list[0]), int(data_list[1]), None, None)
+        except ValueError as e:
+            # Usually the tail of a line that was cut off when the port was opened.
+            self.ascii_parse_errors += 1
+            print(f"Error reading serial data: {e}")
+            return
+        self._pending_samples.append(sample)
+
+    def _on_serial_error(self, error: Exception):
+        """Called once by the I/O engine when the port fails."""
+        print(f"Serial I/O error: {error}")
+        self.link_errors += 1
+        self.connected = False
+        self._data_available.set()
+        if self.on_disconnect:
+            self.on_disconnect()
+
+    @property
+    def crc_errors(self) -> int:
+        """Frames received with a bad CRC, over all connections."""
+        return self._retired_crc_errors + self._frame_parser.crc_errors
+
+    @property
+    def received_bytes(self) -> int:
+        """Bytes read by the I/O engines, over all connections."""
+        return self._retired_received_bytes + (self._io_engine.received_bytes if self._io_engine else 0)
+
+    @property
+    def sent_bytes(self) -> int:
+        """Bytes written by the I/O engines, over all connections."""
+        return self._retired_sent_bytes + (self._io_engine.sent_bytes if self._io_engine else 0)
+
+    def _replace_frame_parser(self):
+        self._retired_crc_errors += self._frame_parser.crc_errors
+        self._frame_parser = FrameParser()
+
+    def _stop_io_engine(self, timeout: float = 1.0):
+        engine, self._io_engine = self._io_engine, None
+        engine.stop(timeout=timeout)
+        self._retired_received_bytes += engine.received_bytes
+        self._retired_sent_bytes += engine.sent_bytes
+
+    def _close_port(self):
+        if self._io_engine:
+            self._stop_io_engine()
+        if self.ser:
+            if self.ser.is_open:
+                self.ser.close()
+            self.ser = None
+
     def disconnect(self):
-        """Disconnects from the serial port."""
-        if self.ser and self.ser.is_open:
+        """Stops the I/O threads and disconnects from the serial port."""
+        was_open = self.ser is not None and self.ser.is_open
+        if self._io_engine:
+            # The reader thread notices the stop within the serial read timeout.
+            self._stop_io_engine(timeout=self.config.SERIAL_TIMEOUT_SECONDS + 1)
+        if was_open:
             self.ser.close()
             self.connected = False
             print("Disconnected from serial device.")
 
     def read_data(self) -> tuple[int, int] | None:
-        """Reads and parses data from the serial port.
-
-        The expected format is "RPM_OBSTACLE_STATE".
+        """Reads and parses a single sample from the serial port.
 
         Returns:
             tuple[int, int] | None: A tuple containing the RPM value and the
                                      obstacle sensor state, or None if an error
                                      occurs.
         """
-        if not self.connected or not self.ser or not self.ser.is_open:
+        samples = self.read_samples(timeout=self.config.SERIAL_TIMEOUT_SECONDS)
+        if not samples:
             return None
-        try:
-            line = self.ser.readline().decode('utf-8', errors='ignore').strip()
-            if not line:  # Handle empty line if timeout occurs
-                return None
-            data_list = line.split('_')
-            if len(data_list) == 2:
-                rpm_value = int(data_list[0])
-                obstacle_sensor_state_value = int(data_list[1])
-                return rpm_value, obstacle_sensor_state_value
-        except (serial.SerialException, ValueError) as e:
-            print(f"Error reading serial data: {e}")
-            self.connected = False
-            if self.on_disconnect:
-                self.on_disconnect()
-        return None
+        # Hand the rest back, in front of anything the reader thread added meanwhile.
+        self._pending_samples.extendleft(reversed(samples[1:]))
+        return samples[0].rpm, samples[0].obstacle_state
+
+    def read_samples(self, timeout: float | None = None) -> list[TelemetrySample]:
+        """Returns every telemetry sample received since the last call.
+
+        Samples are decoded by the reader thread, so this never touches the port.
+
+        Args:
+            timeout (float | None): If nothing has been received, wait up to this
+                                    many seconds for data. None returns at once.
+
+        Returns:
+            list[TelemetrySample]: The decoded samples, oldest first. Empty on
+                                   timeout or when disconnected.
+        """
+        if not self.connected:
+            return []
+        if not self._pending_samples and timeout:
+            self._data_available.wait(timeout)
+        self._data_available.clear()
+        return self._drain(self._pending_samples)
 
-    def send_command(self, pwm_value: int, servo_code: ServoCode):
+    def read_obstacle_events(self) -> list[ObstacleEvent]:
+        """Returns the obstacle sensor edges decoded since the last call.
+
+        Events are only produced by the binary protocol.
+
+        Returns:
+            list[ObstacleEvent]: The edges, oldest first, with host_time set.
+        """
+        return self._drain(self._pending_events)
+
+    def read_action_events(self) -> list[ActionEvent]:
+        """Returns the scheduled servo moves the firmware reported since the last call."""
+        return self._drain(self._pending_actions)
+
+    @staticmethod
+    def _drain(queue: deque) -> list:
+        # popleft() rather than list() + clear(), which would lose entries the
+        # reader thread appends in between.
+        items = []
+        while queue:
+            items.append(queue.popleft())
+        return items
+
+    def send_command(self, pwm_value: int, servo_code: ServoCode | None):
         """Sends a command to the Arduino.
 
-        The command format is "PWM_SERVOCODE".
+        The command is a COMMAND frame with the binary protocol, otherwise the
+        ASCII line "PWM_SERVOCODE". It is queued for the writer thread; a
+        command that only sets the PWM replaces a previous one that has not
+        been sent yet.
 
         Args:
             pwm_value (int): The PWM value for the motor.
-            servo_code (ServoCode): The code for the servo position.
+            servo_code (ServoCode | None): The code for the servo position. None
+                leaves the servo alone; the ASCII protocol has no way to say
+                that and repeats the last code sent instead.
         """
-        if not self.connected or not self.ser or not self.ser.is_open:
+        if not self.connected or not self._io_engine:
             # Silently return if not connected, to avoid flooding the console
             return
-        try:
-            command = f"{pwm_value}_{servo_code.value}\n".encode()
-            self.ser.write(command)
-        except serial.SerialException as e:
-            print(f"Error sending serial command: {e}")
-            self.connected = False
-            if self.on_disconnect:
-                self.on_disconnect()
\ No newline at end of file
+        if servo_code is not None:
+            self._last_servo_code = servo_code
+        if self.binary_protocol:
+            servo_value = SERVO_CODE_KEEP if servo_code is None else int(servo_code.value)
+            payload = bytes([max(0, min(255, int(pwm_value))), servo_value])
+            # A servo move must not be merged away by a later PWM-only command.
+            key = FrameType.COMMAND if servo_code is None else None
+            self._io_engine.write(encode_frame(FrameType.COMMAND, payload), key)
+        else:
+            # Every ASCII command carries the full state, so the latest one is enough.
+            self._io_engine.write(f"{pwm_value}_{self._last_servo_code.value}\n".encode(), FrameType.COMMAND)
+
+    def schedule_servo_action(self, part_id: int, servo_code: ServoCode, detection_tick: int) -> bool:
+        """Asks the firmware to move the servo when a part reaches the gate.
+
+        The firmware adds the fixed tick distance between the obstacle sensor
+        and the gate to detection_tick and fires the move when the belt
+        encoder gets there, so the timing does not depend on host latency.
+        Requires the binary protocol.
+
+        Args:
+            part_id (int): Identifies the part in the resulting ActionEvent.
+            servo_code (ServoCode): The bin to sort the part into.
+            detection_tick (int): The encoder tick of the part's obstacle edge.
+
+        Returns:
+            bool: True if the move was sent.
+        """
+        if not self.connected or not self._io_engine or not self.binary_protocol:
+            return False
+        return self._io_engine.write(encode_schedule(part_id, int(servo_code.value), detection_tick))
+
+    def upload_bin_table(self, bin_angles: list[int], class_bins: dict[int, int]) -> bool:
+        """Replaces the firmware's class-to-bin table. Requires the binary protocol.
+
+        The firmware switches to the new table immediately and keeps it in
+        EEPROM, so it survives a reset. The acknowledgement is checked by the
+        reader thread; until it confirms the table, a resumed session uploads
+        the table again.
+
+        Args:
+            bin_angles (list[int]): Servo angle in degrees of each bin, at most 8.
+            class_bins (dict[int, int]): Bin index of each class code (0-15). The
+                                        class code is the servo code value sent
+                                        for a part; unlisted classes go home.
+
+        Returns:
+            bool: True if the table was sent.
+
+        Raises:
+            ValueError: If the table does not fit the protocol limits.
+        """
+        payload = encode_bin_table(bin_angles, class_bins)
+        # The firmware reports the CRC of its stored table, which covers the same bytes.
+        # Set before sending, as the acknowledgement may arrive before _send_frame returns.
+        self._bin_table_crc = None
+        self._pending_bin_table_crc = crc8(payload)
+        if not self._send_frame(FrameType.SET_BIN_TABLE, payload, coalesce=False):
+            self._pending_bin_table_crc = None
+            return False
+        return True
+
+    def request_device_stats(self, reset: bool = False) -> bool:
+        """Asks the firmware for its profiling counters. Requires the binary protocol.
+
+        The answer arrives asynchronously and is logged and stored in
+        device_stats by the reader thread.
+
+        Args:
+            reset (bool): Restart the firmware's min/max measurements after the report.
+
+        Returns:
+            bool: True if the request was sent.
+        """
+        return self._send_frame(FrameType.QUERY_STATS, bytes([STATS_FLAG_RESET if reset else 0]))
+
+    def set_rpm_setpoint(self, rpm: int) -> bool:
+        """Switches the firmware to closed-loop speed control.
+
+        The PWM field of subsequent commands is ignored by the firmware while a
+        setpoint is active. A setpoint of 0 returns to open-loop PWM control.
+        Requires the binary protocol.
+
+        Args:
+            rpm (int): The target belt speed in RPM.
+
+        Returns:
+            bool: True if the setpoint was sent.
+        """
+        payload = struct.pack('<H', max(0, min(0xFFFF, int(rpm))))
+        return self._send_frame(FrameType.SET_RPM, payload)
+
+    def set_pid_gains(self, kp: float, ki: float, kd: float) -> bool:
+        """Tunes the firmware speed controller. Requires the binary protocol.
+
+        Returns:
+            bool: True if the gains were sent.
+        """
+        gains = [max(-32768, min(32767, round(gain * GAIN_SCALE))) for gain in (kp, ki, kd)]
+        return self._send_frame(FrameType.SET_GAINS, struct.pack('<hhh', *gains))
+
+    def _send_frame(self, frame_type: FrameType, payload: bytes, coalesce: bool = True) -> bool:
+        """Queues a binary-only frame. Returns False if it could not be sent.
+
+        With coalesce, the frame replaces an unsent frame of the same type at
+        the end of the write queue.
+        """
+        if not self.connected or not self._io_engine or not self.binary_protocol:
+            return False
+        return self._io_engine.write(encode_frame(frame_type, payload), frame_type if coalesce else None)
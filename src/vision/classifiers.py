@@ -1,7 +1,12 @@
+import threading
+from concurrent.futures import ThreadPoolExecutor
 from enum import Enum
+from typing import Callable, NamedTuple
 import cv2
 import numpy as np
 from src.config.config import AppConfig
+from src.vision.color_kernel import NATIVE_AVAILABLE, label_colors
+from src.vision.features import FrameFeatures, to_host
 
 class ServoCode(Enum):
     """Enum for representing the servo codes to be sent to the Arduino.
@@ -9,7 +14,9 @@ class ServoCode(Enum):
     IMPORTANT: When multiple members have the same value, the second and
     subsequent members are aliases for the first member. This means that
     `ServoCode.RED` is the same object as `ServoCode.TRIANGLE`.
-    The value (e.g., '0') is used for hardware communication.
+    The value (e.g., '0') is used for hardware communication. It is a class
+    code that the firmware maps to a diverter bin through the bin table
+    uploaded from AppConfig.DIVERTER_CLASS_BINS.
     """
     # These codes are examples and should be mapped to actual servo actions
     # based on the hardware setup.
@@ -23,9 +30,45 @@ class ServoCode(Enum):
     MEDIUM = '1'
     LARGE = '2'
     UNKNOWN = '9' # Default for unclassified or error
+    # Class codes of CompositeClassifier results, see AppConfig.COMPOSITE_CLASS_CODES.
+    COMBINED_3 = '3'
+    COMBINED_4 = '4'
+    COMBINED_5 = '5'
+    COMBINED_6 = '6'
+    COMBINED_7 = '7'
+    COMBINED_8 = '8'
+    COMBINED_10 = '10'
+    COMBINED_11 = '11'
+    COMBINED_12 = '12'
+    COMBINED_13 = '13'
+    COMBINED_14 = '14'
+    COMBINED_15 = '15'
+
+class Classification(NamedTuple):
+    """The result of BaseClassifier.analyze().
+
+    Attributes:
+        servo_code (ServoCode): The servo code for the hardware.
+        name (str): The friendly name of the result (e.g., "Red").
+        category (str | None): The result without details (e.g., "Large" for
+                               "Large (5.2 cm)"); None if nothing was recognized.
+        draw (callable): Draws the annotations of the result onto a frame.
+    """
+    servo_code: ServoCode
+    name: str
+    category: str | None
+    draw: Callable[[np.ndarray], None]
+
+def _draw_nothing(frame: np.ndarray):
+    pass
 
 class BaseClassifier:
-    """Base class for all classifiers."""
+    """Base class for all classifiers.
+
+    Subclasses implement analyze(), which must not modify the frame or the
+    features; the annotations are drawn separately, so several classifiers can
+    analyze one frame concurrently and draw onto one copy afterwards.
+    """
     def __init__(self, config: AppConfig):
         self.config = config
 
@@ -34,44 +77,93 @@ class BaseClassifier:
         cv2.putText(frame, text, position, self.config.OPENCV_FONT,
                     self.config.OPENCV_FONT_SCALE, color, self.config.OPENCV_FONT_THICKNESS, cv2.LINE_AA)
 
-    def classify(self, frame: np.ndarray) -> tuple[ServoCode, np.ndarray, str]:
+    def analyze(self, frame: np.ndarray, features: FrameFeatures) -> Classification:
         """Abstract method for classifying an object in a frame.
 
+        Args:
+            frame (np.ndarray): The frame to classify.
+            features (FrameFeatures): Shared intermediates of frame.
+        """
+        raise NotImplementedError
+
+    def classify(self, frame: np.ndarray, features: FrameFeatures | None = None) -> tuple[ServoCode, np.ndarray, str]:
+        """Classifies an object in a frame and annotates a copy of it.
+
+        Args:
+            frame (np.ndarray): The frame to classify.
+            features (FrameFeatures, optional): Shared intermediates of frame;
+                created on demand if not given.
+
         Returns:
             tuple[ServoCode, np.ndarray, str]: A tuple containing:
                 - The servo code for the hardware.
                 - The processed frame with annotations.
                 - The friendly name of the classification result (e.g., "Red").
         """
-        raise NotImplementedError
+        result = self.analyze(frame, features or FrameFeatures(frame))
+        processed_frame = frame.copy()
+        result.draw(processed_frame)
+        return result.servo_code, processed_frame, result.name
 
 class ColorClassifier(BaseClassifier):
-    """Classifier for detecting objects based on their color."""
+    """Classifier for detecting objects based on their color.
+
+    Every pixel is labelled red, yellow, green or none in one pass (see
+    color_kernel), then the combined mask is opened once to drop speckle
+    noise. The color with the most surviving pixels wins. With
+    DeviceFrameFeatures the ranges, the opening and the counting run on the
+    OpenCL device instead.
+    """
     def __init__(self, config: AppConfig):
         super().__init__(config)
-        self.red_lower = np.array(self.config.RED_LOWER_HSV)
-        self.red_upper = np.array(self.config.RED_UPPER_HSV)
-        self.yellow_lower = np.array(self.config.YELLOW_LOWER_HSV)
-        self.yellow_upper = np.array(self.config.YELLOW_UPPER_HSV)
-        self.green_lower = np.array(self.config.GREEN_LOWER_HSV)
-        self.green_upper = np.array(self.config.GREEN_UPPER_HSV)
+        # Label 1, 2 and 3 of the label image, in this order.
+        self.color_ranges = [
+            (self.config.RED_LOWER_HSV, self.config.RED_UPPER_HSV),
+            (self.config.YELLOW_LOWER_HSV, self.config.YELLOW_UPPER_HSV),
+            (self.config.GREEN_LOWER_HSV, self.config.GREEN_UPPER_HSV),
+        ]
         self.kernel = np.ones((self.config.MORPHOLOGY_KERNEL_SIZE, self.config.MORPHOLOGY_KERNEL_SIZE), np.uint8)
-
-    def classify(self, frame: np.ndarray) -> tuple[ServoCode, np.ndarray, str]:
-        processed_frame = frame.copy()
-        hsv = cv2.cvtColor(frame, cv2.COLOR_BGR2HSV)
-
-        mask_red = cv2.inRange(hsv, self.red_lower, self.red_upper)
-        mask_yellow = cv2.inRange(hsv, self.yellow_lower, self.yellow_upper)
-        mask_green = cv2.inRange(hsv, self.green_lower, self.green_upper)
-
-        mask_red = cv2.morphologyEx(mask_red, cv2.MORPH_OPEN, self.kernel)
-        mask_yellow = cv2.morphologyEx(mask_yellow, cv2.MORPH_OPEN, self.kernel)
-        mask_green = cv2.morphologyEx(mask_green, cv2.MORPH_OPEN, self.kernel)
-
-        red_count = cv2.countNonZero(mask_red)
-        yellow_count = cv2.countNonZero(mask_yellow)
-        green_count = cv2.countNonZero(mask_green)
+        # Label and mask buffers, reused between frames of the same size. The
+        # pipeline's workers classify frames at once and the native kernel
+        # writes the buffers without the GIL, so every thread has its own.
+        self._buffers = threading.local()
+
+    def _count_colors(self, frame: np.ndarray, features: FrameFeatures) -> tuple[np.ndarray, list[int]]:
+        """The opened mask of colored pixels and the pixel count of each color within it."""
+        # The native kernel converts to HSV itself; the OpenCV fallback shares the cached HSV image.
+        hsv = None if NATIVE_AVAILABLE else features.hsv
+        buffers = self._buffers
+        labels, colored, _ = label_colors(frame, self.color_ranges, getattr(buffers, "labels", None),
+                                          getattr(buffers, "mask", None), hsv)
+        buffers.labels, buffers.mask = labels, colored
+        mask = cv2.morphologyEx(colored, cv2.MORPH_OPEN, self.kernel)
+
+        # Only pixels that survive the opening vote for a color.
+        kept_labels = cv2.bitwise_and(labels, mask)
+        return mask, np.bincount(kept_labels.ravel(), minlength=4)[1:4].tolist()
+
+    def _count_colors_on_device(self, features: FrameFeatures) -> tuple[np.ndarray, list[int]]:
+        """Same as _count_colors(), with every step on the device; only the mask and the counts come back."""
+        ranges = [cv2.inRange(features.hsv, np.array(lower), np.array(upper)) for lower, upper in self.color_ranges]
+        colored = ranges[0]
+        for in_range in ranges[1:]:
+            colored = cv2.bitwise_or(colored, in_range)
+        mask = cv2.morphologyEx(colored, cv2.MORPH_OPEN, self.kernel)
+
+        # A pixel in several ranges counts for the first one, as in label_colors().
+        counts, earlier = [], None
+        for in_range in ranges:
+            own = in_range if earlier is None else cv2.bitwise_and(in_range, cv2.bitwise_not(earlier))
+            counts.append(cv2.countNonZero(cv2.bitwise_and(own, mask)))
+            earlier = in_range if earlier is None else cv2.bitwise_or(earlier, in_range)
+        return mask.get(), counts
+
+    def analyze(self, frame: np.ndarray, features: FrameFeatures) -> Classification:
+        if features.on_device:
+            mask, counts = self._count_colors_on_device(features)
+        else:
+            mask, counts = self._count_colors(frame, features)
+        red_count, yellow_count, green_count = counts
 
         color = "Unknown"
         color_code = (0, 0, 0) # Black for unknown
@@ -90,10 +182,6 @@ class ColorClassifier(BaseClassifier):
             color_code = (0, 255, 0)
             servo_code = ServoCode.GREEN
 
-        mask = cv2.bitwise_or(mask_red, mask_yellow)
-        mask = cv2.bitwise_or(mask, mask_green)
-        mask = cv2.morphologyEx(mask, cv2.MORPH_OPEN, self.kernel)
-
         contours, _ = cv2.findContours(mask, cv2.RETR_EXTERNAL, cv2.CHAIN_APPROX_SIMPLE)
 
         max_area = 0
@@ -104,29 +192,27 @@ class ColorClassifier(BaseClassifier):
                 max_area = area
                 max_c = c
 
-        if max_c is not None:
-            x,y,w,h = cv2.boundingRect(max_c)
-            cv2.rectangle(processed_frame,(x,y),(x+w,y+h),color_code,2)
-        self._draw_text(processed_frame, color, (processed_frame.shape[1]-100,50), color_code)
+        def draw(processed_frame: np.ndarray):
+            if max_c is not None:
+                x,y,w,h = cv2.boundingRect(max_c)
+                cv2.rectangle(processed_frame,(x,y),(x+w,y+h),color_code,2)
+            self._draw_text(processed_frame, color, (processed_frame.shape[1]-100,50), color_code)
 
-        return servo_code, processed_frame, color
+        return Classification(servo_code, color, None if servo_code == ServoCode.UNKNOWN else color, draw)
 
 class ShapeClassifier(BaseClassifier):
     """Classifier for detecting objects based on their shape."""
-    def classify(self, frame: np.ndarray) -> tuple[ServoCode, np.ndarray, str]:
-        processed_frame = frame.copy()
-        gray = cv2.cvtColor(frame, cv2.COLOR_BGR2GRAY)
-        blurred = cv2.GaussianBlur(gray, (5, 5), 0)
-        _, mask = cv2.threshold(blurred, 60, 255, cv2.THRESH_BINARY)
+    def analyze(self, frame: np.ndarray, features: FrameFeatures) -> Classification:
+        unknown = Classification(ServoCode.UNKNOWN, "Unknown", None, _draw_nothing)
+        if frame.size == 0:
+            return unknown
 
-        if mask is None or mask.size == 0:
-            return ServoCode.UNKNOWN, processed_frame, "Unknown"
-
-        mask = cv2.medianBlur(mask, 7)
+        _, mask = cv2.threshold(features.blurred, 60, 255, cv2.THRESH_BINARY)
+        mask = to_host(cv2.medianBlur(mask, 7))
         contours, _ = cv2.findContours(mask, cv2.RETR_TREE, cv2.CHAIN_APPROX_SIMPLE)
 
         if not contours:
-            return ServoCode.UNKNOWN, processed_frame, "Unknown"
+            return unknown
 
         contour = sorted(contours, key=cv2.contourArea, reverse=True)[0]
 
@@ -152,63 +238,56 @@ class ShapeClassifier(BaseClassifier):
                 shape = "Circle"
                 servo_code = ServoCode.CIRCLE
 
-        if shape == "Triangle":
-            cv2.drawContours(processed_frame, [approx], -1, (0, 255, 0), 2)
-        elif shape == "Square":
-            rotated_rect = cv2.minAreaRect(contour)
-            box = cv2.boxPoints(rotated_rect)
-            box = np.int32(box)
-            cv2.drawContours(processed_frame, [box], 0, (0, 255, 0), 2)
-        elif shape == "Circle":
-            (x, y), radius = cv2.minEnclosingCircle(approx)
-            center = (int(x), int(y))
-            radius = int(radius)
-            cv2.circle(processed_frame, center, radius, (0, 255, 0), 2)
-
-        M = cv2.moments(contour)
-        if M["m00"] != 0:
-            cX = int(M["m10"] / M["m00"])
-            cY = int(M["m01"] / M["m00"])
-            self._draw_text(processed_frame, shape, (cX, cY), (255, 255, 255))
-
-        return servo_code, processed_frame, shape
+        def draw(processed_frame: np.ndarray):
+            if shape == "Triangle":
+                cv2.drawContours(processed_frame, [approx], -1, (0, 255, 0), 2)
+            elif shape == "Square":
+                rotated_rect = cv2.minAreaRect(contour)
+                box = cv2.boxPoints(rotated_rect)
+                box = np.int32(box)
+                cv2.drawContours(processed_frame, [box], 0, (0, 255, 0), 2)
+            elif shape == "Circle":
+                (x, y), radius = cv2.minEnclosingCircle(approx)
+                center = (int(x), int(y))
+                radius = int(radius)
+                cv2.circle(processed_frame, center, radius, (0, 255, 0), 2)
+
+            M = cv2.moments(contour)
+            if M["m00"] != 0:
+                cX = int(M["m10"] / M["m00"])
+                cY = int(M["m01"] / M["m00"])
+                self._draw_text(processed_frame, shape, (cX, cY), (255, 255, 255))
+
+        return Classification(servo_code, shape, None if servo_code == ServoCode.UNKNOWN else shape, draw)
 
 class SizeClassifier(BaseClassifier):
     """Classifier for detecting objects based on their size."""
     def __init__(self, config: AppConfig):
         super().__init__(config)
         self.pixels_per_cm = None
+        # Bounding box (x, y, w, h) of the calibration object in the last successful calibration.
+        self.calibration_rect = None
 
     def calibrate(self, frame: np.ndarray, known_diameter_cm: float) -> float:
-        gray = cv2.cvtColor(frame, cv2.COLOR_BGR2GRAY)
-        blurred = cv2.GaussianBlur(gray, (5, 5), 0)
-        edged = cv2.Canny(blurred, 50, 100)
-
-        contours, _ = cv2.findContours(edged.copy(), cv2.RETR_EXTERNAL, cv2.CHAIN_APPROX_SIMPLE)
+        contours = FrameFeatures(frame).edge_contours
 
         if contours:
             c = max(contours, key=cv2.contourArea)
             if cv2.contourArea(c) > self.config.SHAPE_AREA_THRESHOLD:
-                (_, _, w, _) = cv2.boundingRect(c)
+                (x, y, w, h) = cv2.boundingRect(c)
                 if w > 0:
                     self.pixels_per_cm = w / known_diameter_cm
+                    self.calibration_rect = (x, y, w, h)
                     return self.pixels_per_cm
         return None
 
-    def classify(self, frame: np.ndarray) -> tuple[ServoCode, np.ndarray, str]:
-        processed_frame = frame.copy()
-        size_text = "Unknown"
-        servo_code = ServoCode.UNKNOWN
-
+    def analyze(self, frame: np.ndarray, features: FrameFeatures) -> Classification:
         if self.pixels_per_cm is None:
-            self._draw_text(processed_frame, "Calibrate first!", (50, 50), (0, 0, 255))
-            return servo_code, processed_frame, "Needs Calibration"
+            def draw_calibration_hint(processed_frame: np.ndarray):
+                self._draw_text(processed_frame, "Calibrate first!", (50, 50), (0, 0, 255))
+            return Classification(ServoCode.UNKNOWN, "Needs Calibration", None, draw_calibration_hint)
 
-        gray = cv2.cvtColor(frame, cv2.COLOR_BGR2GRAY)
-        blurred = cv2.GaussianBlur(gray, (5, 5), 0)
-        edged = cv2.Canny(blurred, 50, 100)
-
-        contours, _ = cv2.findContours(edged.copy(), cv2.RETR_EXTERNAL, cv2.CHAIN_APPROX_SIMPLE)
+        contours = features.edge_contours
 
         if contours:
             c = max(contours, key=cv2.contourArea)
@@ -220,15 +299,59 @@ class SizeClassifier(BaseClassifier):
 
                 diameter = w / self.pixels_per_cm
                 if diameter >= self.config.LARGE_SIZE_THRESHOLD_CM:
-                    size_text = f"Large ({diameter:.1f} cm)"
-                    servo_code = ServoCode.LARGE
+                    category, servo_code = "Large", ServoCode.LARGE
                 elif diameter >= self.config.MEDIUM_SIZE_THRESHOLD_CM:
-                    size_text = f"Medium ({diameter:.1f} cm)"
-                    servo_code = ServoCode.MEDIUM
+                    category, servo_code = "Medium", ServoCode.MEDIUM
                 else:
-                    size_text = f"Small ({diameter:.1f} cm)"
-                    servo_code = ServoCode.SMALL
+                    category, servo_code = "Small", ServoCode.SMALL
+                size_text = f"{category} ({diameter:.1f} cm)"
+
+                def draw(processed_frame: np.ndarray):
+                    self._draw_text(processed_frame, size_text, (cX - 20, cY - 20), (255, 255, 255))
+
+                return Classification(servo_code, size_text, category, draw)
+
+        return Classification(ServoCode.UNKNOWN, "Unknown", None, _draw_nothing)
 
-                self._draw_text(processed_frame, size_text, (cX - 20, cY - 20), (255, 255, 255))
+class CompositeClassifier(BaseClassifier):
+    """Runs several classifiers on the same frame and combines their results.
 
-        return servo_code, processed_frame, size_text
\ No newline at end of file
+    The classifiers analyze the frame concurrently on a thread pool, sharing
+    one FrameFeatures; OpenCV and the native color kernel release the GIL, so
+    they do run in parallel. Every combination of categories (e.g. ("Red",
+    "Circle")) is mapped to its own class code by AppConfig.COMPOSITE_CLASS_CODES,
+    so one pass of parts down the belt can be sorted by all criteria at once.
+    A part is unknown if any classifier did not recognize it or its
+    combination has no code.
+
+    Args:
+        config (AppConfig): The application configuration object.
+        classifiers (list[BaseClassifier]): In the order of the keys of
+                                            COMPOSITE_CLASS_CODES.
+
+    Raises:
+        ValueError: If a class code in COMPOSITE_CLASS_CODES is not a ServoCode value.
+    """
+    def __init__(self, config: AppConfig, classifiers: list[BaseClassifier]):
+        super().__init__(config)
+        self.classifiers = list(classifiers)
+        self.class_codes = {tuple(categories): ServoCode(str(code))
+                            for categories, code in self.config.COMPOSITE_CLASS_CODES.items()}
+        self._executor = ThreadPoolExecutor(max_workers=len(self.classifiers), thread_name_prefix="classifier")
+
+    def analyze(self, frame: np.ndarray, features: FrameFeatures) -> Classification:
+        futures = [self._executor.submit(classifier.analyze, frame, features) for classifier in self.classifiers]
+        results = [future.result() for future in futures]
+        categories = tuple(result.category for result in results)
+        servo_code = self.class_codes.get(categories, ServoCode.UNKNOWN)
+        name = " / ".join(result.name for result in results)
+
+        def draw(processed_frame: np.ndarray):
+            for result in results:
+                result.draw(processed_frame)
+
+        return Classification(servo_code, name, None if servo_code == ServoCode.UNKNOWN else name, draw)
+
+    def close(self):
+        """Stops the worker threads."""
+        self._executor.shutdown(wait=False)
@@ -0,0 +1,56 @@
+import cv2
+import numpy as np
+
+try:
+    from src.vision import _color_kernel
+except ImportError:  # Not built, see setup.py
+    _color_kernel = None
+
+NATIVE_AVAILABLE = _color_kernel is not None
+
+
+def label_colors(frame: np.ndarray, ranges: list[tuple[tuple, tuple]], labels: np.ndarray | None = None,
+                 mask: np.ndarray | None = None, hsv: np.ndarray | None = None) -> tuple[np.ndarray, np.ndarray, list[int]]:
+    """Labels every pixel of a BGR frame with the HSV range it falls into.
+
+    Uses the fused native kernel if it has been built (python setup.py
+    build_ext --inplace), otherwise cvtColor and one inRange per range. Both
+    give identical results.
+
+    Args:
+        frame (np.ndarray): The BGR input frame.
+        ranges (list): (lower, upper) HSV bounds, at most 8. A pixel in several
+                       ranges gets the first one.
+        labels (np.ndarray, optional): HxW uint8 output buffer to reuse.
+        mask (np.ndarray, optional): HxW uint8 output buffer to reuse.
+        hsv (np.ndarray, optional): The frame already converted to HSV; only
+                                    used by the OpenCV fallback.
+
+    Returns:
+        tuple[np.ndarray, np.ndarray, list[int]]: The label image (1 + range
+            index, 0 for none), the 255/0 mask of labelled pixels and the
+            pixel count of every range.
+    """
+    shape = frame.shape[:2]
+    if labels is None or labels.shape != shape:
+        labels = np.empty(shape, np.uint8)
+    if mask is None or mask.shape != shape:
+        mask = np.empty(shape, np.uint8)
+
+    if _color_kernel is not None:
+        if frame.strides[1:] != (3, 1):
+            frame = np.ascontiguousarray(frame)
+        # Row strides are fine, so a region-of-interest view is not copied.
+        counts = _color_kernel.label_colors(frame, ranges, labels, mask)
+        return labels, mask, list(counts)
+
+    if hsv is None:
+        hsv = cv2.cvtColor(frame, cv2.COLOR_BGR2HSV)
+    labels[:] = 0
+    # Paint the ranges back to front so the first matching range wins.
+    for index in range(len(ranges), 0, -1):
+        lower, upper = ranges[index - 1]
+        labels[cv2.inRange(hsv, np.array(lower), np.array(upper)) > 0] = index
+    cv2.compare(labels, 0, cv2.CMP_GT, dst=mask)
+    counts = np.bincount(labels.ravel(), minlength=len(ranges) + 1)[1:]
+    return labels, mask, counts.tolist()
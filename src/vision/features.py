@@ -0,0 +1,107 @@
+import cv2
+import numpy as np
+
+
+def to_host(image) -> np.ndarray:
+    """The image as an np.ndarray, downloaded from the device if it is a cv2.UMat."""
+    return image.get() if isinstance(image, cv2.UMat) else image
+
+
+class FrameFeatures:
+    """Intermediate images of one frame, computed on first use and shared.
+
+    ImageProcessor creates one per frame and hands it to every classifier, so
+    when several classifiers look at the same frame the grayscale conversion,
+    the blur, the HSV conversion and the edge detection each run only once.
+    Classifiers must treat the cached images as read-only.
+
+    Args:
+        frame (np.ndarray): The BGR frame (or region of interest) to describe.
+    """
+    BLUR_KERNEL_SIZE = (5, 5)
+    CANNY_THRESHOLDS = (50, 100)
+    on_device = False  # Whether the cached images are cv2.UMat, see DeviceFrameFeatures
+
+    def __init__(self, frame: np.ndarray):
+        self.frame = frame
+        # Plain lazy attributes rather than functools.cached_property, which on
+        # Python <= 3.11 holds one lock per property for all instances and so
+        # would serialise the analysis workers. Two threads may compute the
+        # same image at once; both results are equal.
+        self._gray = self._blurred = self._hsv = self._edges = self._edge_contours = None
+
+    @property
+    def gray(self) -> np.ndarray:
+        if self._gray is None:
+            self._gray = cv2.cvtColor(self.frame, cv2.COLOR_BGR2GRAY)
+        return self._gray
+
+    @property
+    def blurred(self) -> np.ndarray:
+        """The grayscale image after a 5x5 Gaussian blur."""
+        if self._blurred is None:
+            self._blurred = cv2.GaussianBlur(self.gray, self.BLUR_KERNEL_SIZE, 0)
+        return self._blurred
+
+    @property
+    def hsv(self) -> np.ndarray:
+        if self._hsv is None:
+            self._hsv = cv2.cvtColor(self.frame, cv2.COLOR_BGR2HSV)
+        return self._hsv
+
+    @property
+    def edges(self) -> np.ndarray:
+        """Canny edges of the blurred image."""
+        if self._edges is None:
+            self._edges = cv2.Canny(self.blurred, *self.CANNY_THRESHOLDS)
+        return self._edges
+
+    @property
+    def edge_contours(self) -> tuple:
+        """External contours of the edge image."""
+        if self._edge_contours is None:
+            # findContours no longer modifies its input (OpenCV >= 3.2), so no copy is needed.
+            self._edge_contours, _ = cv2.findContours(self.edges, cv2.RETR_EXTERNAL, cv2.CHAIN_APPROX_SIMPLE)
+        return self._edge_contours
+
+
+class DeviceFrameFeatures(FrameFeatures):
+    """FrameFeatures computed on the OpenCL device through OpenCV's transparent API.
+
+    The frame is uploaded once, on first use, and the color conversions, the
+    blur and the edge detection all run on the device with their results
+    kept there as cv2.UMat; classifiers use to_host() where they need an
+    np.ndarray. Only the binary edge image comes back, for findContours(),
+    which has no OpenCL implementation. Without an OpenCL device OpenCV runs
+    the same calls on the CPU.
+    """
+    on_device = True
+
+    def __init__(self, frame: np.ndarray):
+        super().__init__(frame)
+        self._device_frame = None
+
+    @property
+    def device_frame(self) -> cv2.UMat:
+        if self._device_frame is None:
+            self._device_frame = cv2.UMat(self.frame)
+        return self._device_frame
+
+    @property
+    def gray(self) -> cv2.UMat:
+        if self._gray is None:
+            self._gray = cv2.cvtColor(self.device_frame, cv2.COLOR_BGR2GRAY)
+        return self._gray
+
+    @property
+    def hsv(self) -> cv2.UMat:
+        if self._hsv is None:
+            self._hsv = cv2.cvtColor(self.device_frame, cv2.COLOR_BGR2HSV)
+        return self._hsv
+
+    @property
+    def edge_contours(self) -> tuple:
+        if self._edge_contours is None:
+            self._edge_contours, _ = cv2.findContours(self.edges.get(), cv2.RETR_EXTERNAL,
+                                                      cv2.CHAIN_APPROX_SIMPLE)
+        return self._edge_contours
@@ -1,7 +1,9 @@
 import cv2
 import numpy as np
 from src.config.config import AppConfig
-from src.vision.classifiers import BaseClassifier, ServoCode
+from src.vision.classifiers import BaseClassifier, Classification, ServoCode
+from src.vision.color_kernel import NATIVE_AVAILABLE
+from src.vision.features import DeviceFrameFeatures, FrameFeatures
 
 class ImageProcessor:
     """Processes image frames using a given classifier.
@@ -10,11 +12,58 @@ class ImageProcessor:
     It can apply preprocessing steps to a frame and then use a classifier to
     detect and classify objects.
 
+    If a region of interest is set, classifiers only see that part of the
+    frame, as a view that shares the frame's memory. Their annotations are
+    copied back into the full frame and the region is outlined.
+
+    With VISION_BACKEND = "opencl" the features of a frame are computed on the
+    GPU (see DeviceFrameFeatures); the frame stays on the CPU for annotation.
+
     Args:
         config (AppConfig): The application configuration object.
+
+    Raises:
+        ValueError: If VISION_BACKEND is not "cpu" or "opencl".
     """
     def __init__(self, config: AppConfig):
         self.config = config
+        self.roi = None
+        self.set_roi(config.ROI)
+        self.use_opencl = False
+        if config.VISION_BACKEND == "opencl":
+            self.use_opencl = self._enable_opencl()
+        elif config.VISION_BACKEND != "cpu":
+            raise ValueError(f"Unknown vision backend: {config.VISION_BACKEND!r}")
+        self._features_class = DeviceFrameFeatures if self.use_opencl else FrameFeatures
+        if not NATIVE_AVAILABLE and not self.use_opencl:
+            print("Native color kernel not built, color classification uses OpenCV "
+                  "(python setup.py build_ext --inplace).")
+
+    @staticmethod
+    def _enable_opencl() -> bool:
+        if not cv2.ocl.haveOpenCL():
+            print("No OpenCL device found, the vision features are computed on the CPU.")
+            return False
+        cv2.ocl.setUseOpenCL(True)
+        print(f"Vision features are computed on {cv2.ocl.Device.getDefault().name()} (OpenCL).")
+        return True
+
+    def set_roi(self, roi: tuple[int, int, int, int] | None):
+        """Sets the region of interest.
+
+        Args:
+            roi (tuple | None): (x, y, width, height) in frame pixels, or None
+                                for the whole frame.
+
+        Raises:
+            ValueError: If the region is empty.
+        """
+        if roi is not None:
+            x, y, width, height = (int(value) for value in roi)
+            if width <= 0 or height <= 0 or x < 0 or y < 0:
+                raise ValueError(f"Invalid region of interest: {roi}")
+            roi = (x, y, width, height)
+        self.roi = roi
 
     def preprocess_frame(self, frame: np.ndarray) -> np.ndarray:
         """Applies preprocessing steps to an image frame.
@@ -26,19 +75,98 @@ class ImageProcessor:
             frame (np.ndarray): The input frame.
 
         Returns:
-            np.ndarray: The preprocessed frame.
+            np.ndarray: The region of interest as a view of frame (no pixels are
+                        copied), or frame itself if no region is set.
+        """
+        if self.roi is None:
+            return frame
+        x, y, width, height = self.roi
+        return frame[y:y + height, x:x + width]
+
+    def extract_features(self, frame: np.ndarray) -> FrameFeatures:
+        """Returns the shared feature cache of the frame's region of interest.
+
+        Pass it to several process_frame() calls on the same frame so the
+        classifiers share their intermediate images.
         """
-        # Example: Convert to grayscale, apply blurring, etc.
-        # gray = cv2.cvtColor(frame, cv2.COLOR_BGR2GRAY)
-        # blurred = cv2.GaussianBlur(gray, (5, 5), 0)
-        return frame
+        return self._features_class(self.preprocess_frame(frame))
+
+    def detect_objects(self, features: FrameFeatures) -> list[tuple[int, int, int, int]]:
+        """Finds the separate parts in a frame's region of interest.
+
+        Args:
+            features (FrameFeatures): From extract_features(frame).
 
-    def process_frame(self, frame: np.ndarray, classifier: BaseClassifier) -> tuple[ServoCode, np.ndarray, str]:
+        Returns:
+            list[tuple]: Bounding boxes (x, y, width, height) in region
+                         coordinates, largest first.
+        """
+        boxes = [cv2.boundingRect(contour) for contour in features.edge_contours]
+        boxes = [box for box in boxes if box[2] * box[3] >= self.config.TRACKER_MIN_BOX_AREA]
+        boxes.sort(key=lambda box: box[2] * box[3], reverse=True)
+        # The edges of one part often break up into pieces; keep only the outermost box.
+        parts = []
+        for x, y, w, h in boxes:
+            if not any(px <= x and py <= y and x + w <= px + pw and y + h <= py + ph for px, py, pw, ph in parts):
+                parts.append((x, y, w, h))
+        return parts
+
+    def classify_box(self, features: FrameFeatures, canvas: np.ndarray, box: tuple[int, int, int, int],
+                     classifier: BaseClassifier) -> Classification:
+        """Classifies the one part inside a box found by detect_objects().
+
+        Args:
+            features (FrameFeatures): From extract_features(frame).
+            canvas (np.ndarray): A copy of the full frame; the result is drawn onto it.
+            box (tuple): The part's box in region coordinates.
+            classifier (BaseClassifier): The classifier to use.
+        """
+        x, y, w, h = box
+        margin = self.config.TRACKER_CROP_MARGIN_PX
+        x0, y0 = max(0, x - margin), max(0, y - margin)
+        x1, y1 = x + w + margin, y + h + margin
+        crop = features.frame[y0:y1, x0:x1]
+        result = classifier.analyze(crop, self._features_class(crop))
+        result.draw(self.preprocess_frame(canvas)[y0:y1, x0:x1])
+        return result
+
+    def draw_track(self, canvas: np.ndarray, track_id: int, box: tuple[int, int, int, int], label: str):
+        """Outlines a tracked part on a copy of the full frame."""
+        x, y, w, h = box
+        region = self.preprocess_frame(canvas)
+        cv2.rectangle(region, (x, y), (x + w, y + h), self.config.TRACK_OUTLINE_COLOR, 1)
+        cv2.putText(region, f"#{track_id} {label}", (x, max(0, y - 4)), self.config.OPENCV_FONT,
+                    self.config.OPENCV_FONT_SCALE, self.config.TRACK_OUTLINE_COLOR, 1, cv2.LINE_AA)
+
+    def classify_frame(self, features: FrameFeatures, canvas: np.ndarray,
+                       classifier: BaseClassifier) -> Classification:
+        """Classifies a frame's region of interest and draws the result onto canvas.
+
+        Unlike process_frame(), no copy of the frame is made; the annotations
+        go straight onto the region of canvas, which is outlined.
+
+        Args:
+            features (FrameFeatures): From extract_features(frame).
+            canvas (np.ndarray): A copy of the full frame.
+            classifier (BaseClassifier): The classifier to use.
+        """
+        result = classifier.analyze(features.frame, features)
+        region = self.preprocess_frame(canvas)
+        result.draw(region)
+        if self.roi is not None:
+            x, y = self.roi[:2]
+            height, width = region.shape[:2]
+            cv2.rectangle(canvas, (x, y), (x + width - 1, y + height - 1), self.config.ROI_OUTLINE_COLOR, 1)
+        return result
+
+    def process_frame(self, frame: np.ndarray, classifier: BaseClassifier,
+                      features: FrameFeatures | None = None) -> tuple[ServoCode, np.ndarray, str]:
         """Processes a frame using a given classifier.
 
         Args:
             frame (np.ndarray): The input frame.
             classifier (BaseClassifier): The classifier to use for processing.
+            features (FrameFeatures, optional): From extract_features(frame).
 
         Returns:
             tuple[ServoCode, np.ndarray, str]: A tuple containing the servo code,
@@ -48,6 +176,19 @@ class ImageProcessor:
         if classifier is None:
             return ServoCode.UNKNOWN, frame, "Unknown"
 
-        preprocessed_frame = self.preprocess_frame(frame)
-        servo_code, annotated_frame, friendly_name = classifier.classify(preprocessed_frame)
-        return servo_code, annotated_frame, friendly_name
\ No newline at end of file
+        if features is None:
+            features = self.extract_features(frame)
+        preprocessed_frame = features.frame
+        servo_code, annotated_frame, friendly_name = classifier.classify(preprocessed_frame, features)
+        if self.roi is not None:
+            annotated_frame = self._map_to_full_frame(frame, annotated_frame)
+        return servo_code, annotated_frame, friendly_name
+
+    def _map_to_full_frame(self, frame: np.ndarray, annotated_roi: np.ndarray) -> np.ndarray:
+        """Pastes the annotated region back into a copy of the full frame."""
+        x, y = self.roi[:2]
+        height, width = annotated_roi.shape[:2]
+        annotated_frame = frame.copy()
+        annotated_frame[y:y + height, x:x + width] = annotated_roi
+        cv2.rectangle(annotated_frame, (x, y), (x + width - 1, y + height - 1), self.config.ROI_OUTLINE_COLOR, 1)
+        return annotated_frame
\ No newline at end of file
@@ -0,0 +1,122 @@
+from collections import Counter
+from typing import Callable
+
+Box = tuple[int, int, int, int]  # x, y, width, height
+
+
+def box_iou(a: Box, b: Box) -> float:
+    """Intersection over union of two boxes."""
+    ax, ay, aw, ah = a
+    bx, by, bw, bh = b
+    width = min(ax + aw, bx + bw) - max(ax, bx)
+    height = min(ay + ah, by + bh) - max(ay, by)
+    if width <= 0 or height <= 0:
+        return 0.0
+    intersection = width * height
+    return intersection / (aw * ah + bw * bh - intersection)
+
+
+def box_centroid(box: Box) -> tuple[float, float]:
+    x, y, width, height = box
+    return x + width / 2, y + height / 2
+
+
+class Track:
+    """One part followed across frames, with its own classification votes.
+
+    Attributes:
+        track_id (int): Unique, increasing in the order parts appeared.
+        box (Box): The latest bounding box.
+        first_seen_time (float): Capture time of the frame the part appeared in.
+        votes: The per-frame votes, see SequentialVote.
+        names (Counter): Friendly names of the votes.
+        trigger_time (float | None): Host time of the part's obstacle edge.
+        trigger_tick (int | None): Encoder tick of the part's obstacle edge.
+        decided (bool): Whether the part's bin has been sent to the firmware.
+    """
+    def __init__(self, track_id: int, box: Box, first_seen_time: float, votes):
+        self.track_id = track_id
+        self.box = box
+        self.first_seen_time = first_seen_time
+        self.votes = votes
+        self.names = Counter()
+        self.missed_frames = 0
+        self.trigger_time = None
+        self.trigger_tick = None
+        self.decided = False
+
+
+class CentroidTracker:
+    """Associates the detections of consecutive frames with tracks.
+
+    Detections are matched to tracks greedily by the highest IoU, then the
+    remaining ones by the nearest centroid, which still works when a part
+    moves more than its own size between frames. A track that goes unmatched
+    for more than max_missed_frames frames is dropped.
+
+    Args:
+        iou_threshold (float): Least IoU of a match.
+        max_distance (float): Largest centroid distance in pixels of a match.
+        max_missed_frames (int): Frames a track survives without a detection.
+        vote_factory (callable): Creates the vote buffer of a new track.
+    """
+    def __init__(self, iou_threshold: float, max_distance: float, max_missed_frames: int,
+                 vote_factory: Callable[[], object]):
+        self.iou_threshold = iou_threshold
+        self.max_distance = max_distance
+        self.max_missed_frames = max_missed_frames
+        self.vote_factory = vote_factory
+        self.tracks: list[Track] = []
+        self._next_id = 0
+
+    def update(self, boxes: list[Box], frame_time: float) -> tuple[list[Track], list[Track]]:
+        """Matches the detections of a new frame captured at frame_time.
+
+        Returns:
+            tuple[list[Track], list[Track]]: The current tracks, oldest first,
+                and the tracks that were dropped in this update.
+        """
+        unmatched_tracks = set(range(len(self.tracks)))
+        unmatched_boxes = set(range(len(boxes)))
+
+        by_overlap = sorted(((box_iou(self.tracks[t].box, boxes[b]), t, b)
+                             for t in unmatched_tracks for b in unmatched_boxes), reverse=True)
+        self._assign([(t, b) for iou, t, b in by_overlap if iou >= self.iou_threshold],
+                     boxes, unmatched_tracks, unmatched_boxes)
+
+        by_distance = sorted((self._centroid_distance(self.tracks[t].box, boxes[b]), t, b)
+                             for t in unmatched_tracks for b in unmatched_boxes)
+        self._assign([(t, b) for distance, t, b in by_distance if distance <= self.max_distance],
+                     boxes, unmatched_tracks, unmatched_boxes)
+
+        lost = []
+        for t in unmatched_tracks:
+            track = self.tracks[t]
+            track.missed_frames += 1
+            if track.missed_frames > self.max_missed_frames:
+                lost.append(track)
+        self.tracks = [track for track in self.tracks if track not in lost]
+
+        for b in sorted(unmatched_boxes):
+            self.tracks.append(Track(self._next_id, boxes[b], frame_time, self.vote_factory()))
+            self._next_id += 1
+        return self.tracks, lost
+
+    def _assign(self, candidates: list[tuple[int, int]], boxes: list[Box], unmatched_tracks: set,
+                unmatched_boxes: set):
+        """Matches (track, box) candidates, best first, each track and box at most once."""
+        for t, b in candidates:
+            if t in unmatched_tracks and b in unmatched_boxes:
+                track = self.tracks[t]
+                track.box = boxes[b]
+                track.missed_frames = 0
+                unmatched_tracks.discard(t)
+                unmatched_boxes.discard(b)
+
+    @staticmethod
+    def _centroid_distance(a: Box, b: Box) -> float:
+        (ax, ay), (bx, by) = box_centroid(a), box_centroid(b)
+        return ((ax - bx) ** 2 + (ay - by) ** 2) ** 0.5
+
+    def clear(self):
+        self.tracks = []
@@ -0,0 +1,52 @@
+import unittest
+
+from src.hardware.belt_clock import BeltClock
+from src.hardware.device_clock import DeviceClock
+
+
+class TestBeltClock(unittest.TestCase):
+    def setUp(self):
+        # Device time 0 is host time 100.0.
+        self.device_clock = DeviceClock()
+        self.clock = BeltClock(self.device_clock, max_extrapolation_seconds=0.5, rate_window_seconds=0.2)
+
+    def observe(self, timestamp_us, tick):
+        self.device_clock.observe(timestamp_us, 100.0 + timestamp_us / 1e6)
+        self.clock.observe(timestamp_us, tick)
+
+    def test_unknown_without_samples(self):
+        self.assertIsNone(self.clock.tick_at(100.0))
+        self.device_clock.observe(0, 100.0)
+        self.assertIsNone(self.clock.tick_at(100.0))
+
+    def test_interpolates_between_samples(self):
+        self.observe(0, 1000)
+        self.observe(100_000, 1100)
+        self.observe(200_000, 1300)
+        self.assertEqual(self.clock.tick_at(100.05), 1050)
+        self.assertEqual(self.clock.tick_at(100.15), 1200)
+        self.assertEqual(self.clock.tick_at(100.1), 1100)
+        self.assertIsNone(self.clock.tick_at(99.9))  # Before the oldest sample
+
+    def test_latency_does_not_shift_ticks(self):
+        self.observe(0, 1000)
+        # Received late; the clock offset still comes from the fast first frame.
+        self.device_clock.observe(100_000, 100.3)
+        self.clock.observe(100_000, 1100)
+        self.assertEqual(self.clock.tick_at(100.05), 1050)
+
+    def test_extrapolates_at_recent_speed(self):
+        for i in range(5):
+            self.observe(i * 100_000, 1000 + i * 100)  # 1000 ticks/s
+        self.assertEqual(self.clock.tick_at(100.5), 1500)
+        self.assertIsNone(self.clock.tick_at(101.0))  # Too far past the newest sample
+
+    def test_tick_wrap(self):
+        self.observe(0, BeltClock.WRAP - 50)
+        self.observe(100_000, 50)
+        self.assertEqual(self.clock.tick_at(100.05), 0)
+        self.assertEqual(self.clock.tick_at(100.025), BeltClock.WRAP - 25)
+
+
+if __name__ == '__main__':
+    unittest.main()
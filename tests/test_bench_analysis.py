@@ -0,0 +1,73 @@
+import unittest
+
+from bench.analysis import part_timings, percentile, summarize
+
+
+def sim_log(*parts):
+    """Simulator events for parts given as (edge tick, edge, gate, schedule or None, action or None) times."""
+    events = []
+    for part, (tick, edge, gate, schedule, action) in enumerate(parts):
+        events.append({"event": "edge", "part": part, "state": 1, "tick": tick, "time": edge})
+        events.append({"event": "gate", "part": part, "time": gate})
+        if schedule is not None:
+            events.append({"event": "schedule", "detection_tick": tick, "time": schedule})
+        if action is not None:
+            events.append({"event": "action", "time": action})
+    return sorted(events, key=lambda event: event["time"])
+
+
+class TestPercentile(unittest.TestCase):
+    def test_interpolates_between_ranks(self):
+        self.assertEqual(percentile([3.0, 1.0, 2.0], 0.5), 2.0)
+        self.assertEqual(percentile([1.0, 2.0], 0.5), 1.5)
+        self.assertAlmostEqual(percentile(list(range(101)), 0.99), 99.0)
+        self.assertEqual(percentile([4.0], 0.99), 4.0)
+
+
+class TestPartTimings(unittest.TestCase):
+    def test_stages_of_an_on_time_part(self):
+        events = sim_log((1000, 10.0, 11.0, 10.3, 11.01))
+        timing, = part_timings(events, {1000: 10.05}, {1000: 10.25})
+        self.assertTrue(timing.on_time)
+        self.assertAlmostEqual(timing.stages["uplink"], 0.05)
+        self.assertAlmostEqual(timing.stages["decision"], 0.2)
+        self.assertAlmostEqual(timing.stages["downlink"], 0.05)
+        self.assertAlmostEqual(timing.stages["slack"], 0.7)
+        self.assertAlmostEqual(timing.stages["actuation"], 0.01)
+        self.assertAlmostEqual(timing.stages["total"], 1.01)
+
+    def test_late_and_unsorted_parts(self):
+        events = sim_log((1000, 10.0, 11.0, 11.2, 11.21),  # Scheduled after it passed the gate
+                         (2000, 12.0, 13.0, None, None))   # Never classified
+        late, missed = part_timings(events, {1000: 10.05, 2000: 12.05}, {1000: 11.15})
+        self.assertFalse(late.on_time)
+        self.assertAlmostEqual(late.stages["slack"], -0.2)
+        self.assertAlmostEqual(late.stages["actuation"], 0.21)
+        self.assertFalse(missed.on_time)
+        self.assertIsNone(missed.stages["decision"])
+        self.assertIsNone(missed.stages["total"])
+
+    def test_actions_are_matched_in_gate_order(self):
+        # Both parts are scheduled before the first one reaches the gate.
+        events = sim_log((1000, 10.0, 11.0, 10.2, 11.01),
+                         (1500, 10.5, 11.5, 10.7, 11.51))
+        first, second = part_timings(events, {}, {})
+        self.assertAlmostEqual(first.stages["actuation"], 0.01)
+        self.assertAlmostEqual(second.stages["actuation"], 0.01)
+
+
+class TestSummarize(unittest.TestCase):
+    def test_counts_and_percentiles_in_milliseconds(self):
+        events = sim_log((1000, 10.0, 11.0, 10.3, 11.01),
+                         (2000, 12.0, 13.0, None, None))
+        summary = summarize(part_timings(events, {1000: 10.05, 2000: 12.1}, {1000: 10.25}))
+        self.assertEqual(summary["parts"], 2)
+        self.assertEqual(summary["on_time"], 1)
+        self.assertEqual(summary["stages"]["uplink"]["count"], 2)
+        self.assertAlmostEqual(summary["stages"]["uplink"]["p50_ms"], 75.0)
+        self.assertEqual(summary["stages"]["decision"]["count"], 1)
+        self.assertIsNotNone(summary["stages"]["total"]["p99_ms"])
+
+
+if __name__ == '__main__':
+    unittest.main()
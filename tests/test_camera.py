@@ -1,3 +1,5 @@
+import threading
+import time
 import unittest
 import cv2
 import numpy as np
@@ -76,6 +78,36 @@ class TestCamera(unittest.TestCase):
         mock_cap_instance.release.assert_called_once()
         self.assertIsNone(camera.cap)
 
+    @patch('cv2.VideoCapture')
+    def test_threaded_read_returns_newest_frame_once(self, mock_video_capture):
+        mock_cap_instance = MagicMock()
+        mock_video_capture.return_value = mock_cap_instance
+        mock_cap_instance.isOpened.return_value = True
+        mock_cap_instance.get.return_value = 0.0
+        frames = [np.full((4, 4, 3), i, dtype=np.uint8) for i in range(3)]
+        captured = threading.Event()
+
+        def read(image=None):
+            if frames:
+                return True, frames.pop(0)
+            captured.set()
+            time.sleep(0.001)
+            return False, None
+        mock_cap_instance.read.side_effect = read
+
+        camera = Camera(camera_index=0, resolution=(640, 480), threaded=True)
+        camera.initialize()
+        self.assertTrue(captured.wait(1.0))
+        frame, frame_time = camera.read_frame_with_timestamp()
+        second = camera.read_frame()
+        camera.release()
+
+        self.assertEqual(frame[0, 0, 0], 2)  # Older frames were skipped
+        self.assertIsNotNone(frame_time)
+        self.assertIsNone(second)
+        self.assertEqual(camera.dropped_frames, 2)
+        mock_cap_instance.set.assert_any_call(cv2.CAP_PROP_BUFFERSIZE, 1)
+
     def test_read_frame_not_initialized(self):
         camera = Camera(camera_index=0, resolution=(640, 480))
         with self.assertRaises(IOError) as cm:
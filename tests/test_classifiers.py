@@ -2,8 +2,10 @@ import unittest
 from unittest.mock import patch, MagicMock
 import numpy as np
 import cv2
-from src.vision.classifiers import ColorClassifier, ShapeClassifier, SizeClassifier, ServoCode
+from src.vision.classifiers import (BaseClassifier, Classification, ColorClassifier, CompositeClassifier,
+                                   ShapeClassifier, SizeClassifier, ServoCode)
 from src.config.config import AppConfig
+from src.vision.features import DeviceFrameFeatures
 
 class TestColorClassifier(unittest.TestCase):
 
@@ -13,114 +15,54 @@ class TestColorClassifier(unittest.TestCase):
         # Create a dummy frame for testing
         self.dummy_frame = np.zeros((100, 100, 3), dtype=np.uint8)
 
-    @patch('cv2.cvtColor')
-    @patch('cv2.inRange')
-    @patch('cv2.morphologyEx')
-    @patch('cv2.countNonZero')
-    @patch('cv2.bitwise_or')
-    @patch('cv2.findContours')
-    @patch('cv2.contourArea')
-    @patch('cv2.boundingRect')
-    @patch('cv2.rectangle')
-    @patch('cv2.putText')
-    def test_classify_red(self, mock_putText, mock_rectangle, mock_boundingRect, mock_contourArea, mock_findContours, mock_bitwise_or, mock_countNonZero, mock_morphologyEx, mock_inRange, mock_cvtColor):
-        # Mock return values to simulate red detection
-        mock_cvtColor.return_value = self.dummy_frame # HSV frame
-        mock_inRange.side_effect = [MagicMock(), MagicMock(), MagicMock()] # Red, Yellow, Green masks
-        mock_morphologyEx.side_effect = [MagicMock(), MagicMock(), MagicMock(), MagicMock()] # Open ops
-        mock_countNonZero.side_effect = [1000, 100, 50] # Red > Yellow, Green
-        mock_bitwise_or.side_effect = [MagicMock(), MagicMock()] # Combined masks
-        mock_findContours.return_value = ([MagicMock()], MagicMock()) # Contours
-        mock_contourArea.return_value = 300 # Area above threshold
-        mock_boundingRect.return_value = (10, 10, 50, 50) # Bounding box
-
-        servo_code, processed_frame = self.classifier.classify(self.dummy_frame)
+    def _classify_square(self, bgr):
+        frame = self.dummy_frame.copy()
+        frame[30:70, 30:70] = bgr
+        return self.classifier.classify(frame)
 
+    def test_classify_red(self):
+        servo_code, processed_frame, name = self._classify_square((0, 0, 255))
         self.assertEqual(servo_code, ServoCode.RED)
-        mock_putText.assert_called_once()
-        mock_rectangle.assert_called_once()
-
-    @patch('cv2.cvtColor')
-    @patch('cv2.inRange')
-    @patch('cv2.morphologyEx')
-    @patch('cv2.countNonZero')
-    @patch('cv2.bitwise_or')
-    @patch('cv2.findContours')
-    @patch('cv2.contourArea')
-    @patch('cv2.boundingRect')
-    @patch('cv2.rectangle')
-    @patch('cv2.putText')
-    def test_classify_yellow(self, mock_putText, mock_rectangle, mock_boundingRect, mock_contourArea, mock_findContours, mock_bitwise_or, mock_countNonZero, mock_morphologyEx, mock_inRange, mock_cvtColor):
-        # Mock return values to simulate yellow detection
-        mock_cvtColor.return_value = self.dummy_frame
-        mock_inRange.side_effect = [MagicMock(), MagicMock(), MagicMock()]
-        mock_morphologyEx.side_effect = [MagicMock(), MagicMock(), MagicMock(), MagicMock()]
-        mock_countNonZero.side_effect = [100, 1000, 50] # Yellow > Red, Green
-        mock_bitwise_or.side_effect = [MagicMock(), MagicMock()]
-        mock_findContours.return_value = ([MagicMock()], MagicMock())
-        mock_contourArea.return_value = 300
-        mock_boundingRect.return_value = (10, 10, 50, 50)
-
-        servo_code, processed_frame = self.classifier.classify(self.dummy_frame)
+        self.assertEqual(name, "Red")
+        self.assertEqual(tuple(processed_frame[30, 30]), (0, 0, 255))  # Bounding box
 
+    def test_classify_yellow(self):
+        servo_code, _, name = self._classify_square((0, 255, 255))
         self.assertEqual(servo_code, ServoCode.YELLOW)
-        mock_putText.assert_called_once()
-        mock_rectangle.assert_called_once()
-
-    @patch('cv2.cvtColor')
-    @patch('cv2.inRange')
-    @patch('cv2.morphologyEx')
-    @patch('cv2.countNonZero')
-    @patch('cv2.bitwise_or')
-    @patch('cv2.findContours')
-    @patch('cv2.contourArea')
-    @patch('cv2.boundingRect')
-    @patch('cv2.rectangle')
-    @patch('cv2.putText')
-    def test_classify_green(self, mock_putText, mock_rectangle, mock_boundingRect, mock_contourArea, mock_findContours, mock_bitwise_or, mock_countNonZero, mock_morphologyEx, mock_inRange, mock_cvtColor):
-        # Mock return values to simulate green detection
-        mock_cvtColor.return_value = self.dummy_frame
-        mock_inRange.side_effect = [MagicMock(), MagicMock(), MagicMock()]
-        mock_morphologyEx.side_effect = [MagicMock(), MagicMock(), MagicMock(), MagicMock()]
-        mock_countNonZero.side_effect = [50, 100, 1000] # Green > Red, Yellow
-        mock_bitwise_or.side_effect = [MagicMock(), MagicMock()]
-        mock_findContours.return_value = ([MagicMock()], MagicMock())
-        mock_contourArea.return_value = 300
-        mock_boundingRect.return_value = (10, 10, 50, 50)
-
-        servo_code, processed_frame = self.classifier.classify(self.dummy_frame)
+        self.assertEqual(name, "Yellow")
 
+    def test_classify_green(self):
+        servo_code, _, name = self._classify_square((0, 255, 0))
         self.assertEqual(servo_code, ServoCode.GREEN)
-        mock_putText.assert_called_once()
-        mock_rectangle.assert_called_once()
+        self.assertEqual(name, "Green")
 
-    @patch('cv2.cvtColor')
-    @patch('cv2.inRange')
-    @patch('cv2.morphologyEx')
-    @patch('cv2.countNonZero')
-    @patch('cv2.bitwise_or')
-    @patch('cv2.findContours')
-    @patch('cv2.contourArea')
-    @patch('cv2.boundingRect')
     @patch('cv2.rectangle')
     @patch('cv2.putText')
-    def test_classify_unknown_color(self, mock_putText, mock_rectangle, mock_boundingRect, mock_contourArea, mock_findContours, mock_bitwise_or, mock_countNonZero, mock_morphologyEx, mock_inRange, mock_cvtColor):
-        # Mock return values to simulate no dominant color
-        mock_cvtColor.return_value = self.dummy_frame
-        mock_inRange.side_effect = [MagicMock(), MagicMock(), MagicMock()]
-        mock_morphologyEx.side_effect = [MagicMock(), MagicMock(), MagicMock(), MagicMock()]
-        mock_countNonZero.side_effect = [0, 0, 0] # No color detected
-        mock_bitwise_or.side_effect = [MagicMock(), MagicMock()]
-        mock_findContours.return_value = ([MagicMock()], MagicMock())
-        mock_contourArea.return_value = 0 # No significant contour
-        mock_boundingRect.return_value = (0, 0, 0, 0)
-
-        servo_code, processed_frame = self.classifier.classify(self.dummy_frame)
+    def test_classify_unknown_color(self, mock_putText, mock_rectangle):
+        servo_code, _, name = self.classifier.classify(self.dummy_frame)
 
         self.assertEqual(servo_code, ServoCode.UNKNOWN)
+        self.assertEqual(name, "Unknown")
         mock_putText.assert_called_once()
         mock_rectangle.assert_not_called()
 
+    def test_speckles_do_not_vote(self):
+        frame = self.dummy_frame.copy()
+        frame[30:70, 30:70] = (0, 255, 0)
+        frame[::4, ::4] = (0, 0, 255)  # Isolated red pixels, removed by the opening
+        servo_code, _, _ = self.classifier.classify(frame)
+        self.assertEqual(servo_code, ServoCode.GREEN)
+
+    def test_device_features_give_the_same_result(self):
+        frame = self.dummy_frame.copy()
+        frame[30:70, 30:70] = (0, 255, 255)
+        frame[::4, ::4] = (0, 0, 255)
+        result = self.classifier.analyze(frame, DeviceFrameFeatures(frame))
+        self.assertEqual((result.servo_code, result.name), (ServoCode.YELLOW, "Yellow"))
+        canvas = frame.copy()
+        result.draw(canvas)
+        self.assertEqual(tuple(canvas[30, 30]), (0, 255, 255))  # Bounding box
+
 class TestShapeClassifier(unittest.TestCase):
 
     def setUp(self):
@@ -368,5 +310,44 @@ class TestSizeClassifier(unittest.TestCase):
         self.assertEqual(servo_code, ServoCode.UNKNOWN)
         mock_putText.assert_called_once_with(processed_frame, "Calibrate first!", (50, 50), self.config.OPENCV_FONT, 1, (0, 0, 255), 2, cv2.LINE_AA)
 
+class FixedClassifier(BaseClassifier):
+    """Returns a fixed category and marks one pixel."""
+    def __init__(self, config, category, pixel):
+        super().__init__(config)
+        self.category = category
+        self.pixel = pixel
+
+    def analyze(self, frame, features):
+        def draw(processed_frame):
+            processed_frame[self.pixel] = 255
+        code = ServoCode.UNKNOWN if self.category is None else ServoCode.RED
+        return Classification(code, self.category or "Unknown", self.category, draw)
+
+class TestCompositeClassifier(unittest.TestCase):
+
+    def setUp(self):
+        self.config = AppConfig()
+        self.dummy_frame = np.zeros((10, 10, 3), dtype=np.uint8)
+
+    def test_combines_categories(self):
+        classifier = CompositeClassifier(self.config, [FixedClassifier(self.config, "Red", (1, 1)),
+                                                       FixedClassifier(self.config, "Circle", (2, 2))])
+        servo_code, processed_frame, name = classifier.classify(self.dummy_frame)
+        classifier.close()
+
+        self.assertEqual(servo_code, ServoCode(str(self.config.COMPOSITE_CLASS_CODES[("Red", "Circle")])))
+        self.assertEqual(name, "Red / Circle")
+        self.assertTrue(processed_frame[1, 1].all() and processed_frame[2, 2].all())
+        self.assertFalse(self.dummy_frame.any())
+
+    def test_unknown_if_any_part_is_unknown(self):
+        classifier = CompositeClassifier(self.config, [FixedClassifier(self.config, "Red", (1, 1)),
+                                                       FixedClassifier(self.config, None, (2, 2))])
+        servo_code, _, name = classifier.classify(self.dummy_frame)
+        classifier.close()
+
+        self.assertEqual(servo_code, ServoCode.UNKNOWN)
+        self.assertEqual(name, "Red / Unknown")
+
 if __name__ == '__main__':
     unittest.main()
\ No newline at end of file
@@ -0,0 +1,43 @@
+import unittest
+import numpy as np
+import cv2
+from src.vision import color_kernel
+from src.vision.color_kernel import label_colors
+
+RANGES = [((0, 120, 70), (10, 255, 255)), ((20, 100, 100), (30, 255, 255)), ((0, 0, 0), (179, 255, 255))]
+
+class TestColorKernel(unittest.TestCase):
+
+    def _reference(self, frame):
+        hsv = cv2.cvtColor(frame, cv2.COLOR_BGR2HSV)
+        labels = np.zeros(frame.shape[:2], np.uint8)
+        for index in range(len(RANGES), 0, -1):
+            lower, upper = RANGES[index - 1]
+            labels[cv2.inRange(hsv, np.array(lower), np.array(upper)) > 0] = index
+        return labels
+
+    def test_matches_opencv_on_every_color(self):
+        rng = np.random.default_rng(1)
+        frame = rng.integers(0, 256, (64, 256, 3), dtype=np.uint8)
+        labels, mask, counts = label_colors(frame, RANGES)
+        expected = self._reference(frame)
+        np.testing.assert_array_equal(labels, expected)
+        np.testing.assert_array_equal(mask, np.where(expected > 0, 255, 0))
+        self.assertEqual(counts, np.bincount(expected.ravel(), minlength=4)[1:].tolist())
+
+    def test_first_range_wins_and_buffers_are_reused(self):
+        frame = np.zeros((2, 2, 3), np.uint8)
+        frame[0, 0] = (0, 0, 255)  # Red, also inside the catch-all third range
+        labels = np.empty((2, 2), np.uint8)
+        result, _, counts = label_colors(frame, RANGES, labels)
+        self.assertIs(result, labels)
+        self.assertEqual(labels[0, 0], 1)
+        self.assertEqual(counts, [1, 0, 3])
+
+    @unittest.skipUnless(color_kernel.NATIVE_AVAILABLE, "native kernel not built")
+    def test_native_rejects_too_many_ranges(self):
+        with self.assertRaises(ValueError):
+            label_colors(np.zeros((1, 1, 3), np.uint8), RANGES * 3)
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,67 @@
+import threading
+import unittest
+from collections import deque
+
+from src.hardware.device_clock import DeviceClock
+
+class TestDeviceClock(unittest.TestCase):
+
+    def test_not_synchronized(self):
+        clock = DeviceClock()
+        self.assertFalse(clock.synchronized)
+        self.assertIsNone(clock.to_host_time(1000))
+
+    def test_offset_uses_least_delayed_sample(self):
+        clock = DeviceClock()
+        clock.observe(1_000_000, 101.020)  # 20 ms USB latency
+        clock.observe(2_000_000, 102.001)  # 1 ms USB latency
+        clock.observe(3_000_000, 103.050)
+        self.assertAlmostEqual(clock.to_host_time(2_500_000), 102.501)
+
+    def test_window_expires_old_offsets(self):
+        clock = DeviceClock(window_seconds=1.0)
+        clock.observe(1_000_000, 101.000)
+        clock.observe(5_000_000, 105.010)
+        self.assertAlmostEqual(clock.to_host_time(5_000_000), 105.010)
+
+    def test_unwrap(self):
+        clock = DeviceClock()
+        clock.observe(DeviceClock.WRAP_US - 1_000_000, 10.0)
+        clock.observe(1_000_000, 12.0)
+        self.assertEqual(clock.unwrap(2_000_000), DeviceClock.WRAP_US + 2_000_000)
+        self.assertAlmostEqual(clock.to_host_time(DeviceClock.WRAP_US - 500_000), 10.5)
+
+    def test_to_device_time(self):
+        clock = DeviceClock()
+        self.assertIsNone(clock.to_device_time(5.0))
+        clock.observe(1_000_000, 101.0)
+        self.assertAlmostEqual(clock.to_device_time(101.5), 1_500_000)
+        self.assertAlmostEqual(clock.to_host_time(int(clock.to_device_time(100.25))), 100.25)
+
+    def test_converts_while_another_thread_observes(self):
+        clock = DeviceClock()
+        clock.observe(0, 100.0)
+        results = []
+
+        def convert():
+            try:
+                results.append(clock.to_host_time(1000))
+            except Exception as e:
+                results.append(e)
+
+        class Offsets(deque):
+            """Converts on another thread in the middle of observe(), after the only offset was popped."""
+            def append(self, item):
+                reader.start()
+                reader.join(0.2)
+                super().append(item)
+
+        reader = threading.Thread(target=convert)
+        clock._offsets = Offsets(clock._offsets)
+        clock.observe(1000, 100.0)  # Less delayed, so it replaces the one offset
+        reader.join()
+        self.assertEqual(len(results), 1)
+        self.assertAlmostEqual(results[0], 100.0)
+
+if __name__ == '__main__':
+    unittest.main()
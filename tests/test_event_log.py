@@ -0,0 +1,95 @@
+import math
+import os
+import struct
+import tempfile
+import unittest
+
+from src.core.event_log import (HEADER_FORMAT, STREAMS, TELEMETRY_FLAG_DEVICE_TIME, TELEMETRY_FLAG_OBSTACLE,
+                                TELEMETRY_FLAG_PWM, UNKNOWN, EventLog, load_stream, read_records, stream_dtype)
+from src.hardware.protocol import ActionEvent, ActionStatus, ObstacleEvent, TelemetrySample
+
+
+class TestEventLog(unittest.TestCase):
+    def setUp(self):
+        self.directory = tempfile.TemporaryDirectory()
+        self.addCleanup(self.directory.cleanup)
+        self.log = EventLog(self.directory.name, flush_interval=0.01, fsync_interval=0.05)
+        self.log.start()
+
+    def path(self, stream):
+        return os.path.join(self.directory.name, stream + ".bin")
+
+    def test_streams_records_to_their_files(self):
+        self.log.log_telemetry(10.0, TelemetrySample(1000, 120, 1, 200, True, 5000))
+        self.log.log_telemetry(10.1, TelemetrySample(None, 80, 0, None, None, None))  # ASCII protocol
+        self.log.log_edge(ObstacleEvent(2000, 5100, 1, None), 10.2)
+        self.log.log_decision(7, 1, 6, 5, 10.2, 10.4, 5100, 3)
+        self.log.log_decision(None, 9, 2, 1, None, None, None, None)
+        self.log.log_action(ActionEvent(3, 1, ActionStatus.LATE, 6060), 11.0)
+        self.log.stop()
+
+        binary, ascii_sample = read_records(self.path("telemetry"))
+        self.assertEqual((binary.host_time, binary.device_us, binary.tick, binary.rpm, binary.pwm),
+                         (10.0, 1000, 5000, 120, 200))
+        self.assertTrue(binary.flags & TELEMETRY_FLAG_OBSTACLE)
+        self.assertTrue(binary.flags & TELEMETRY_FLAG_DEVICE_TIME and binary.flags & TELEMETRY_FLAG_PWM)
+        self.assertEqual((ascii_sample.device_us, ascii_sample.tick, ascii_sample.flags), (UNKNOWN, UNKNOWN, 0))
+
+        edge, = read_records(self.path("edges"))
+        self.assertEqual((edge.host_time, edge.tick, edge.state), (10.2, 5100, 1))
+
+        scheduled, immediate = read_records(self.path("decisions"))
+        self.assertEqual((scheduled.track_id, scheduled.class_code, scheduled.votes, scheduled.leader_votes,
+                          scheduled.trigger_time, scheduled.frame_time, scheduled.detection_tick,
+                          scheduled.part_id), (7, 1, 6, 5, 10.2, 10.4, 5100, 3))
+        self.assertEqual((immediate.track_id, immediate.detection_tick, immediate.part_id),
+                         (UNKNOWN, UNKNOWN, 0xFFFF))
+        self.assertTrue(math.isnan(immediate.trigger_time))
+
+        action, = read_records(self.path("actions"))
+        self.assertEqual((action.part_id, action.status, action.tick), (3, ActionStatus.LATE, 6060))
+
+    def test_appends_to_an_existing_log(self):
+        self.log.log_edge(ObstacleEvent(1, 1, 1, 1.0), 1.0)
+        self.log.stop()
+        self.log.start()
+        self.log.log_edge(ObstacleEvent(2, 2, 0, 2.0), 2.0)
+        self.log.stop()
+        with open(self.path("edges"), "rb") as log:
+            self.assertEqual(log.read(HEADER_FORMAT.size)[:7], b"BANDACV")
+            self.assertNotIn(b"BANDACV", log.read())
+        self.assertEqual([edge.tick for edge in read_records(self.path("edges"))], [1, 2])
+
+    def test_drops_what_the_writer_cannot_keep_up_with(self):
+        self.log.stop()
+        log = EventLog(self.directory.name, max_pending=2)
+        for tick in range(5):
+            log.log_edge(ObstacleEvent(tick, tick, 1, 1.0), 1.0)
+        log.log_telemetry(1.0, TelemetrySample(1, 70000, 0, 0, False, 1))  # rpm does not fit
+        self.assertEqual(log.dropped_records, 4)
+        log.start()
+        log.stop()
+        self.assertEqual([edge.tick for edge in read_records(self.path("edges"))], [0, 1])
+
+    def test_a_torn_record_is_ignored(self):
+        self.log.log_edge(ObstacleEvent(1, 1, 1, 1.0), 1.0)
+        self.log.stop()
+        with open(self.path("edges"), "ab") as log:
+            log.write(b"\x01\x02\x03")
+        self.assertEqual(len(read_records(self.path("edges"))), 1)
+        self.assertEqual(len(load_stream(self.path("edges"))), 1)
+
+    def test_memory_maps_like_the_struct_layout(self):
+        for name, (record_format, _) in STREAMS.items():
+            self.assertEqual(stream_dtype(name).itemsize, struct.calcsize(record_format), name)
+        self.log.log_telemetry(10.0, TelemetrySample(1000, 120, 1, 200, True, 5000))
+        self.log.log_telemetry(10.5, TelemetrySample(2000, 130, 0, 210, True, 5050))
+        self.log.stop()
+        telemetry = load_stream(self.path("telemetry"))
+        self.assertEqual(telemetry["rpm"].tolist(), [120, 130])
+        self.assertEqual(telemetry["tick"].tolist(), [5000, 5050])
+        self.assertEqual(telemetry["host_time"].tolist(), [10.0, 10.5])
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,68 @@
+import threading
+import unittest
+from unittest.mock import patch
+import numpy as np
+import cv2
+from src.vision.features import DeviceFrameFeatures, FrameFeatures, to_host
+
+class TestFrameFeatures(unittest.TestCase):
+
+    def setUp(self):
+        self.frame = np.zeros((100, 100, 3), dtype=np.uint8)
+        self.frame[30:70, 30:70] = (255, 255, 255)
+
+    def test_features_are_computed_once(self):
+        features = FrameFeatures(self.frame)
+        with patch('cv2.cvtColor', wraps=cv2.cvtColor) as mock_cvtColor:
+            features.blurred
+            features.edges
+            features.gray
+            mock_cvtColor.assert_called_once()
+        self.assertIs(features.edge_contours, features.edge_contours)
+
+    def test_nothing_is_computed_up_front(self):
+        with patch('cv2.cvtColor') as mock_cvtColor:
+            FrameFeatures(self.frame)
+            mock_cvtColor.assert_not_called()
+
+    def test_frames_are_computed_in_parallel(self):
+        # While one thread converts a frame, another must not wait to convert a different one.
+        first, second = FrameFeatures(self.frame), FrameFeatures(self.frame.copy())
+        started, release = threading.Event(), threading.Event()
+
+        def convert(frame, code):
+            if frame is first.frame:
+                started.set()
+                release.wait(5)
+            return frame[..., 0]
+
+        with patch('cv2.cvtColor', side_effect=convert):
+            worker = threading.Thread(target=lambda: first.gray)
+            worker.start()
+            self.assertTrue(started.wait(5))
+            done = threading.Thread(target=lambda: second.gray)
+            done.start()
+            done.join(1)
+            finished = not done.is_alive()
+            release.set()
+            worker.join()
+            done.join()
+        self.assertTrue(finished)
+
+    def test_edge_contours_find_the_square(self):
+        contours = FrameFeatures(self.frame).edge_contours
+        self.assertEqual(len(contours), 1)
+        self.assertEqual(cv2.boundingRect(contours[0])[2:], (40, 40))
+
+    def test_device_features_match_the_cpu_ones(self):
+        # UMat runs on the CPU without an OpenCL device, so this holds either way.
+        cpu, device = FrameFeatures(self.frame), DeviceFrameFeatures(self.frame)
+        self.assertIsInstance(device.edges, cv2.UMat)
+        np.testing.assert_array_equal(to_host(device.edges), cpu.edges)
+        np.testing.assert_array_equal(to_host(device.hsv), cpu.hsv)
+        self.assertEqual([cv2.boundingRect(c) for c in device.edge_contours],
+                         [cv2.boundingRect(c) for c in cpu.edge_contours])
+        self.assertIs(to_host(cpu.gray), cpu.gray)
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,131 @@
+import os
+import tempfile
+import time
+import tty
+import unittest
+from pathlib import Path
+
+from bench.firmware_sim import FirmwareSim, find_compiler
+from src.hardware.protocol import (HELLO_ACK_FORMAT, PROTOCOL_VERSION, SERVO_CODE_KEEP, ActionStatus, FrameParser, FrameType,
+                                   decode_action_event, decode_capabilities, decode_obstacle_event,
+                                   decode_telemetry, encode_frame, encode_schedule)
+
+
+@unittest.skipIf(find_compiler() is None, "No C++ compiler to build the firmware simulator")
+class TestFirmwareSim(unittest.TestCase):
+    """Drives the simulated firmware over its pty like the host does."""
+    def setUp(self):
+        self.log_dir = tempfile.TemporaryDirectory()
+        self.addCleanup(self.log_dir.cleanup)
+
+    def start_sim(self, **options):
+        self.sim = FirmwareSim(Path(self.log_dir.name) / "sim.jsonl", **options)
+        port = self.sim.start()
+        self.addCleanup(self.sim.stop)
+        self.fd = os.open(port, os.O_RDWR | os.O_NOCTTY | os.O_NONBLOCK)
+        self.addCleanup(os.close, self.fd)
+        tty.setraw(self.fd)
+
+    def read_frames(self, parser):
+        try:
+            data = os.read(self.fd, 4096)
+        except BlockingIOError:
+            data = b""
+        return parser.feed(data)
+
+    def test_schedules_every_part_on_time(self):
+        self.start_sim(parts=3, interval_ms=400, part_length_ticks=80, start_ms=200, tail_ms=300)
+        os.write(self.fd, encode_frame(FrameType.HELLO, bytes([PROTOCOL_VERSION, 0])))
+        parser = FrameParser()
+        frame_types, edge_ticks, action_statuses = set(), [], []
+        deadline = time.time() + 20
+        last_command = 0.0
+        while self.sim.running and time.time() < deadline:
+            if time.time() - last_command > 0.5:  # Heartbeat, full speed
+                os.write(self.fd, encode_frame(FrameType.COMMAND, bytes([255, SERVO_CODE_KEEP])))
+                last_command = time.time()
+            for frame_type, payload in self.read_frames(parser):
+                frame_types.add(frame_type)
+                if frame_type == FrameType.OBSTACLE_EVENT:
+                    event = decode_obstacle_event(payload)
+                    if event.state == 1:
+                        edge_ticks.append(event.tick)
+                        os.write(self.fd, encode_schedule(len(edge_ticks), 1, event.tick))
+                elif frame_type == FrameType.ACTION_EVENT:
+                    action_statuses.append(decode_action_event(payload).status)
+            time.sleep(0.002)
+        self.assertEqual(self.sim.wait(5), 0)
+
+        self.assertIn(FrameType.HELLO_ACK, frame_types)
+        self.assertEqual(action_statuses, [ActionStatus.ON_TIME] * 3)
+        # The firmware reports the same edge ticks the simulator logged.
+        self.assertEqual(edge_ticks, [event["tick"] for event in self.sim.events("edge") if event["state"] == 1])
+        self.assertEqual([event["detection_tick"] for event in self.sim.events("schedule")], edge_ticks)
+        self.assertEqual(len(self.sim.events("gate")), 3)
+        self.assertEqual(len(self.sim.events("action")), 3)
+
+    def test_reports_its_device_id(self):
+        device_ids = []
+        for device_serial in (1, 2):
+            self.start_sim(parts=0, duration_s=3, device_serial=device_serial)
+            os.write(self.fd, encode_frame(FrameType.QUERY_CAPS, bytes([PROTOCOL_VERSION])))
+            os.write(self.fd, encode_frame(FrameType.HELLO, bytes([PROTOCOL_VERSION, 0])))
+            parser = FrameParser()
+            answers = {}
+            deadline = time.time() + 5
+            while len(answers) < 2 and time.time() < deadline:
+                for frame_type, payload in self.read_frames(parser):
+                    if frame_type == FrameType.CAPS:
+                        answers[frame_type] = decode_capabilities(payload).device_id
+                    elif frame_type == FrameType.HELLO_ACK:
+                        answers[frame_type] = HELLO_ACK_FORMAT.unpack(payload)[2]
+                time.sleep(0.002)
+            self.assertEqual(len(answers), 2)
+            self.assertEqual(answers[FrameType.CAPS], answers[FrameType.HELLO_ACK])
+            device_ids.append(answers[FrameType.CAPS])
+        self.assertNotEqual(device_ids[0], device_ids[1])
+
+    def test_queued_moves_survive_a_host_outage(self):
+        self.start_sim(parts=0, duration_s=8)
+        os.write(self.fd, encode_frame(FrameType.HELLO, bytes([PROTOCOL_VERSION, 0])))
+        os.write(self.fd, encode_frame(FrameType.COMMAND, bytes([255, SERVO_CODE_KEEP])))
+        parser = FrameParser()
+        deadline = time.time() + 5
+        tick = None
+        while tick is None and time.time() < deadline:
+            for frame_type, payload in self.read_frames(parser):
+                if frame_type == FrameType.TELEMETRY and decode_telemetry(payload).rpm > 0:
+                    tick = decode_telemetry(payload).tick
+            time.sleep(0.002)
+        self.assertIsNotNone(tick)
+
+        # Due about 3 s from now at full speed, well after the 2 s heartbeat timeout; then the host goes quiet.
+        os.write(self.fd, encode_schedule(7, 1, tick + 3 * 1600 - 960))
+        last_write = time.time()
+        action = None
+        while action is None and time.time() < last_write + 6:
+            for frame_type, payload in self.read_frames(parser):
+                if frame_type == FrameType.ACTION_EVENT:
+                    action = decode_action_event(payload)
+            time.sleep(0.002)
+        self.assertIsNotNone(action)
+        self.assertEqual((action.part_id, action.status), (7, ActionStatus.ON_TIME))
+        self.assertGreater(time.time() - last_write, 2.0)
+
+        # A host that comes back picks the binary session up where it was.
+        os.write(self.fd, encode_frame(FrameType.QUERY_CAPS, bytes([PROTOCOL_VERSION])))
+        caps = None
+        deadline = time.time() + 1
+        while caps is None and time.time() < deadline:
+            for frame_type, payload in self.read_frames(parser):
+                if frame_type == FrameType.CAPS:
+                    caps = decode_capabilities(payload)
+            time.sleep(0.002)
+        self.assertIsNotNone(caps)
+        self.assertEqual(caps.version, PROTOCOL_VERSION)
+        self.assertTrue(caps.binary and caps.stay_alive and caps.link_lost)
+        self.assertEqual(caps.pending_actions, 0)
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -36,5 +36,32 @@ class TestImageProcessor(unittest.TestCase):
         self.assertEqual(servo_code, ServoCode.UNKNOWN)
         np.testing.assert_array_equal(processed_frame, self.dummy_frame)
 
+    def test_roi_is_a_view(self):
+        self.image_processor.set_roi((10, 20, 30, 40))
+        roi_frame = self.image_processor.preprocess_frame(self.dummy_frame)
+
+        self.assertEqual(roi_frame.shape, (40, 30, 3))
+        self.assertTrue(np.shares_memory(roi_frame, self.dummy_frame))
+
+    def test_roi_annotations_are_mapped_back(self):
+        class MarkCorner(BaseClassifier):
+            def classify(self, frame):
+                annotated = frame.copy()
+                annotated[5, 5] = (0, 0, 255)
+                return ServoCode.RED, annotated, "Red"
+
+        self.image_processor.set_roi((10, 20, 30, 40))
+        servo_code, processed_frame, name = self.image_processor.process_frame(self.dummy_frame, MarkCorner(self.config))
+
+        self.assertEqual(servo_code, ServoCode.RED)
+        self.assertEqual(processed_frame.shape, self.dummy_frame.shape)
+        self.assertEqual(tuple(processed_frame[25, 15]), (0, 0, 255))
+        self.assertEqual(tuple(processed_frame[20, 10]), self.config.ROI_OUTLINE_COLOR)
+        self.assertFalse(self.dummy_frame.any())  # The input frame is not drawn on
+
+    def test_invalid_roi(self):
+        with self.assertRaises(ValueError):
+            self.image_processor.set_roi((0, 0, 0, 10))
+
 if __name__ == '__main__':
     unittest.main()
@@ -0,0 +1,77 @@
+import threading
+import unittest
+import urllib.error
+import urllib.request
+
+from src.core.metrics import Counter, Histogram, MetricsRegistry, MetricsServer, label_families, render
+
+
+class TestMetrics(unittest.TestCase):
+    def test_counts_from_many_threads(self):
+        counter = Counter()
+        threads = [threading.Thread(target=lambda: [counter.inc() for _ in range(10000)]) for _ in range(4)]
+        for thread in threads:
+            thread.start()
+        for thread in threads:
+            thread.join()
+        counter.inc(5)
+        self.assertEqual(counter.value, 40005)
+
+    def test_histogram_buckets_are_cumulative(self):
+        histogram = Histogram((0.1, 1.0))
+        for value in (0.05, 0.1, 0.5, 3.0):
+            histogram.observe(value)
+        samples = {(name, labels): value for name, labels, value in histogram.samples("latency", ())}
+        self.assertEqual(samples[("latency_bucket", (("le", "0.1"),))], 2)
+        self.assertEqual(samples[("latency_bucket", (("le", "1"),))], 3)
+        self.assertEqual(samples[("latency_bucket", (("le", "+Inf"),))], 4)
+        self.assertEqual(samples[("latency_count", ())], 4)
+        self.assertAlmostEqual(samples[("latency_sum", ())], 3.65)
+
+    def test_registry_returns_the_same_metric(self):
+        registry = MetricsRegistry()
+        first = registry.counter("frames_total", "Frames.", stage="capture")
+        self.assertIs(registry.counter("frames_total", "Frames.", stage="capture"), first)
+        self.assertIsNot(registry.counter("frames_total", "Frames.", stage="display"), first)
+        with self.assertRaises(ValueError):
+            registry.histogram("frames_total", "Frames.")
+
+    def test_renders_the_text_format(self):
+        registry = MetricsRegistry()
+        registry.counter("frames_total", "Frames per stage.", stage="capture").inc(3)
+        registry.gauge("rpm", "Belt speed.", lambda: 120.5)
+        registry.gauge("free_sram", "Not reported yet.", lambda: None)
+        registry.counter("bytes_total", "Read elsewhere.", lambda: 42)
+        text = render(registry.collect())
+        self.assertIn("# TYPE frames_total counter\n", text)
+        self.assertIn('frames_total{stage="capture"} 3\n', text)
+        self.assertIn("# HELP rpm Belt speed.\n# TYPE rpm gauge\nrpm 120.5\n", text)
+        self.assertNotIn("\nfree_sram ", text)
+        self.assertIn("bytes_total 42\n", text)
+
+    def test_merges_the_families_of_several_belts(self):
+        belts = []
+        for name, rpm in (("Line 1", 100), ('Line "2"', 200)):
+            registry = MetricsRegistry()
+            registry.gauge("rpm", "Belt speed.", lambda rpm=rpm: rpm)
+            belts += label_families(registry.collect(), belt=name)
+        text = render(belts)
+        self.assertEqual(text.count("# TYPE rpm gauge"), 1)
+        self.assertIn('rpm{belt="Line 1"} 100\n', text)
+        self.assertIn('rpm{belt="Line \\"2\\""} 200\n', text)
+
+    def test_serves_metrics_over_http(self):
+        registry = MetricsRegistry()
+        registry.counter("requests_total", "Requests.").inc()
+        server = MetricsServer(registry.collect, 0)
+        server.start()
+        self.addCleanup(server.stop)
+        with urllib.request.urlopen(f"http://127.0.0.1:{server.port}/metrics", timeout=5) as response:
+            self.assertIn("text/plain", response.headers["Content-Type"])
+            self.assertIn("requests_total 1\n", response.read().decode())
+        with self.assertRaises(urllib.error.HTTPError):
+            urllib.request.urlopen(f"http://127.0.0.1:{server.port}/other", timeout=5)
+
+
+if __name__ == '__main__':
+    unittest.main()
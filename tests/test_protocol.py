@@ -0,0 +1,111 @@
+import unittest
+import struct
+from src.hardware.protocol import (FrameParser, FrameType, FRAME_SYNC_BYTE, TELEMETRY_BATCH_SAMPLES,
+                                   TELEMETRY_FORMAT, TELEMETRY_SAMPLE_FORMAT, TELEMETRY_STATUS_OBSTACLE,
+                                   TELEMETRY_STATUS_SERVO_READY, DEVICE_STATS_FORMAT, ActionEvent, ActionStatus,
+                                   ObstacleEvent, TelemetrySample, crc8, decode_action_event,
+                                   decode_device_stats, decode_obstacle_event, decode_telemetry,
+                                   decode_telemetry_batch,
+                                   encode_bin_table, encode_frame, encode_schedule, BIN_HOME,
+                                   BIN_TABLE_PAYLOAD_SIZE, CAPS_FLAG_BINARY, CAPS_FLAG_LINK_LOST, CAPS_FORMAT,
+                                   PAYLOAD_SIZES, decode_capabilities)
+
+class TestProtocol(unittest.TestCase):
+
+    def test_crc8_known_value(self):
+        # CRC-8/SMBUS check value for "123456789"
+        self.assertEqual(crc8(b"123456789"), 0xF4)
+
+    def test_encode_frame(self):
+        frame = encode_frame(FrameType.COMMAND, bytes([150, 0]))
+        self.assertEqual(frame[0], FRAME_SYNC_BYTE)
+        self.assertEqual(frame[1], FrameType.COMMAND)
+        self.assertEqual(frame[2:4], bytes([150, 0]))
+        self.assertEqual(frame[4], crc8(frame[1:4]))
+
+    def test_encode_frame_wrong_size(self):
+        with self.assertRaises(ValueError):
+            encode_frame(FrameType.COMMAND, bytes([1]))
+
+    def test_parser_split_and_noise(self):
+        parser = FrameParser()
+        payload = TELEMETRY_FORMAT.pack(300, 1, 123456, 789)
+        frame = encode_frame(FrameType.TELEMETRY, payload)
+        stream = b"12_0\n" + frame + frame
+        frames = parser.feed(stream[:8]) + parser.feed(stream[8:])
+        self.assertEqual(frames, [(FrameType.TELEMETRY, payload)] * 2)
+
+    def test_decode_telemetry(self):
+        payload = TELEMETRY_FORMAT.pack(300, TELEMETRY_STATUS_OBSTACLE | TELEMETRY_STATUS_SERVO_READY, 123456, 789)
+        self.assertEqual(decode_telemetry(payload), TelemetrySample(123456, 300, 1, None, True, 789))
+
+    def test_parser_rejects_bad_crc(self):
+        parser = FrameParser()
+        frame = bytearray(encode_frame(FrameType.HELLO_ACK, bytes([2, 0, 1, 2, 3, 4])))
+        frame[-1] ^= 0xFF
+        good = encode_frame(FrameType.HELLO_ACK, bytes([2, 0, 1, 2, 3, 4]))
+        self.assertEqual(parser.feed(bytes(frame) + good), [(FrameType.HELLO_ACK, bytes([2, 0, 1, 2, 3, 4]))])
+        self.assertEqual(parser.crc_errors, 1)
+
+    def test_decode_telemetry_batch(self):
+        samples = [TELEMETRY_SAMPLE_FORMAT.pack(1000 + i * 2000, 50 + i, 120 + i, i, 200) for i in range(3)]
+        padding = bytes(TELEMETRY_SAMPLE_FORMAT.size * (TELEMETRY_BATCH_SAMPLES - 3))
+        payload = bytes([3]) + b"".join(samples) + padding
+
+        parser = FrameParser()
+        frames = parser.feed(encode_frame(FrameType.TELEMETRY_BATCH, payload))
+        self.assertEqual(len(frames), 1)
+
+        decoded = decode_telemetry_batch(frames[0][1])
+        self.assertEqual(len(decoded), 3)
+        self.assertEqual(decoded[1], TelemetrySample(3000, 121, 1, 200, False, 51))
+        self.assertEqual(decoded[2], TelemetrySample(5000, 122, 0, 200, True, 52))
+
+    def test_decode_obstacle_event(self):
+        payload = struct.pack('<IIB', 123456, 7890, 1)
+        self.assertEqual(decode_obstacle_event(payload), ObstacleEvent(123456, 7890, 1, None))
+
+    def test_encode_schedule(self):
+        frame = encode_schedule(0x10203, 2, 0x1_0000_0005)
+        frames = FrameParser().feed(frame)
+        self.assertEqual(frames, [(FrameType.SCHEDULE, bytes([0x03, 0x02, 2, 5, 0, 0, 0]))])
+
+    def test_decode_action_event(self):
+        payload = struct.pack('<HBBI', 42, 1, ActionStatus.LATE, 5000)
+        event = decode_action_event(payload)
+        self.assertEqual(event, ActionEvent(42, 1, ActionStatus.LATE, 5000))
+
+    def test_decode_device_stats(self):
+        self.assertEqual(DEVICE_STATS_FORMAT.size, 31)  # PROFILE_STATS_PAYLOAD in the firmware
+        payload = DEVICE_STATS_FORMAT.pack(12, 480, 40, 100000, 5000, 6, 1000, 0, 1, 2, 3, 96, 1200, 0)
+        stats = decode_device_stats(payload)
+        self.assertEqual(stats.loop_max_us, 480)
+        self.assertEqual(stats.loop_count, 100000)
+        self.assertEqual(stats.free_sram, 1200)
+
+    def test_decode_capabilities(self):
+        self.assertEqual(PAYLOAD_SIZES[FrameType.CAPS], 12)
+        payload = CAPS_FORMAT.pack(7, CAPS_FLAG_BINARY | CAPS_FLAG_LINK_LOST, 4, 2, 123456, 0xDEADBEEF)
+        caps = decode_capabilities(payload)
+        self.assertEqual((caps.version, caps.baud_code, caps.pending_actions, caps.tick, caps.device_id),
+                         (7, 4, 2, 123456, 0xDEADBEEF))
+        self.assertTrue(caps.binary and caps.link_lost)
+        self.assertFalse(caps.stay_alive)
+
+    def test_encode_bin_table(self):
+        payload = encode_bin_table([20, 50, 80, 110, 140, 170], {0: 0, 3: 5, 4: BIN_HOME})
+        self.assertEqual(len(payload), BIN_TABLE_PAYLOAD_SIZE)
+        self.assertEqual(payload[0], 6)
+        self.assertEqual(list(payload[1:9]), [20, 50, 80, 110, 140, 170, 0, 0])
+        self.assertEqual(payload[9 + 3], 5)
+        self.assertEqual(payload[9 + 1], BIN_HOME)
+        encode_frame(FrameType.SET_BIN_TABLE, payload)
+
+    def test_encode_bin_table_rejects_unknown_bin(self):
+        with self.assertRaises(ValueError):
+            encode_bin_table([30, 90], {0: 2})
+        with self.assertRaises(ValueError):
+            encode_bin_table([30] * 9, {})
+
+if __name__ == '__main__':
+    unittest.main()
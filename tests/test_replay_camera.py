@@ -0,0 +1,61 @@
+import unittest
+from unittest.mock import patch, MagicMock
+from bench.replay_camera import ReplayCamera
+
+
+class FakeClock:
+    """Stands in for time.time()/time.sleep() so playback runs instantly."""
+    def __init__(self, now=1000.0):
+        self.now = now
+
+    def time(self):
+        return self.now
+
+    def sleep(self, seconds):
+        self.now += seconds
+
+
+class TestReplayCamera(unittest.TestCase):
+    def setUp(self):
+        self.clock = FakeClock()
+        patcher = patch('bench.replay_camera.time', self.clock)
+        patcher.start()
+        self.addCleanup(patcher.stop)
+        self.camera = ReplayCamera(["frame0", "frame1", "frame2"], fps=10)
+        self.camera.initialize()
+
+    def test_returns_each_frame_once(self):
+        frame, frame_time = self.camera.read_frame_with_timestamp()
+        self.assertEqual(frame, "frame0")
+        self.assertEqual(frame_time, 1000.0)
+        self.assertIsNone(self.camera.read_frame())  # frame1 is not due yet
+
+    def test_waits_for_the_next_frame(self):
+        self.camera.read_frame()
+        frame, frame_time = self.camera.read_frame_with_timestamp(timeout=0.5)
+        self.assertEqual(frame, "frame1")
+        self.assertAlmostEqual(frame_time, 1000.1)
+        self.assertAlmostEqual(self.clock.now, 1000.1)
+
+    def test_skips_to_the_newest_frame_and_loops(self):
+        self.camera.read_frame()
+        self.clock.now += 0.45
+        self.assertEqual(self.camera.read_frame(), "frame1")  # Frame 4 of the looped clip
+        self.assertEqual(self.camera.dropped_frames, 3)
+        self.assertAlmostEqual(self.camera.last_frame_time, 1000.4)
+
+    @patch('cv2.VideoCapture')
+    def test_initialize_fails_without_frames(self, mock_video_capture):
+        mock_cap_instance = MagicMock()
+        mock_video_capture.return_value = mock_cap_instance
+        mock_cap_instance.isOpened.return_value = True
+        mock_cap_instance.read.return_value = (False, None)
+
+        camera = ReplayCamera("empty.mp4")
+        with self.assertRaises(IOError) as cm:
+            camera.initialize()
+        self.assertIn("No frames in empty.mp4", str(cm.exception))
+
+
+if __name__ == '__main__':
+    unittest.main()
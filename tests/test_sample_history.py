@@ -0,0 +1,58 @@
+import unittest
+
+from src.core.sample_history import SampleHistory
+
+
+class TestSampleHistory(unittest.TestCase):
+    def fill(self, history, count, spikes=None):
+        spikes = spikes or {}
+        for i in range(count):
+            history.append(i * 0.01, spikes.get(i, i % 100), i % 2)
+
+    def test_empty(self):
+        history = SampleHistory(10)
+        self.assertEqual(len(history), 0)
+        self.assertIsNone(history.latest())
+        self.assertEqual(history.latest_obstacle_state(), 0)
+        times, rpms = history.decimated(10)
+        self.assertEqual(len(times), 0)
+        self.assertEqual(len(rpms), 0)
+
+    def test_keeps_the_newest_samples(self):
+        history = SampleHistory(100)
+        self.fill(history, 250)
+        self.assertEqual(len(history), 100)
+        self.assertEqual(history.latest(), (2.49, 49.0, 1))
+        self.assertEqual(history.latest_obstacle_state(), 1)
+        times, rpms = history.decimated(100)
+        self.assertEqual(times.tolist(), [i * 0.01 for i in range(150, 250)])
+        self.assertEqual(rpms.tolist(), [float(i % 100) for i in range(150, 250)])
+
+    def test_since_limits_the_span(self):
+        history = SampleHistory(100)
+        self.fill(history, 250)
+        times, _ = history.decimated(100, since=2.0)
+        self.assertEqual(times.tolist(), [i * 0.01 for i in range(200, 250)])
+
+    def test_decimation_keeps_the_extremes_in_order(self):
+        history = SampleHistory(1000)
+        self.fill(history, 5037, spikes={4500: 1000.0, 4800: -5.0})
+        times, rpms = history.decimated(100)
+        self.assertLessEqual(len(times), 100)
+        self.assertGreater(len(times), 10)
+        self.assertEqual(times.tolist(), sorted(times.tolist()))
+        self.assertEqual(max(rpms.tolist()), 1000.0)
+        self.assertEqual(min(rpms.tolist()), -5.0)
+        # The newest samples are drawn even before their summary entries are complete.
+        self.assertGreater(times.tolist()[-1], 50.0)
+
+    def test_decimated_reads_do_not_grow_with_the_history(self):
+        history = SampleHistory(100000)
+        self.fill(history, 100000)
+        times, _ = history.decimated(600)
+        self.assertLessEqual(len(times), 600)
+        self.assertEqual(times.tolist()[0], 0.0)
+
+
+if __name__ == '__main__':
+    unittest.main()
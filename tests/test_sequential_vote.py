@@ -0,0 +1,39 @@
+import unittest
+from src.core.sequential_vote import SequentialVote
+
+class TestSequentialVote(unittest.TestCase):
+
+    def test_consecutive_votes_decide(self):
+        vote = SequentialVote(3, None, 0)
+        for value in ['1', '2', '2']:
+            vote.add(value)
+            self.assertIsNone(vote.decision())
+        vote.add('2')
+        self.assertEqual(vote.decision(), '2')
+
+    def test_majority_needs_min_votes(self):
+        vote = SequentialVote(None, 0.75, 4)
+        for value in ['0', '0', '1']:
+            vote.add(value)
+        self.assertIsNone(vote.decision())
+        vote.add('0')
+        self.assertEqual(vote.decision(), '0')  # 3 of 4
+
+    def test_ignored_value_never_wins_early(self):
+        vote = SequentialVote(2, 0.5, 2, ignored='9')
+        vote.add('9')
+        vote.add('9')
+        self.assertIsNone(vote.decision())
+        self.assertEqual(vote.leader(), '9')
+
+    def test_clear(self):
+        vote = SequentialVote(2, None, 0)
+        vote.add('1')
+        vote.clear()
+        vote.add('1')
+        self.assertIsNone(vote.decision())
+        self.assertEqual(len(vote), 1)
+        self.assertFalse(SequentialVote(2, None, 0))
+
+if __name__ == '__main__':
+    unittest.main()
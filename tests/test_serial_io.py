@@ -0,0 +1,86 @@
+import threading
+import time
+import unittest
+from src.hardware.serial_io import SerialIOEngine
+
+class FakeSerial:
+    """Port stand-in: read() serves queued chunks, write() can be held to build up a queue."""
+    def __init__(self):
+        self.written = []
+        self.rx_chunks = []
+        self.write_gate = threading.Event()
+        self.write_gate.set()
+        self.fail_writes = False
+        self.in_waiting = 0
+
+    def read(self, size=1):
+        if self.rx_chunks:
+            return self.rx_chunks.pop(0)
+        time.sleep(0.001)
+        return b""
+
+    def write(self, data):
+        self.write_gate.wait()
+        if self.fail_writes:
+            raise OSError("device gone")
+        self.written.append(data)
+
+def wait_until(condition, timeout=1.0):
+    deadline = time.monotonic() + timeout
+    while not condition() and time.monotonic() < deadline:
+        time.sleep(0.001)
+    return condition()
+
+class TestSerialIOEngine(unittest.TestCase):
+
+    def setUp(self):
+        self.ser = FakeSerial()
+        self.received = []
+        self.errors = []
+        self.engine = SerialIOEngine(self.ser, lambda data, t: self.received.append(data), self.errors.append)
+        self.engine.start()
+
+    def tearDown(self):
+        self.ser.write_gate.set()
+        self.engine.stop()
+
+    def test_reader_delivers_chunks(self):
+        self.ser.rx_chunks = [b"\xa5\x82", b"\x01"]
+        self.assertTrue(wait_until(lambda: len(self.received) == 2))
+        self.assertEqual(b"".join(self.received), b"\xa5\x82\x01")
+        self.assertEqual(self.engine.received_bytes, 3)
+
+    def test_counts_sent_bytes(self):
+        self.engine.write(b"pwm 10")
+        self.engine.write(b"servo")
+        self.assertTrue(wait_until(lambda: self.engine.sent_bytes == 11))
+
+    def test_coalesces_tail_with_same_key(self):
+        self.ser.write_gate.clear()
+        self.engine.write(b"first")
+        self.assertTrue(wait_until(lambda: self.engine.pending_writes() == 0))  # Writer is now blocked on it
+        self.engine.write(b"pwm 10", "command")
+        self.engine.write(b"pwm 20", "command")
+        self.engine.write(b"servo", None)
+        self.engine.write(b"pwm 30", "command")
+        self.engine.write(b"pwm 40", "command")
+        self.ser.write_gate.set()
+        self.assertTrue(wait_until(lambda: len(self.ser.written) == 4))
+        self.assertEqual(self.ser.written, [b"first", b"pwm 20", b"servo", b"pwm 40"])
+        self.assertEqual(self.engine.coalesced_writes, 2)
+
+    def test_write_error_is_reported_once(self):
+        self.ser.fail_writes = True
+        self.engine.write(b"a")
+        self.assertTrue(wait_until(lambda: not self.engine.running))
+        self.assertFalse(self.engine.write(b"b"))
+        self.assertEqual(len(self.errors), 1)
+
+    def test_stop_is_silent(self):
+        self.engine.stop()
+        self.assertFalse(self.engine.running)
+        self.assertFalse(self.engine.write(b"a"))
+        self.assertEqual(self.errors, [])
+
+if __name__ == '__main__':
+    unittest.main()
@@ -1,134 +1,239 @@
+import threading
+import time
 import unittest
-from unittest.mock import patch, MagicMock
+from unittest.mock import MagicMock, patch
 import serial
-import serial.tools.list_ports
-import time
-from src.hardware.serial_manager import SerialManager
 from src.config.config import AppConfig
+from src.hardware.protocol import (BAUD_CODE_KEEP, BAUD_CODES, CAPS_FLAG_BINARY, CAPS_FLAG_STAY_ALIVE, CAPS_FORMAT,
+                                   HELLO_ACK_FORMAT, PROTOCOL_VERSION, TELEMETRY_FORMAT, FrameParser, FrameType, crc8,
+                                   encode_frame)
+from src.hardware.serial_manager import SerialManager
 from src.vision.classifiers import ServoCode
 
+class FakeBoard:
+    """Port stand-in that answers like the firmware.
+
+    With binary False it is firmware that predates the binary protocol: it
+    ignores frames and only reads ASCII command lines. The board keeps its
+    session when the port is closed, like a board whose auto-reset is off,
+    and only hears the host at the rate it is running at.
+    """
+    def __init__(self, binary=True, device_id=0x5E1A0C33):
+        self.binary = binary
+        self.device_id = device_id
+        self.port = None
+        self.baudrate = AppConfig.BAUDRATE
+        self.timeout = None
+        self.is_open = False
+        self.rate = AppConfig.BAUDRATE  # The board's own rate
+        self.session_baud_code = None  # Set by HELLO
+        self.reject_bin_table = False
+        self.unplugged = False
+        self.frames = []
+        self.lines = []
+        self._parser = FrameParser()
+        self._line = bytearray()
+        self._rx = bytearray()
+        self._condition = threading.Condition()
+
+    # --- serial.Serial ---
+    def open(self):
+        if self.unplugged:
+            raise serial.SerialException("no such device")
+        self.is_open = True
+
+    def close(self):
+        with self._condition:
+            self.is_open = False
+            self._condition.notify_all()
+
+    @property
+    def in_waiting(self):
+        return len(self._rx)
+
+    def reset_input_buffer(self):
+        with self._condition:
+            self._rx.clear()
+
+    def read(self, size=1):
+        with self._condition:
+            self._check()
+            self._condition.wait_for(lambda: self._rx or self.unplugged or not self.is_open, self.timeout)
+            self._check()
+            data = bytes(self._rx[:size])
+            del self._rx[:size]
+            return data
+
+    def write(self, data):
+        self._check()
+        if self.baudrate != self.rate:
+            return len(data)  # Garbage at the board's rate
+        if not self.binary:
+            self._line.extend(data)
+            *lines, rest = self._line.split(b"\n")
+            self._line = bytearray(rest)
+            self.lines += [line.decode(errors="replace") for line in lines]
+            return len(data)
+        for frame_type, payload in self._parser.feed(data):
+            self.frames.append((frame_type, payload))
+            self._answer(frame_type, payload)
+        return len(data)
+
+    # --- Test controls ---
+    def send(self, data: bytes):
+        with self._condition:
+            self._rx.extend(data)
+            self._condition.notify_all()
+
+    def send_frame(self, frame_type: FrameType, payload: bytes):
+        self.send(encode_frame(frame_type, payload))
+
+    def unplug(self):
+        with self._condition:
+            self.unplugged = True
+            self._rx.clear()
+            self._condition.notify_all()
+
+    def received(self, frame_type: FrameType) -> list[bytes]:
+        return [payload for received_type, payload in self.frames if received_type == frame_type]
+
+    def _check(self):
+        if self.unplugged or not self.is_open:
+            raise serial.SerialException("device reports readiness to read but returned no data")
+
+    def _answer(self, frame_type: FrameType, payload: bytes):
+        if frame_type == FrameType.HELLO:
+            baud_code = payload[1] if payload[1] in BAUD_CODES.values() else BAUD_CODE_KEEP
+            self.send_frame(FrameType.HELLO_ACK, HELLO_ACK_FORMAT.pack(PROTOCOL_VERSION, baud_code, self.device_id))
+            self.session_baud_code = baud_code
+            if baud_code != BAUD_CODE_KEEP:
+                self.rate = {code: rate for rate, code in BAUD_CODES.items()}[baud_code]
+        elif frame_type == FrameType.QUERY_CAPS:
+            session = self.session_baud_code is not None
+            flags = CAPS_FLAG_STAY_ALIVE | (CAPS_FLAG_BINARY if session else 0)
+            self.send_frame(FrameType.CAPS, CAPS_FORMAT.pack(PROTOCOL_VERSION, flags, self.session_baud_code or 0,
+                                                             0, 0, self.device_id))
+        elif frame_type == FrameType.SET_BIN_TABLE:
+            self.send_frame(FrameType.BIN_TABLE_ACK, bytes([int(self.reject_bin_table), crc8(payload)]))
+
+def wait_until(condition, timeout=2.0):
+    deadline = time.monotonic() + timeout
+    while not condition() and time.monotonic() < deadline:
+        time.sleep(0.005)
+    return condition()
+
 class TestSerialManager(unittest.TestCase):
 
-    @patch('serial.tools.list_ports.comports')
-    def test_get_arduino_port_found(self, mock_comports):
-        mock_port = MagicMock()
-        mock_port.device = "/dev/ttyACM0"
-        mock_port.description = "Arduino Uno (COM3)"
-        mock_comports.return_value = [mock_port]
-
-        manager = SerialManager()
-        port = manager._get_arduino_port()
-        self.assertEqual(port, "/dev/ttyACM0")
-
-    @patch('serial.tools.list_ports.comports')
-    def test_get_arduino_port_not_found(self, mock_comports):
-        mock_comports.return_value = []
-
-        manager = SerialManager()
-        port = manager._get_arduino_port()
-        self.assertIsNone(port)
-
-    @patch('serial.Serial')
-    @patch('serial.tools.list_ports.comports')
-    def test_connect_success(self, mock_comports, mock_serial):
-        mock_port = MagicMock()
-        mock_port.device = "/dev/ttyACM0"
-        mock_port.description = "Arduino Uno (COM3)"
-        mock_comports.return_value = [mock_port]
-
-        mock_serial_instance = MagicMock()
-        mock_serial.return_value = mock_serial_instance
-        mock_serial_instance.is_open = True
-
-        manager = SerialManager()
-        with patch('time.sleep', return_value=None): # Mock time.sleep
-            connected = manager.connect()
-
-        self.assertTrue(connected)
-        self.assertTrue(manager.connected)
-        mock_serial.assert_called_once_with("/dev/ttyACM0", AppConfig.BAUDRATE, timeout=1)
-
-    @patch('serial.Serial')
-    @patch('serial.tools.list_ports.comports')
-    def test_connect_failure(self, mock_comports, mock_serial):
-        mock_comports.return_value = [] # No port found initially
-
-        # Simulate port becoming available after some retries
-        mock_port = MagicMock()
-        mock_port.device = "/dev/ttyACM0"
-        mock_port.description = "Arduino Uno (COM3)"
-        mock_comports.side_effect = [[], [], [mock_port]] # Return empty list twice, then port
-
-        mock_serial_instance = MagicMock()
-        mock_serial.return_value = mock_serial_instance
-        mock_serial_instance.is_open = True
-
-        manager = SerialManager()
-        with patch('time.sleep', return_value=None): # Mock time.sleep
-            connected = manager.connect()
-
-        self.assertTrue(connected)
-        self.assertTrue(manager.connected)
-        self.assertEqual(mock_comports.call_count, 3) # Called 3 times due to retries
-
-    @patch('serial.Serial')
-    def test_disconnect(self, mock_serial):
-        manager = SerialManager()
-        manager.ser = MagicMock()
-        manager.ser.is_open = True
-        manager.connected = True
-
-        manager.disconnect()
-
-        manager.ser.close.assert_called_once()
-        self.assertFalse(manager.connected)
-
-    @patch('serial.Serial')
-    def test_read_data_success(self, mock_serial):
-        manager = SerialManager()
-        manager.ser = MagicMock()
-        manager.ser.is_open = True
-        manager.connected = True
-        manager.ser.readline.return_value = b"123_1\n"
-
-        rpm, obstacle_state = manager.read_data()
-        self.assertEqual(rpm, 123)
-        self.assertEqual(obstacle_state, 1)
-
-    @patch('serial.Serial')
-    def test_read_data_invalid_format(self, mock_serial):
-        manager = SerialManager()
-        manager.ser = MagicMock()
-        manager.ser.is_open = True
-        manager.connected = True
-        manager.ser.readline.return_value = b"invalid_data\n"
-
-        result = manager.read_data()
-        self.assertIsNone(result)
-
-    @patch('serial.Serial')
-    def test_send_command(self, mock_serial):
-        manager = SerialManager()
-        manager.ser = MagicMock()
-        manager.ser.is_open = True
-        manager.connected = True
-
-        pwm_value = 150
-        servo_code = ServoCode.RED
-        manager.send_command(pwm_value, servo_code)
-
-        manager.ser.write.assert_called_once_with(b"150_0\n")
-
-    @patch('serial.Serial')
-    def test_send_command_not_connected(self, mock_serial):
-        manager = SerialManager()
-        manager.connected = False
-
-        pwm_value = 150
-        servo_code = ServoCode.RED
-        manager.send_command(pwm_value, servo_code)
-
-        mock_serial.assert_not_called()
+    def setUp(self):
+        self.config = AppConfig()
+        self.config.SERIAL_PORT = "/dev/ttyACM0"
+        self.config.SERIAL_TIMEOUT_SECONDS = 0.05
+        self.config.SERIAL_CONNECT_DELAY_SECONDS = 0
+        self.config.SERIAL_HANDSHAKE_TIMEOUT_SECONDS = 0.2
+        self.board = FakeBoard()
+        self.disconnects = []
+        self.manager = SerialManager(self.config, on_disconnect=lambda: self.disconnects.append(True))
+        patcher = patch('serial.Serial', side_effect=self._open)
+        patcher.start()
+        self.addCleanup(patcher.stop)
+        self.addCleanup(self.manager.disconnect)
+
+    def _open(self, port=None, baudrate=None, timeout=None, **kwargs):
+        # With the DTR reset suppressed the port is configured before it is opened.
+        if port is not None:
+            self.board.port, self.board.baudrate, self.board.timeout = port, baudrate, timeout
+            self.board.open()
+        return self.board
+
+    def _read_samples(self):
+        # read_samples() also returns early for data that carries no sample, such as an ACK.
+        samples = []
+        wait_until(lambda: samples.extend(self.manager.read_samples(timeout=0.1)) or samples)
+        return samples
+
+    def test_candidate_ports(self):
+        self.config.SERIAL_PORT = None
+        arduino, other = MagicMock(), MagicMock()
+        arduino.device, arduino.description, arduino.hwid = "/dev/ttyACM0", "Arduino Uno", "USB VID:PID=2341:0043"
+        other.device, other.description, other.hwid = "/dev/ttyS0", "n/a", "PNP0501"
+        with patch('serial.tools.list_ports.comports', return_value=[other, arduino]):
+            self.assertEqual(self.manager._candidate_ports(), ["/dev/ttyACM0"])
+
+    def test_connects_with_the_binary_protocol(self):
+        self.assertTrue(self.manager.connect())
+        self.assertTrue(self.manager.binary_protocol)
+        self.assertTrue(self.manager.high_speed)
+        self.assertFalse(self.manager.resumed)
+        self.assertEqual(self.board.baudrate, self.config.SERIAL_HIGH_SPEED_BAUDRATE)
+        self.assertEqual(self.manager.device_id, self.board.device_id)
+        # The bin table goes up on connect and counts as stored once the board acknowledges it.
+        self.assertTrue(wait_until(lambda: self.manager._bin_table_crc is not None))
+
+        self.board.send_frame(FrameType.TELEMETRY, TELEMETRY_FORMAT.pack(123, 1, 1000, 7))
+        samples = self._read_samples()
+        self.assertEqual([(sample.rpm, sample.obstacle_state) for sample in samples], [(123, 1)])
+        self.manager.send_command(150, ServoCode.GREEN)
+        self.assertTrue(wait_until(lambda: self.board.received(FrameType.COMMAND) == [bytes([150, 2])]))
+
+    def test_falls_back_to_ascii(self):
+        self.board.binary = False
+        self.assertTrue(self.manager.connect())
+        self.assertFalse(self.manager.binary_protocol)
+        self.assertIsNone(self.manager.device_id)
+        self.assertEqual(self.board.baudrate, self.config.BAUDRATE)
+
+        self.board.send(b"123_1\n")
+        self.assertEqual(self.manager.read_data(), (123, 1))
+        self.manager.send_command(150, ServoCode.RED)
+        # The old firmware takes the ignored handshake frames for the start of the first line.
+        self.assertTrue(wait_until(lambda: self.board.lines and self.board.lines[-1].endswith("150_0")))
+        self.assertFalse(self.manager.schedule_servo_action(1, ServoCode.RED, 100))
+
+    def test_resumes_the_session_after_the_port_fails(self):
+        self.assertTrue(self.manager.connect())
+        self.assertTrue(wait_until(lambda: self.manager._bin_table_crc is not None))
+        self.board.unplug()
+        self.assertTrue(wait_until(lambda: not self.manager.connected))
+        self.assertEqual(self.disconnects, [True])
+        self.assertEqual(self.manager.link_errors, 1)
+        self.assertFalse(self.manager.connect())
+
+        self.board.unplugged = False
+        self.assertTrue(self.manager.connect())
+        self.assertTrue(self.manager.resumed)
+        self.assertTrue(self.manager.binary_protocol)
+        self.assertEqual((self.manager.connect_count, self.manager.resume_count), (2, 1))
+        # No second HELLO, and the board still has the confirmed bin table.
+        self.assertEqual(len(self.board.received(FrameType.HELLO)), 1)
+        self.assertEqual(len(self.board.received(FrameType.SET_BIN_TABLE)), 1)
+        self.board.send_frame(FrameType.TELEMETRY, TELEMETRY_FORMAT.pack(80, 0, 2000, 9))
+        self.assertEqual([sample.rpm for sample in self._read_samples()], [80])
+
+    def test_uploads_a_rejected_bin_table_again_on_resume(self):
+        self.board.reject_bin_table = True
+        self.assertTrue(self.manager.connect())
+        self.assertTrue(wait_until(lambda: self.board.received(FrameType.SET_BIN_TABLE)))
+        self.board.reject_bin_table = False
+        self.board.unplug()
+        self.assertTrue(wait_until(lambda: not self.manager.connected))
+        self.board.unplugged = False
+        self.assertTrue(self.manager.connect())
+        self.assertTrue(self.manager.resumed)
+        self.assertTrue(wait_until(lambda: self.manager._bin_table_crc is not None))
+        self.assertEqual(len(self.board.received(FrameType.SET_BIN_TABLE)), 2)
+
+    def test_skips_a_board_with_another_device_id(self):
+        self.config.SERIAL_DEVICE_ID = 0x9B27F4D0
+        self.assertFalse(self.manager.connect())
+        self.assertFalse(self.manager.connected)
+        self.assertFalse(self.board.is_open)
+
+    def test_disconnect(self):
+        self.assertTrue(self.manager.connect())
+        self.manager.disconnect()
+        self.assertFalse(self.manager.connected)
+        self.assertFalse(self.board.is_open)
+        self.manager.send_command(150, ServoCode.RED)  # Ignored once disconnected
 
 if __name__ == '__main__':
     unittest.main()
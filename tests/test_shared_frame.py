@@ -0,0 +1,57 @@
+import multiprocessing
+import unittest
+
+import numpy as np
+
+from src.core.shared_frame import SharedFrameBuffer
+
+
+def publish_frames(frames: SharedFrameBuffer, values: list):
+    for value in values:
+        frames.publish(np.full((4, 6, 3), value, np.uint8), float(value))
+    frames.close()
+
+
+class TestSharedFrameBuffer(unittest.TestCase):
+    def setUp(self):
+        self.frames = SharedFrameBuffer((8, 6))
+        self.addCleanup(self.frames.close)
+
+    def test_takes_the_newest_frame_once(self):
+        self.assertEqual(self.frames.take(), (None, None))
+        self.frames.publish(np.full((6, 8, 3), 1, np.uint8), 1.0)
+        self.frames.publish(np.full((6, 8, 3), 2, np.uint8), 2.0)
+        frame, frame_time = self.frames.take()
+        self.assertEqual(frame.shape, (6, 8, 3))
+        self.assertTrue((frame == 2).all())
+        self.assertEqual(frame_time, 2.0)
+        self.assertEqual(self.frames.take(), (None, None))
+        self.assertEqual(self.frames.dropped_frames, 1)
+
+    def test_a_taken_frame_is_not_overwritten(self):
+        self.frames.publish(np.full((6, 8, 3), 1, np.uint8), 1.0)
+        frame, _ = self.frames.take()
+        for value in (2, 3, 4):
+            self.frames.publish(np.full((6, 8, 3), value, np.uint8), float(value))
+        self.assertTrue((frame == 1).all())
+        self.assertTrue((self.frames.take()[0] == 4).all())
+
+    def test_keeps_each_frame_size(self):
+        self.frames.publish(np.zeros((3, 5, 3), np.uint8))
+        self.assertEqual(self.frames.take()[0].shape, (3, 5, 3))
+        self.frames.publish(np.zeros((12, 16, 3), np.uint8))  # Scaled down to fit
+        self.assertEqual(self.frames.take()[0].shape, (6, 8, 3))
+
+    def test_frames_from_another_process(self):
+        writer = multiprocessing.get_context("spawn").Process(target=publish_frames, args=(self.frames, [5, 7]))
+        writer.start()
+        writer.join(30)
+        self.assertEqual(writer.exitcode, 0)
+        frame, frame_time = self.frames.take()
+        self.assertEqual(frame.shape, (4, 6, 3))
+        self.assertTrue((frame == 7).all())
+        self.assertEqual(frame_time, 7.0)
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,71 @@
+import unittest
+
+from src.core.sequential_vote import SequentialVote
+from src.vision.tracker import CentroidTracker, box_centroid, box_iou
+
+
+def new_vote():
+    return SequentialVote(4, 0.75, 6)
+
+
+class TestBoxGeometry(unittest.TestCase):
+    def test_iou(self):
+        self.assertEqual(box_iou((0, 0, 10, 10), (0, 0, 10, 10)), 1.0)
+        self.assertEqual(box_iou((0, 0, 10, 10), (20, 0, 10, 10)), 0.0)
+        self.assertEqual(box_iou((0, 0, 10, 10), (10, 0, 10, 10)), 0.0)  # Touching edges
+        self.assertAlmostEqual(box_iou((0, 0, 10, 10), (5, 0, 10, 10)), 50 / 150)
+
+    def test_centroid(self):
+        self.assertEqual(box_centroid((10, 20, 4, 6)), (12, 23))
+
+
+class TestCentroidTracker(unittest.TestCase):
+    def setUp(self):
+        self.tracker = CentroidTracker(iou_threshold=0.3, max_distance=50, max_missed_frames=2,
+                                       vote_factory=new_vote)
+
+    def test_new_boxes_become_tracks(self):
+        tracks, lost = self.tracker.update([(0, 0, 20, 20), (100, 0, 20, 20)], 1.0)
+        self.assertEqual([track.track_id for track in tracks], [0, 1])
+        self.assertEqual([track.first_seen_time for track in tracks], [1.0, 1.0])
+        self.assertEqual(lost, [])
+        self.assertIsNot(tracks[0].votes, tracks[1].votes)
+
+    def test_overlapping_boxes_keep_their_track(self):
+        self.tracker.update([(0, 0, 20, 20), (100, 0, 20, 20)], 1.0)
+        tracks, _ = self.tracker.update([(104, 0, 20, 20), (4, 0, 20, 20)], 1.1)
+        self.assertEqual([(track.track_id, track.box) for track in tracks],
+                         [(0, (4, 0, 20, 20)), (1, (104, 0, 20, 20))])
+        self.assertEqual(tracks[0].first_seen_time, 1.0)
+
+    def test_fast_part_matches_by_distance(self):
+        self.tracker.update([(0, 0, 20, 20)], 1.0)
+        tracks, _ = self.tracker.update([(30, 0, 20, 20)], 1.1)  # No overlap left
+        self.assertEqual([(track.track_id, track.box) for track in tracks], [(0, (30, 0, 20, 20))])
+
+    def test_distant_box_is_a_new_part(self):
+        self.tracker.update([(0, 0, 20, 20)], 1.0)
+        tracks, _ = self.tracker.update([(0, 0, 20, 20), (200, 0, 20, 20)], 1.1)
+        self.assertEqual([track.track_id for track in tracks], [0, 1])
+
+    def test_track_survives_missed_frames_then_is_lost(self):
+        self.tracker.update([(0, 0, 20, 20)], 1.0)
+        tracks, lost = self.tracker.update([], 1.1)
+        self.assertEqual((len(tracks), tracks[0].missed_frames, lost), (1, 1, []))
+        tracks, lost = self.tracker.update([(2, 0, 20, 20)], 1.2)
+        self.assertEqual((len(tracks), tracks[0].missed_frames), (1, 0))
+        self.tracker.update([], 1.3)
+        self.tracker.update([], 1.4)
+        tracks, lost = self.tracker.update([], 1.5)
+        self.assertEqual(tracks, [])
+        self.assertEqual([track.track_id for track in lost], [0])
+
+    def test_ids_are_never_reused(self):
+        self.tracker.update([(0, 0, 20, 20)], 1.0)
+        self.tracker.clear()
+        tracks, _ = self.tracker.update([(0, 0, 20, 20)], 2.0)
+        self.assertEqual(tracks[0].track_id, 1)
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,142 @@
+import threading
+import time
+import unittest
+
+import numpy as np
+
+from src.config.config import AppConfig
+from src.core.vision_pipeline import DropOldestQueue, VisionPipeline
+from src.vision.classifiers import ColorClassifier, CompositeClassifier, ShapeClassifier
+from src.vision.features import FrameFeatures
+
+
+class TestDropOldestQueue(unittest.TestCase):
+    def test_drops_the_oldest_item_when_full(self):
+        queue = DropOldestQueue(2)
+        for item in range(4):
+            queue.put(item)
+        self.assertEqual(queue.dropped, 2)
+        self.assertEqual(len(queue), 2)
+        self.assertEqual(queue.get(0), 2)
+        self.assertEqual(queue.get(0), 3)
+        self.assertIsNone(queue.get(0.01))
+
+    def test_close_wakes_up_consumers(self):
+        queue = DropOldestQueue(2)
+        results = []
+        consumer = threading.Thread(target=lambda: results.append(queue.get(5)))
+        consumer.start()
+        queue.close()
+        consumer.join(1)
+        self.assertEqual(results, [None])
+        queue.put(1)
+        self.assertIsNone(queue.get(0))
+
+
+class FrameSource:
+    """Hands out the frames 0..count-1, one per read, then nothing."""
+    def __init__(self, count, interval=0.0):
+        self.count = count
+        self.interval = interval
+        self.next = 0
+        self._lock = threading.Lock()
+
+    def read(self, timeout):
+        time.sleep(self.interval)
+        with self._lock:
+            if self.next >= self.count:
+                time.sleep(timeout)
+                return None, None
+            frame = self.next
+            self.next += 1
+        return frame, 100.0 + frame
+
+
+class TestVisionPipeline(unittest.TestCase):
+    def run_pipeline(self, source, analyse, decided, workers=3, frame_queue_size=100, result_buffer_size=4,
+                     until=lambda: False):
+        def decide(result):
+            decided.append(result)
+            return result
+        pipeline = VisionPipeline(source.read, analyse, decide, workers, frame_queue_size, result_buffer_size,
+                                  read_timeout=0.01)
+        pipeline.start()
+        deadline = time.time() + 5
+        while not until() and time.time() < deadline:
+            time.sleep(0.01)
+        pipeline.stop()
+        return pipeline
+
+    def test_decides_in_capture_order(self):
+        def analyse(frame, capture_time):
+            # Later frames finish first, so the workers' results arrive out of order.
+            time.sleep(0.02 if frame % 3 == 0 else 0.001)
+            return frame, capture_time
+        decided = []
+        self.run_pipeline(FrameSource(30), analyse, decided, until=lambda: len(decided) == 30)
+        self.assertEqual(decided, [(frame, 100.0 + frame) for frame in range(30)])
+
+    def test_failed_analysis_is_skipped(self):
+        def analyse(frame, capture_time):
+            if frame == 2:
+                raise ValueError("broken frame")
+            return frame
+        decided = []
+        self.run_pipeline(FrameSource(5), analyse, decided, until=lambda: len(decided) == 4)
+        self.assertEqual(decided, [0, 1, 3, 4])
+
+    def test_slow_decisions_drop_frames_not_order(self):
+        decided = []
+
+        def slow_decide(result):
+            time.sleep(0.02)
+            decided.append(result)
+            return result
+        source = FrameSource(100, interval=0.001)
+        pipeline = VisionPipeline(source.read, lambda frame, capture_time: frame, slow_decide, 2, 2, 2,
+                                  read_timeout=0.01)
+        pipeline.start()
+        deadline = time.time() + 5
+        while source.next < 100 and time.time() < deadline:
+            time.sleep(0.01)
+        time.sleep(0.1)
+        pipeline.stop()
+        self.assertGreater(pipeline.dropped_frames, 0)
+        self.assertEqual(decided, sorted(decided))
+        self.assertLess(len(decided), 100)
+        # The newest decision is what the UI gets, once.
+        self.assertEqual(pipeline.take_output(), decided[-1])
+        self.assertIsNone(pipeline.take_output())
+
+    def test_workers_share_a_classifier_safely(self):
+        # Red and green frames alternate; every result must be the color of its own frame,
+        # also through the composite classifier, whose pool threads call the same ColorClassifier.
+        frames = [np.full((480, 640, 3), (0, 0, 255), np.uint8), np.full((480, 640, 3), (0, 255, 0), np.uint8)]
+        config = AppConfig()
+        color = ColorClassifier(config)
+        composite = CompositeClassifier(config, [color, ShapeClassifier(config)])
+        self.addCleanup(composite.close)
+        for classifier in (color, composite):
+            def analyse(frame, capture_time):
+                image = frames[frame % 2]
+                return frame, classifier.analyze(image, FrameFeatures(image)).name.split(" / ")[0]
+            decided = []
+            self.run_pipeline(FrameSource(60), analyse, decided, workers=4, until=lambda: len(decided) == 60)
+            self.assertEqual(len(decided), 60)
+            self.assertEqual([name for _, name in decided], [("Red", "Green")[frame % 2] for frame, _ in decided])
+
+    def test_next_frame_waits_for_a_new_capture(self):
+        source = FrameSource(1000, interval=0.005)
+        pipeline = VisionPipeline(source.read, lambda frame, capture_time: frame, lambda result: result, 1, 2, 2,
+                                  read_timeout=0.01)
+        pipeline.start()
+        first = pipeline.next_frame(1.0)
+        second = pipeline.next_frame(1.0)
+        pipeline.stop()
+        self.assertIsNotNone(first)
+        self.assertGreater(second, first)
+        self.assertIsNone(pipeline.next_frame(0.05))
+
+
+if __name__ == '__main__':
+    unittest.main()